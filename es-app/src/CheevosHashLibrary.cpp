@@ -0,0 +1,264 @@
+#include "CheevosHashLibrary.h"
+
+#include "HttpReq.h"
+#include "Log.h"
+#include "Paths.h"
+#include "Settings.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string.h>
+#include <unordered_set>
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/pointer.h>
+
+#define LIBRARY_MAGIC	"ESCH"
+#define LIBRARY_VERSION	1
+
+std::string CheevosHashLibrary::getCachePath()
+{
+	return Utils::FileSystem::getGenericPath(Paths::getUserEmulationStationPath() + "/cache/cheevos");
+}
+
+std::string CheevosHashLibrary::getServerUrl()
+{
+	// Can target a local server to test the refresh
+	std::string url = Settings::getInstance()->getString("CheevosServer");
+	if (url.empty())
+		url = "https://retroachievements.org";
+
+	return url;
+}
+
+bool CheevosHashLibrary::parseMd5(const std::string& hex, unsigned char* md5)
+{
+	if (hex.size() != 32)
+		return false;
+
+	for (int i = 0; i < 16; i++)
+	{
+		int value = 0;
+
+		for (int j = 0; j < 2; j++)
+		{
+			char c = hex[i * 2 + j];
+
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+				value |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				value |= c - 'A' + 10;
+			else
+				return false;
+		}
+
+		md5[i] = (unsigned char)value;
+	}
+
+	return true;
+}
+
+std::shared_ptr<CheevosHashLibrary> CheevosHashLibrary::load()
+{
+	std::string path = getCachePath() + "/hashlibrary.bin";
+
+	std::ifstream file(WINSTRINGW(path), std::ios::binary | std::ios::in);
+	if (!file.is_open())
+		return nullptr;
+
+	char magic[4];
+	unsigned int version = 0;
+	unsigned int count = 0;
+
+	file.read(magic, 4);
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&count, sizeof(count));
+
+	if (!file || memcmp(magic, LIBRARY_MAGIC, 4) != 0 || version != LIBRARY_VERSION)
+	{
+		LOG(LogWarning) << "CheevosHashLibrary : invalid library " << path;
+		return nullptr;
+	}
+
+	std::shared_ptr<CheevosHashLibrary> library = std::make_shared<CheevosHashLibrary>();
+	library->mEntries.resize(count);
+
+	if (count > 0)
+		file.read((char*)library->mEntries.data(), count * sizeof(Entry));
+
+	if (!file)
+	{
+		LOG(LogWarning) << "CheevosHashLibrary : truncated library " << path;
+		return nullptr;
+	}
+
+	LOG(LogDebug) << "CheevosHashLibrary : " << count << " hashes loaded";
+	return library;
+}
+
+int CheevosHashLibrary::getGameId(const std::string& md5) const
+{
+	Entry key;
+	if (!parseMd5(md5, key.md5))
+		return 0;
+
+	auto it = std::lower_bound(mEntries.cbegin(), mEntries.cend(), key, [](const Entry& a, const Entry& b) { return memcmp(a.md5, b.md5, 16) < 0; });
+	if (it == mEntries.cend() || memcmp(it->md5, key.md5, 16) != 0)
+		return 0;
+
+	return it->gameId;
+}
+
+bool CheevosHashLibrary::refresh()
+{
+	std::string folder = getCachePath();
+	std::string path = folder + "/hashlibrary.bin";
+
+	bool hasLibrary = Utils::FileSystem::exists(path);
+
+	// Validators of the last download
+	std::map<std::string, std::string> validators;
+
+	std::ifstream info(WINSTRINGW(path + ".info"));
+	if (hasLibrary && info.is_open())
+	{
+		std::string line;
+		while (std::getline(info, line))
+		{
+			auto eq = line.find('=');
+			if (eq != std::string::npos)
+				validators[line.substr(0, eq)] = line.substr(eq + 1);
+		}
+	}
+
+	info.close();
+
+	std::string officialGamesUrl = getServerUrl() + "/dorequest.php?r=officialgameslist";
+	std::string hashLibraryUrl = getServerUrl() + "/dorequest.php?r=hashlibrary";
+
+	auto createRequest = [&validators](const std::string& url, const std::string& name, bool conditional)
+	{
+		HttpReqOptions options;
+
+		if (conditional && !validators[name + ".etag"].empty())
+			options.customHeaders.push_back("If-None-Match: " + validators[name + ".etag"]);
+
+		if (conditional && !validators[name + ".last-modified"].empty())
+			options.customHeaders.push_back("If-Modified-Since: " + validators[name + ".last-modified"]);
+
+		return std::unique_ptr<HttpReq>(new HttpReq(url, &options));
+	};
+
+	std::unique_ptr<HttpReq> officialGamesList = createRequest(officialGamesUrl, "officialgameslist", hasLibrary);
+	std::unique_ptr<HttpReq> hashLibrary = createRequest(hashLibraryUrl, "hashlibrary", hasLibrary);
+
+	officialGamesList->wait();
+	hashLibrary->wait();
+
+	if (officialGamesList->status() == HttpReq::REQ_304_NOTMODIFIED && hashLibrary->status() == HttpReq::REQ_304_NOTMODIFIED)
+	{
+		LOG(LogDebug) << "CheevosHashLibrary : library is up to date";
+		return true;
+	}
+
+	// Only the filtered library is stored : both lists are needed as soon as one of them changed
+	if (officialGamesList->status() == HttpReq::REQ_304_NOTMODIFIED)
+		officialGamesList = createRequest(officialGamesUrl, "officialgameslist", false);
+	else if (hashLibrary->status() == HttpReq::REQ_304_NOTMODIFIED)
+		hashLibrary = createRequest(hashLibraryUrl, "hashlibrary", false);
+
+	if (!officialGamesList->wait() || !hashLibrary->wait())
+	{
+		LOG(LogWarning) << "CheevosHashLibrary : unable to download the hash library";
+		return false;
+	}
+
+	std::unordered_set<int> officialGames;
+	std::vector<Entry> entries;
+
+	try
+	{
+		rapidjson::Document ogdoc;
+		ogdoc.Parse(officialGamesList->getContent().c_str());
+		if (ogdoc.HasParseError() || !ogdoc.HasMember("Response"))
+			return false;
+
+		const rapidjson::Value& response = ogdoc["Response"];
+		for (auto it = response.MemberBegin(); it != response.MemberEnd(); ++it)
+			officialGames.insert(Utils::String::toInteger(it->name.GetString()));
+
+		rapidjson::Document doc;
+		doc.Parse(hashLibrary->getContent().c_str());
+		if (doc.HasParseError() || !doc.HasMember("MD5List"))
+			return false;
+
+		const rapidjson::Value& mdlist = doc["MD5List"];
+		entries.reserve(mdlist.MemberCount());
+
+		for (auto it = mdlist.MemberBegin(); it != mdlist.MemberEnd(); ++it)
+		{
+			if (!it->value.IsInt())
+				continue;
+
+			Entry entry;
+			entry.gameId = it->value.GetInt();
+
+			if (officialGames.find(entry.gameId) == officialGames.cend())
+				continue;
+
+			if (parseMd5(it->name.GetString(), entry.md5))
+				entries.push_back(entry);
+		}
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return memcmp(a.md5, b.md5, 16) < 0; });
+	entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return memcmp(a.md5, b.md5, 16) == 0; }), entries.end());
+
+	if (!Utils::FileSystem::isDirectory(folder))
+		Utils::FileSystem::createDirectory(folder);
+
+	// Write data first & rename, so that readers never see a partial file
+	std::ofstream file(WINSTRINGW(path + ".tmp"), std::ios::binary | std::ios::out);
+	if (!file.is_open())
+	{
+		LOG(LogWarning) << "CheevosHashLibrary : unable to write " << path;
+		return false;
+	}
+
+	unsigned int version = LIBRARY_VERSION;
+	unsigned int count = (unsigned int)entries.size();
+
+	file.write(LIBRARY_MAGIC, 4);
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&count, sizeof(count));
+
+	if (count > 0)
+		file.write((const char*)entries.data(), count * sizeof(Entry));
+
+	file.close();
+
+	if (!Utils::FileSystem::renameFile(path + ".tmp", path))
+		return false;
+
+	std::string validatorsInfo;
+	validatorsInfo += "officialgameslist.etag=" + officialGamesList->getResponseHeader("ETag") + "\n";
+	validatorsInfo += "officialgameslist.last-modified=" + officialGamesList->getResponseHeader("Last-Modified") + "\n";
+	validatorsInfo += "hashlibrary.etag=" + hashLibrary->getResponseHeader("ETag") + "\n";
+	validatorsInfo += "hashlibrary.last-modified=" + hashLibrary->getResponseHeader("Last-Modified") + "\n";
+
+	Utils::FileSystem::writeAllText(path + ".info.tmp", validatorsInfo);
+	Utils::FileSystem::renameFile(path + ".info.tmp", path + ".info");
+
+	LOG(LogInfo) << "CheevosHashLibrary : " << count << " hashes downloaded";
+	return true;
+}
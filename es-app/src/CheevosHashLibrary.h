@@ -0,0 +1,40 @@
+#pragma once
+#ifndef ES_APP_CHEEVOS_HASH_LIBRARY_H
+#define ES_APP_CHEEVOS_HASH_LIBRARY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Local copy of the RetroAchievements hash library, restricted to the official games, stored under ~/.emulationstation/cache/cheevos
+// File format : "ESCH" <version> <count>, then <count> entries of a binary MD5 (16 bytes) & a game id (int32), sorted by MD5
+// so the file can be binary searched as is. It is refreshed with If-None-Match / If-Modified-Since requests.
+class CheevosHashLibrary
+{
+public:
+	// Loads the local library, returns nullptr if it was never downloaded
+	static std::shared_ptr<CheevosHashLibrary> load();
+
+	// Downloads the library if it changed on the server, returns false if the local library could not be updated
+	static bool refresh();
+
+	// Game id for this MD5 (hexadecimal string), 0 if unknown
+	int getGameId(const std::string& md5) const;
+
+	size_t size() const { return mEntries.size(); }
+
+private:
+	struct Entry
+	{
+		unsigned char md5[16];
+		int gameId;
+	};
+
+	static std::string getCachePath();
+	static std::string getServerUrl();
+	static bool parseMd5(const std::string& hex, unsigned char* md5);
+
+	std::vector<Entry> mEntries;
+};
+
+#endif // ES_APP_CHEEVOS_HASH_LIBRARY_H
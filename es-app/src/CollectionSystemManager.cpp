@@ -27,6 +27,157 @@ std::string myCollectionsName = "collections";
 
 #define LAST_PLAYED_MAX	50
 
+// Metadata used by the auto collection filters, read & parsed once per game whatever the number of collections
+class AutoCollectionGame
+{
+public:
+	AutoCollectionGame(FileData* game, bool isArcade) : mGame(game), mIsArcade(isArcade), mPlayed(-1), mPlayersParsed(false), mMinPlayers(-1), mMaxPlayers(0) { }
+
+	bool isPlayed()
+	{
+		if (mPlayed < 0)
+			mPlayed = mGame->getMetadata(MetaDataId::PlayCount) > "0" ? 1 : 0;
+
+		return mPlayed == 1;
+	}
+
+	bool hasPlayers(int count)
+	{
+		if (!mPlayersParsed)
+			parsePlayers();
+
+		if (mMaxPlayers < 0)
+			return false;
+
+		return mMinPlayers <= 0 ? (count == mMaxPlayers) : (mMinPlayers <= count && count <= mMaxPlayers);
+	}
+
+	bool matches(const CollectionSystemDecl& decl)
+	{
+		switch (decl.type)
+		{
+		case AUTO_ALL_GAMES:
+			return true;
+		case AUTO_VERTICALARCADE:
+			return mGame->isVerticalArcadeGame();
+		case AUTO_LIGHTGUN:
+			return mGame->isLightGunGame();
+		case AUTO_RETROACHIEVEMENTS:
+			return mGame->hasCheevos();
+		case AUTO_LAST_PLAYED:
+			return isPlayed();
+		case AUTO_NEVER_PLAYED:
+			return !isPlayed();
+		case AUTO_FAVORITES:
+			// we may still want to add files we don't want in auto collections in "favorites"
+			return mGame->getFavorite();
+		case AUTO_ARCADE:
+			return mIsArcade;
+		case AUTO_AT2PLAYERS:
+			return hasPlayers(2);
+		case AUTO_AT4PLAYERS:
+			return hasPlayers(4);
+		default:
+			if (!decl.isCustom && !decl.displayIfEmpty)
+			{
+				if (decl.isGenreCollection())
+					return Genres::genreExists(&mGame->getMetadata(), ((int)decl.type) - 10000);
+
+				if (decl.isArcadeSubSystem())
+					return mIsArcade && mGame->getMetadata(MetaDataId::ArcadeSystemName) == decl.themeFolder;
+			}
+
+			return true;
+		}
+	}
+
+private:
+	void parsePlayers()
+	{
+		mPlayersParsed = true;
+
+		std::string players = mGame->getMetadata(MetaDataId::Players);
+		if (players.empty())
+		{
+			mMaxPlayers = -1;
+			return;
+		}
+
+		auto split = players.rfind("+");
+		if (split != std::string::npos)
+			players = Utils::String::replace(players, "+", "-999");
+
+		split = players.rfind("-");
+		if (split != std::string::npos)
+		{
+			mMinPlayers = atoi(players.substr(0, split).c_str());
+			players = players.substr(split + 1);
+		}
+
+		mMaxPlayers = atoi(players.c_str());
+	}
+
+	FileData* mGame;
+	bool mIsArcade;
+	int mPlayed;
+
+	bool mPlayersParsed;
+	int mMinPlayers;
+	int mMaxPlayers;
+};
+
+// Systems & extensions hidden by the user : their games are not in the auto collections.
+// Shared by the full population of the collections, and by their update when a game is edited.
+class AutoCollectionFilter
+{
+public:
+	AutoCollectionFilter()
+	{
+		mHiddenSystemsShowGames = Settings::HiddenSystemsShowGames();
+		mHiddenSystems = Utils::String::split(Settings::getInstance()->getString("HiddenSystems"), ';');
+	}
+
+	bool includeSystem(SystemData* system) const
+	{
+		if (!system->isGameSystem() || system->isCollection())
+			return false;
+
+		return mHiddenSystemsShowGames || std::find(mHiddenSystems.cbegin(), mHiddenSystems.cend(), system->getName()) == mHiddenSystems.cend();
+	}
+
+	static std::vector<std::string> getHiddenExtensions(SystemData* system)
+	{
+		std::vector<std::string> hiddenExts;
+		for (auto ext : Utils::String::split(Settings::getInstance()->getString(system->getName() + ".HiddenExt"), ';'))
+			hiddenExts.push_back("." + Utils::String::toLower(ext));
+
+		return hiddenExts;
+	}
+
+	static bool hasHiddenExtension(FileData* file, const std::vector<std::string>& hiddenExts)
+	{
+		if (hiddenExts.size() == 0 || file->getType() != GAME)
+			return false;
+
+		std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension(file->getFileName()));
+		return std::find(hiddenExts.cbegin(), hiddenExts.cend(), extlow) != hiddenExts.cend();
+	}
+
+private:
+	bool mHiddenSystemsShowGames;
+	std::vector<std::string> mHiddenSystems;
+};
+
+// Collection entries are flat, and point to their source game
+static FileData* findCollectionEntry(FolderData* rootFolder, FileData* file)
+{
+	for (auto child : rootFolder->getChildren())
+		if (child->getType() != FOLDER && child->getSourceFileData() == file)
+			return child;
+
+	return nullptr;
+}
+
 /* Handling the getting, initialization, deinitialization, saving and deletion of
  * a CollectionSystemManager Instance */
 CollectionSystemManager* CollectionSystemManager::sInstance = NULL;
@@ -425,35 +576,50 @@ void CollectionSystemManager::refreshCollectionSystems(FileData* file)
 	if (!file->getSystem()->isGameSystem() || file->getType() != GAME)
 		return;
 
-	std::map<std::string, CollectionSystemData> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.cbegin(), mAutoCollectionSystemsData.cend());
-	allCollections.insert(mCustomCollectionSystemsData.cbegin(), mCustomCollectionSystemsData.cend());
-
-	for (auto sysDataIt = allCollections.cbegin(); sysDataIt != allCollections.cend(); sysDataIt++)
+	for (auto sysDataIt = mAutoCollectionSystemsData.cbegin(); sysDataIt != mAutoCollectionSystemsData.cend(); sysDataIt++)
 		updateCollectionSystem(file, sysDataIt->second);
+
+	for (auto sysDataIt = mCustomCollectionSystemsData.cbegin(); sysDataIt != mCustomCollectionSystemsData.cend(); sysDataIt++)
+		if (mAutoCollectionSystemsData.find(sysDataIt->first) == mAutoCollectionSystemsData.cend())
+			updateCollectionSystem(file, sysDataIt->second);
 }
 
-void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionSystemData sysData)
+void CollectionSystemManager::updateCollectionSystem(FileData* file, const CollectionSystemData& sysData)
 {
 	if (!sysData.isPopulated)
 		return;
 
-	// collection files use the full path as key, to avoid clashes
-	std::string key = file->getFullPath();
-
 	SystemData* curSys = sysData.system;
-	FileData* collectionEntry = curSys->getRootFolder()->FindByPath(key);
 	FolderData* rootFolder = curSys->getRootFolder();
+	FileData* collectionEntry = findCollectionEntry(rootFolder, file);
 
 	std::string name = curSys->getName();
 
+	// Auto collections (except dynamic ones) follow the same filters as when they were populated
+	bool autoCollection = !sysData.decl.isCustom && sysData.filteredIndex == nullptr;
+
+	bool include = false;
+	if (autoCollection)
+	{
+		SystemData* system = file->getSystem();
+
+		if (AutoCollectionFilter().includeSystem(system) && includeFileInAutoCollections(file) && !AutoCollectionFilter::hasHiddenExtension(file, AutoCollectionFilter::getHiddenExtensions(system)))
+		{
+			std::vector<PlatformIds::PlatformId> platforms = system->getPlatformIds();
+			bool isArcade = std::find(platforms.begin(), platforms.end(), PlatformIds::ARCADE) != platforms.end();
+
+			AutoCollectionGame game(file, isArcade);
+			include = game.matches(sysData.decl);
+		}
+	}
+
 	if (collectionEntry != nullptr)
 	{
 		// remove from index, so we can re-index metadata after refreshing
 		curSys->removeFromIndex(collectionEntry);
 
 		// found and we are removing
-		if (name == "favorites" && !file->getFavorite())
+		if (autoCollection && !include)
 		{
 			// need to check if still marked as favorite, if not remove
 			auto view = ViewController::get()->getGameListView(curSys, false);
@@ -475,8 +641,7 @@ void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionS
 	else
 	{
 		// we didn't find it here - we need to check if we should add it
-		if (name == "recent" && file->getMetadata(MetaDataId::PlayCount) > "0" && includeFileInAutoCollections(file) ||
-			name == "favorites" && file->getFavorite())
+		if (include)
 		{
 			CollectionFileData* newGame = new CollectionFileData(file, curSys);
 			rootFolder->addChild(newGame);
@@ -967,129 +1132,92 @@ SystemData* CollectionSystemManager::createNewCollectionEntry(std::string name,
 // populates an Automatic Collection System
 void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysData)
 {
-	SystemData* newSys = sysData->system;
-	CollectionSystemDecl sysDecl = sysData->decl;
-	FolderData* rootFolder = newSys->getRootFolder();
+	populateAutoCollections({ sysData });
+}
 
-	bool hiddenSystemsShowGames = Settings::HiddenSystemsShowGames();
-	auto hiddenSystems = Utils::String::split(Settings::getInstance()->getString("HiddenSystems"), ';');
+// populates several Automatic Collection Systems with a single pass over the games of every system
+void CollectionSystemManager::populateAutoCollections(const std::vector<CollectionSystemData*>& collections)
+{
+	if (collections.empty())
+		return;
 
-	for (auto& system : SystemData::sSystemVector)
-	{
-		// we won't iterate all collections
-		if (!system->isGameSystem() || system->isCollection())
-			continue;
+	AutoCollectionFilter filter;
 
-		if (!hiddenSystemsShowGames && std::find(hiddenSystems.cbegin(), hiddenSystems.cend(), system->getName()) != hiddenSystems.cend())
-			continue;
+	// we won't iterate all collections
+	std::vector<SystemData*> systems;
+	for (auto system : SystemData::sSystemVector)
+		if (filter.includeSystem(system))
+			systems.push_back(system);
+
+	// games of each collection, by system : systems can be filtered in parallel, collections are filled in system order
+	std::vector<std::vector<std::vector<FileData*>>> matches(systems.size(), std::vector<std::vector<FileData*>>(collections.size()));
+
+	auto filterSystem = [this, &systems, &collections, &matches](size_t index)
+	{
+		SystemData* system = systems[index];
 
 		std::vector<PlatformIds::PlatformId> platforms = system->getPlatformIds();
 		bool isArcade = std::find(platforms.begin(), platforms.end(), PlatformIds::ARCADE) != platforms.end();
 
-		std::vector<std::string> hiddenExts;
-		for (auto ext : Utils::String::split(Settings::getInstance()->getString(system->getName() + ".HiddenExt"), ';'))
-			hiddenExts.push_back("." + Utils::String::toLower(ext));
+		std::vector<std::string> hiddenExts = AutoCollectionFilter::getHiddenExtensions(system);
 
 		std::vector<FileData*> files = system->getRootFolder()->getFilesRecursive(GAME);
-		for (auto& game : files)
+		for (auto& file : files)
 		{
-			if (system->isGroupSystem() && game->getSystem() != system)
+			if (system->isGroupSystem() && file->getSystem() != system)
 				continue;
 
-			bool include = includeFileInAutoCollections(game);
-			if (!include)
+			if (!includeFileInAutoCollections(file) || AutoCollectionFilter::hasHiddenExtension(file, hiddenExts))
 				continue;
 
-			if (hiddenExts.size() > 0 && game->getType() == GAME)
-			{
-				std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension(game->getFileName()));
-				if (std::find(hiddenExts.cbegin(), hiddenExts.cend(), extlow) != hiddenExts.cend())
-					continue;
-			}
+			AutoCollectionGame game(file, isArcade);
 
-			switch (sysDecl.type)
-			{
-			case AUTO_ALL_GAMES:
-				break;
-			case AUTO_VERTICALARCADE:
-				include = game->isVerticalArcadeGame();
-				break;
-			case AUTO_LIGHTGUN:
-				include = game->isLightGunGame();
-				break;
-			case AUTO_RETROACHIEVEMENTS:
-				include = game->hasCheevos();
-				break;
-			case AUTO_LAST_PLAYED:
-				include = game->getMetadata(MetaDataId::PlayCount) > "0";
-				break;
-			case AUTO_NEVER_PLAYED:
-				include = !(game->getMetadata(MetaDataId::PlayCount) > "0");
-				break;
-			case AUTO_FAVORITES:
-				// we may still want to add files we don't want in auto collections in "favorites"
-				include = game->getFavorite();
-				break;
-			case AUTO_ARCADE:
-				include = isArcade;
-				break;
-			case AUTO_AT2PLAYERS: 
-			case AUTO_AT4PLAYERS:
-			{
-				std::string players = game->getMetadata(MetaDataId::Players);
-				if (players.empty())
-					include = false;
-				else
-				{
-					int min = -1;
-
-					auto split = players.rfind("+");
-					if (split != std::string::npos)
-						players = Utils::String::replace(players, "+", "-999");
-
-					split = players.rfind("-");
-					if (split != std::string::npos)
-					{
-						min = atoi(players.substr(0, split).c_str());
-						players = players.substr(split + 1);
-					}
-
-					int max = atoi(players.c_str());
-					int val = (sysDecl.type == AUTO_AT2PLAYERS ? 2 : 4);
-					include = min <= 0 ? (val == max) : (min <= val && val <= max);
-				}
-			}
-			break;
+			for (size_t i = 0; i < collections.size(); i++)
+				if (game.matches(collections[i]->decl))
+					matches[index][i].push_back(file);
+		}
+	};
 
-			default:
-				if (!sysDecl.isCustom && !sysDecl.displayIfEmpty)
-				{
-					if (sysDecl.isGenreCollection())
-						include = Genres::genreExists(&game->getMetadata(), ((int)sysDecl.type) - 10000);
-					else if (sysDecl.isArcadeSubSystem())
-						include = isArcade && game->getMetadata(MetaDataId::ArcadeSystemName) == sysDecl.themeFolder;
-				}
+	if (systems.size() > 1 && Settings::getInstance()->getBool("ThreadedLoading"))
+	{
+		Utils::ThreadPool pool;
 
-				break;
-			}
+		for (size_t i = 0; i < systems.size(); i++)
+			pool.queueWorkItem([filterSystem, i] { filterSystem(i); });
+
+		pool.wait();
+	}
+	else
+	{
+		for (size_t i = 0; i < systems.size(); i++)
+			filterSystem(i);
+	}
 
-			if (include)
+	for (size_t i = 0; i < collections.size(); i++)
+	{
+		CollectionSystemData* sysData = collections[i];
+		SystemData* newSys = sysData->system;
+		FolderData* rootFolder = newSys->getRootFolder();
+
+		for (auto& systemMatches : matches)
+		{
+			for (auto game : systemMatches[i])
 			{
 				CollectionFileData* newGame = new CollectionFileData(game, newSys);
 				rootFolder->addChild(newGame);
 				newSys->addToIndex(newGame);
 			}
 		}
-	}
 
-	if (sysDecl.type == AUTO_LAST_PLAYED)
-	{
-		sortLastPlayed(newSys);
-		trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
-	}
+		if (sysData->decl.type == AUTO_LAST_PLAYED)
+		{
+			sortLastPlayed(newSys);
+			trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
+		}
 
-	sysData->isPopulated = true;
-	updateCollectionFolderMetadata(newSys);
+		sysData->isPopulated = true;
+		updateCollectionFolderMetadata(newSys);
+	}
 }
 
 // populates a Custom Collection System
@@ -1218,30 +1346,37 @@ void CollectionSystemManager::removeCollectionsFromDisplayedSystems()
 
 void CollectionSystemManager::addEnabledCollectionsToDisplayedSystems(std::map<std::string, CollectionSystemData>* colSystemData, std::unordered_map<std::string, FileData*>* pMap)
 {
-	if (Settings::getInstance()->getBool("ThreadedLoading"))
+	std::vector<CollectionSystemData*> customCollections;
+	std::vector<CollectionSystemData*> autoCollections;
+
+	for (auto it = colSystemData->begin(); it != colSystemData->end(); it++)
 	{
-		std::vector<CollectionSystemData*> collectionsToPopulate;
-		for (auto it = colSystemData->begin(); it != colSystemData->end(); it++)
-			if (it->second.isEnabled && !it->second.isPopulated)
-				collectionsToPopulate.push_back(&(it->second));
+		if (!it->second.isEnabled || it->second.isPopulated)
+			continue;
 
-		if (collectionsToPopulate.size() > 1)
-		{
-			getAllGamesCollection();
+		if (it->second.decl.isCustom)
+			customCollections.push_back(&(it->second));
+		else
+			autoCollections.push_back(&(it->second));
+	}
 
-			Utils::ThreadPool pool;
+	if (Settings::getInstance()->getBool("ThreadedLoading") && customCollections.size() + autoCollections.size() > 1)
+	{
+		getAllGamesCollection();
 
-			for (auto collection : collectionsToPopulate)
-			{
-				if (collection->decl.isCustom)
-					pool.queueWorkItem([this, collection, pMap] { populateCustomCollection(collection, pMap); });
-				else
-					pool.queueWorkItem([this, collection, pMap] { populateAutoCollection(collection); });
-			}
+		Utils::ThreadPool pool;
 
-			pool.wait();
-		}
+		for (auto collection : customCollections)
+			pool.queueWorkItem([this, collection, pMap] { populateCustomCollection(collection, pMap); });
+
+		// auto collections are filled together, with one pass over the games
+		if (autoCollections.size() > 0)
+			pool.queueWorkItem([this, autoCollections] { populateAutoCollections(autoCollections); });
+
+		pool.wait();
 	}
+	else
+		populateAutoCollections(autoCollections);
 
 	// add auto enabled ones
 	for (auto it = colSystemData->begin(); it != colSystemData->end(); it++)
@@ -39,8 +39,8 @@ struct CollectionSystemDecl
 	bool isCustom;	
     bool displayIfEmpty;
 
-	bool isArcadeSubSystem() { return (int)type >= 1000 && (int)type < 10000; }
-	bool isGenreCollection() { return (int)type >= 10000 && (int)type < 20000; }
+	bool isArcadeSubSystem() const { return (int)type >= 1000 && (int)type < 10000; }
+	bool isGenreCollection() const { return (int)type >= 10000 && (int)type < 20000; }
 };
 
 struct CollectionSystemData
@@ -73,7 +73,7 @@ public:
 	void updateSystemsList();
 
 	void refreshCollectionSystems(FileData* file);
-	void updateCollectionSystem(FileData* file, CollectionSystemData sysData);
+	void updateCollectionSystem(FileData* file, const CollectionSystemData& sysData);
 	void deleteCollectionFiles(FileData* file);
 
 	inline std::map<std::string, CollectionSystemData>& getAutoCollectionSystems() { return mAutoCollectionSystemsData; };
@@ -93,6 +93,7 @@ public:
 
 	void reloadCollection(const std::string collectionName, bool repopulateGamelist = true);
     void populateAutoCollection(CollectionSystemData* sysData);
+	void populateAutoCollections(const std::vector<CollectionSystemData*>& collections); // fills all collections with one pass over the games
 	bool deleteCustomCollection(CollectionSystemData* data);
 
 	bool isCustomCollection(const std::string collectionName);
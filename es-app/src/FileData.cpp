@@ -28,6 +28,7 @@
 #include "RetroAchievements.h"
 #include "SaveStateRepository.h"
 #include "Genres.h"
+#include "NetPlayIndex.h"
 #include "TextToSpeech.h"
 #include "LocaleES.h"
 #include "guis/GuiMsgBox.h"
@@ -35,15 +36,22 @@
 #include "resources/TextureData.h"
 
 FileData* FileData::mRunningGame = nullptr;
+std::atomic<unsigned int> FolderData::sTreeVersion(0);
 
 FileData::FileData(FileType type, const std::string& path, SystemData* system)
-	: mPath(path), mType(type), mSystem(system), mParent(nullptr), mDisplayName(nullptr), mMetadata(type == GAME ? GAME_METADATA : FOLDER_METADATA) // metadata is REALLY set in the constructor!
+	: mPath(path), mType(type), mSystem(system), mParent(nullptr), mDisplayName(nullptr), mMetadata(new MetaDataList(type == GAME ? GAME_METADATA : FOLDER_METADATA)) // metadata is REALLY set in the constructor!
 {
 	// metadata needs at least a name field (since that's what getName() will return)
-	if (mMetadata.get(MetaDataId::Name).empty() && !mPath.empty())
-		mMetadata.set(MetaDataId::Name, getDisplayName());
+	if (mMetadata->get(MetaDataId::Name).empty() && !mPath.empty())
+		mMetadata->set(MetaDataId::Name, getDisplayName());
 	
-	mMetadata.resetChangedFlag();
+	mMetadata->resetChangedFlag();
+}
+
+FileData::FileData(FileType type, SystemData* system)
+	: mType(type), mSystem(system), mParent(nullptr), mDisplayName(nullptr)
+{
+
 }
 
 const std::string FileData::getPath() const
@@ -231,12 +239,12 @@ bool FileData::hasAnyMedia()
 	if (Utils::FileSystem::exists(getImagePath()) || Utils::FileSystem::exists(getThumbnailPath()) || Utils::FileSystem::exists(getVideoPath()))
 		return true;
 
-	for (auto mdd : mMetadata.getMDD())
+	for (auto mdd : MetaDataList::getMDD())
 	{
 		if (mdd.type != MetaDataType::MD_PATH)
 			continue;
 
-		std::string path = mMetadata.get(mdd.key);
+		std::string path = getMetadata().get(mdd.key);
 		if (path.empty())
 			continue;
 
@@ -262,7 +270,7 @@ std::vector<std::string> FileData::getFileMedias()
 {
 	std::vector<std::string> ret;
 
-	for (auto mdd : mMetadata.getMDD())
+	for (auto mdd : MetaDataList::getMDD())
 	{
 		if (mdd.type != MetaDataType::MD_PATH)
 			continue;
@@ -270,7 +278,7 @@ std::vector<std::string> FileData::getFileMedias()
 		if (mdd.id == MetaDataId::Video || mdd.id == MetaDataId::Manual || mdd.id == MetaDataId::Magazine)
 			continue;
 
-		std::string path = mMetadata.get(mdd.key);
+		std::string path = getMetadata().get(mdd.key);
 		if (path.empty())
 			continue;
 
@@ -294,7 +302,7 @@ const std::string& FileData::getName()
 	if (mSystem != nullptr && mSystem->getShowFilenames())
 		return getDisplayName();
 
-	return mMetadata.getName();
+	return mMetadata->getName();
 }
 
 const std::string FileData::getVideoPath()
@@ -647,6 +655,7 @@ bool FileData::launchGame(Window* window, LaunchGameOptions options)
 	mRunningGame = gameToUpdate;
 
 	int exitCode = runSystemCommand(command, getDisplayName(), hideWindow ? NULL : window);
+	window->startFrameTimer("Return from game");
 	if (exitCode != 0)
 		LOG(LogWarning) << "...launch terminated with nonzero exit code " << exitCode << "!";
 
@@ -854,12 +863,12 @@ std::set<std::string> FileData::getContentFiles()
 
 void FileData::deleteGameFiles()
 {
-	for (auto mdd : mMetadata.getMDD())
+	for (auto mdd : MetaDataList::getMDD())
 	{
-		if (mMetadata.getType(mdd.id) != MetaDataType::MD_PATH)
+		if (mdd.type != MetaDataType::MD_PATH)
 			continue;
 
-		Utils::FileSystem::removeFile(mMetadata.get(mdd.id));
+		Utils::FileSystem::removeFile(getMetadata().get(mdd.id));
 	}
 
 	Utils::FileSystem::removeFile(getPath());
@@ -869,10 +878,9 @@ void FileData::deleteGameFiles()
 }
 
 CollectionFileData::CollectionFileData(FileData* file, SystemData* system)
-	: FileData(file->getSourceFileData()->getType(), "", system)
+	: FileData(file->getSourceFileData()->getType(), system)
 {
 	mSourceFileData = file->getSourceFileData();
-	mParent = NULL;	
 }
 
 SystemEnvironmentData* CollectionFileData::getSystemEnvData() const
@@ -970,7 +978,8 @@ const std::vector<FileData*> FolderData::getChildrenListToDisplay()
 
 		if (hiddenExts.size() > 0 && (*it)->getType() == GAME)
 		{
-			std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension((*it)->getFileName(), false));
+			std::string extlow = Utils::FileSystem::getExtension((*it)->getFileName(), false);
+			Utils::String::toLower(extlow, extlow);
 			if (std::find(hiddenExts.cbegin(), hiddenExts.cend(), extlow) != hiddenExts.cend())
 				continue;
 		}
@@ -1151,7 +1160,8 @@ void FolderData::getFilesRecursiveWithContext(std::vector<FileData*>& out, unsig
 
 					if (typeMask == GAME && filter->hiddenExtensions.size() > 0)
 					{
-						std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension(it->getFileName(), false));
+						std::string extlow = Utils::FileSystem::getExtension(it->getFileName(), false);
+						Utils::String::toLower(extlow, extlow);
 						if (filter->hiddenExtensions.find(extlow) != filter->hiddenExtensions.cend())
 							continue;
 					}
@@ -1218,6 +1228,7 @@ void FolderData::addChild(FileData* file, bool assignParent)
 #endif
 
 	mChildren.push_back(file);
+	sTreeVersion++;
 
 	if (assignParent)
 		file->setParent(this);	
@@ -1236,6 +1247,7 @@ void FolderData::removeChild(FileData* file)
 		{
 			file->setParent(NULL);
 			mChildren.erase(it);
+			sTreeVersion++;
 			return;
 		}
 	}
@@ -1418,9 +1430,9 @@ void FileData::detectLanguageAndRegion(bool overWrite)
 
 	auto info = LangInfo::parse(getSourceFileData()->getPath(), getSourceFileData()->getSystem());
 	if (info.languages.size() > 0)
-		mMetadata.set(MetaDataId::Language, info.getLanguageString());
+		getMetadata().set(MetaDataId::Language, info.getLanguageString());
 	if (!info.region.empty())
-		mMetadata.set(MetaDataId::Region, info.region);
+		getMetadata().set(MetaDataId::Region, info.region);
 }
 
 void FolderData::removeVirtualFolders()
@@ -1462,6 +1474,8 @@ void FileData::checkCrc32(bool force)
 	{
 		getMetadata().set(MetaDataId::Crc32, Utils::String::toUpper(crc));
 		saveToGamelistRecovery(this);
+
+		NetPlayIndex::updateCrc(this);
 	}
 }
 
@@ -1648,9 +1662,19 @@ void FolderData::clear()
 	if (mOwnsChildrens)
 	{
 		for (int i = mChildren.size() - 1; i >= 0; i--)
-			delete mChildren.at(i);
+		{
+			// Detached first : children would search themselves in mChildren when deleted
+			FileData* child = mChildren.at(i);
+			if (child->getParent() == this)
+				child->setParent(nullptr);
+
+			delete child;
+		}
 	}
 
+	if (!mChildren.empty())
+		sTreeVersion++;
+
 	mChildren.clear();
 }
 
@@ -1667,6 +1691,7 @@ void FolderData::removeFromVirtualFolders(FileData* game)
 		if ((*it) == game)
 		{
 			mChildren.erase(it);
+			sTreeVersion++;
 			return;
 		}
 	}
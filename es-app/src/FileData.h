@@ -132,8 +132,8 @@ public:
 
 	static void resetSettings();
 	
-	virtual const MetaDataList& getMetadata() const { return mMetadata; }
-	virtual MetaDataList& getMetadata() { return mMetadata; }
+	virtual const MetaDataList& getMetadata() const { return *mMetadata; }
+	virtual MetaDataList& getMetadata() { return *mMetadata; }
 
 	void setMetadata(MetaDataList value) { getMetadata() = value; } 
 	
@@ -170,9 +170,12 @@ public:
 private:
 	std::string getKeyboardMappingFilePath();
 	std::string getMessageFromExitCode(int exitCode);
-	MetaDataList mMetadata;
+	std::unique_ptr<MetaDataList> mMetadata;
 
 protected:	
+	// Proxies (collection entries) have no path nor metadata of their own : they forward to their source
+	FileData(FileType type, SystemData* system);
+
 	std::string  findLocalArt(const std::string& type = "", std::vector<std::string> exts = { ".png", ".jpg" });
 
 	static FileData* mRunningGame;
@@ -241,6 +244,9 @@ public:
 	void removeVirtualFolders();
 	void removeFromVirtualFolders(FileData* game);
 
+	// Incremented each time children are added or removed in any folder (used by the web api game index)
+	static unsigned int getTreeVersion() { return sTreeVersion; }
+
 private:
 	void getFilesRecursiveWithContext(std::vector<FileData*>& out, unsigned int typeMask, GetFileContext* filter, bool displayedOnly, SystemData* system, bool includeVirtualStorage) const;
 
@@ -248,6 +254,8 @@ private:
 	std::vector<FileData*> mChildren;
 	bool	mOwnsChildrens;
 	bool	mIsDisplayableAsVirtualFolder;
+
+	static std::atomic<unsigned int> sTreeVersion;
 };
 
 #endif // ES_APP_FILE_DATA_H
@@ -11,6 +11,7 @@
 #include "ImageIO.h"
 
 std::vector<MetaDataDecl> MetaDataList::mMetaDataDecls;
+std::atomic<unsigned int> MetaDataList::sChangeVersion(0);
 
 static std::map<MetaDataId, int> mMetaDataIndexes;
 static std::string* mDefaultGameMap = nullptr;
@@ -142,7 +143,7 @@ MetaDataId MetaDataList::getId(const std::string& key) const
 
 MetaDataList::MetaDataList(MetaDataListType type) : mType(type), mWasChanged(false), mRelativeTo(nullptr)
 {
-
+	bumpVersion();
 }
 
 void MetaDataList::loadFromXML(MetaDataListType type, pugi::xml_node& node, SystemData* system)
@@ -261,6 +262,8 @@ void MetaDataList::loadFromXML(MetaDataListType type, pugi::xml_node& node, Syst
 		else
 			set(mdd.id, value);
 	}
+
+	bumpVersion();
 }
 
 // Add migration for alternative formats & old tags
@@ -358,6 +361,7 @@ void MetaDataList::set(MetaDataId id, const std::string& value)
 
 		mName = value;
 		mWasChanged = true;
+		bumpVersion();
 		return;
 	}
 
@@ -378,6 +382,7 @@ void MetaDataList::set(MetaDataId id, const std::string& value)
 		mMap[id] = Utils::String::trim(value);
 
 	mWasChanged = true;
+	bumpVersion();
 }
 
 const std::string MetaDataList::get(MetaDataId id, bool resolveRelativePaths) const
@@ -549,6 +554,7 @@ void MetaDataList::setScrapeDate(const std::string& scraper)
 
 	mScrapeDates[it->second] = Utils::Time::DateTime::now();
 	mWasChanged = true;
+	bumpVersion();
 }
 
 Utils::Time::DateTime* MetaDataList::getScrapeDate(const std::string& scraper)
@@ -2,6 +2,7 @@
 #ifndef ES_APP_META_DATA_H
 #define ES_APP_META_DATA_H
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <functional>
@@ -161,8 +162,15 @@ public:
 	const void setDirty() 
 	{ 
 		mWasChanged = true; 
+		bumpVersion();
 	}
 
+	// Incremented each time any metadata list changes (used by the web api to know if a system has changed)
+	static unsigned int getChangeVersion() { return sChangeVersion; }
+
+	// Unique among all lists & changed each time this list changes : identifies a state of the list
+	inline unsigned int getVersion() const { return mVersion; }
+
 	inline MetaDataListType getType() const { return mType; }
 	static const std::vector<MetaDataDecl>& getMDD() { return mMetaDataDecls; }
 	inline const std::string& getName() const { return mName; }
@@ -184,6 +192,10 @@ private:
 	SystemData*		mRelativeTo;
 
 	static std::vector<MetaDataDecl> mMetaDataDecls;
+	static std::atomic<unsigned int> sChangeVersion;
+	unsigned int mVersion;
+
+	void bumpVersion() { mVersion = ++sChangeVersion; }
 
 	std::vector<std::tuple<std::string, std::string, bool>> mUnKnownElements;
 };
@@ -0,0 +1,214 @@
+#include "NetPlayIndex.h"
+#include "FileData.h"
+#include "MetaData.h"
+#include "SystemData.h"
+#include "Log.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+
+#include <algorithm>
+
+std::mutex NetPlayIndex::sLock;
+bool NetPlayIndex::sBuilt = false;
+unsigned int NetPlayIndex::sTreeVersion = 0;
+unsigned int NetPlayIndex::sChangeVersion = 0;
+
+std::unordered_map<std::string, FileData*> NetPlayIndex::sByCrc;
+std::unordered_map<std::string, std::vector<FileData*>> NetPlayIndex::sByName;
+std::unordered_map<std::string, std::vector<FileData*>> NetPlayIndex::sByCompactName;
+std::vector<NetPlayIndex::IndexedFile> NetPlayIndex::sFiles;
+
+std::string NetPlayIndex::normalizeName(const std::string& name)
+{
+	auto ret = Utils::String::toLower(name);
+	ret = Utils::String::replace(ret, "_", " ");
+	ret = Utils::String::replace(ret, ".", "");
+	ret = Utils::String::replace(ret, "'", "");
+	return Utils::String::removeParenthesis(ret);
+}
+
+void NetPlayIndex::add(std::unordered_map<std::string, std::vector<FileData*>>& map, const std::string& key, FileData* file)
+{
+	auto& files = map[key];
+	if (files.empty() || files.back() != file)
+		files.push_back(file);
+}
+
+void NetPlayIndex::remove(std::unordered_map<std::string, std::vector<FileData*>>& map, const std::string& key, FileData* file)
+{
+	auto it = map.find(key);
+	if (it == map.cend())
+		return;
+
+	auto& files = it->second;
+	files.erase(std::remove(files.begin(), files.end(), file), files.end());
+
+	if (files.empty())
+		map.erase(it);
+}
+
+void NetPlayIndex::addCrc(FileData* file)
+{
+	auto crc = file->getMetadata(MetaDataId::Crc32);
+	if (crc.empty())
+		return;
+
+	auto it = sByCrc.find(crc);
+	if (it == sByCrc.cend())
+		sByCrc[crc] = file;
+	else if (it->second->getMetadata(MetaDataId::Crc32) != crc)
+		it->second = file;
+}
+
+void NetPlayIndex::refresh()
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	unsigned int treeVersion = FolderData::getTreeVersion();
+	unsigned int changeVersion = MetaDataList::getChangeVersion();
+
+	if (sBuilt && sTreeVersion == treeVersion)
+	{
+		if (sChangeVersion != changeVersion)
+			updateChangedFiles();
+
+		sChangeVersion = changeVersion;
+		return;
+	}
+
+	sByCrc.clear();
+	sByName.clear();
+	sByCompactName.clear();
+	sFiles.clear();
+
+	for (auto sys : SystemData::sSystemVector)
+	{
+		if (!sys->isNetplaySupported())
+			continue;
+
+		for (auto file : sys->getRootFolder()->getFilesRecursive(GAME))
+		{
+			addCrc(file);
+
+			std::string name = normalizeName(file->getName());
+			add(sByName, name, file);
+			add(sByName, normalizeName(Utils::FileSystem::getStem(file->getPath())), file);
+			add(sByCompactName, Utils::String::replace(name, " ", ""), file);
+
+			sFiles.push_back(IndexedFile(file, file->getMetadata().getVersion(), name));
+		}
+	}
+
+	sBuilt = true;
+	sTreeVersion = treeVersion;
+	sChangeVersion = changeVersion;
+
+	LOG(LogDebug) << "NetPlayIndex : " << sByCrc.size() << " crc32, " << sByName.size() << " names";
+}
+
+// Games were edited, but none was added or removed : only the games whose metadata changed are indexed again
+void NetPlayIndex::updateChangedFiles()
+{
+	for (auto& indexed : sFiles)
+	{
+		FileData* file = indexed.file;
+
+		unsigned int version = file->getMetadata().getVersion();
+		if (version == indexed.version)
+			continue;
+
+		indexed.version = version;
+
+		addCrc(file);
+
+		std::string name = normalizeName(file->getName());
+		if (name == indexed.name)
+			continue;
+
+		remove(sByName, indexed.name, file);
+		remove(sByCompactName, Utils::String::replace(indexed.name, " ", ""), file);
+
+		add(sByName, name, file);
+		add(sByName, normalizeName(Utils::FileSystem::getStem(file->getPath())), file);
+		add(sByCompactName, Utils::String::replace(name, " ", ""), file);
+
+		indexed.name = name;
+	}
+}
+
+FileData* NetPlayIndex::findByCrc(const std::string& crc)
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	auto it = sByCrc.find(crc);
+	if (it == sByCrc.cend())
+		return nullptr;
+
+	// The CRC32 may have been recomputed since it was indexed
+	if (it->second->getMetadata(MetaDataId::Crc32) != crc)
+		return nullptr;
+
+	return it->second;
+}
+
+FileData* NetPlayIndex::findByName(const std::string& name, const std::string& lowCore)
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	std::unordered_map<SystemData*, bool> systemHasCore;
+
+	auto findInSystemWithCore = [&systemHasCore, &lowCore](const std::unordered_map<std::string, std::vector<FileData*>>& map, const std::string& key) -> FileData*
+	{
+		auto it = map.find(key);
+		if (it == map.cend())
+			return nullptr;
+
+		for (auto file : it->second)
+		{
+			SystemData* sys = file->getSystem();
+
+			auto hasCore = systemHasCore.find(sys);
+			if (hasCore == systemHasCore.cend())
+			{
+				bool coreExists = false;
+
+				for (auto& emul : sys->getEmulators())
+					for (auto& core : emul.cores)
+						if (Utils::String::toLower(core.name) == lowCore)
+							coreExists = true;
+
+				hasCore = systemHasCore.emplace(sys, coreExists).first;
+			}
+
+			if (hasCore->second)
+				return file;
+		}
+
+		return nullptr;
+	};
+
+	std::string normalizedName = normalizeName(name);
+
+	FileData* file = findInSystemWithCore(sByName, normalizedName);
+	if (file == nullptr)
+		file = findInSystemWithCore(sByCompactName, Utils::String::replace(normalizedName, " ", ""));
+
+	return file;
+}
+
+void NetPlayIndex::updateCrc(FileData* file)
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	if (!sBuilt || file->getSystem() == nullptr || !file->getSystem()->isNetplaySupported())
+		return;
+
+	// Games were added or removed since the index was built : indexed files may be deleted, refresh() builds it again
+	if (sTreeVersion != FolderData::getTreeVersion())
+	{
+		sBuilt = false;
+		return;
+	}
+
+	addCrc(file);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef ES_APP_NETPLAY_INDEX_H
+#define ES_APP_NETPLAY_INDEX_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FileData;
+
+// Games of the netplay systems by CRC32 & by normalized name, to match the lobby rooms without scanning every game per room.
+// Rebuilt when games were added or removed. Edited games are indexed again one by one, and CRC32s are added as they are computed.
+class NetPlayIndex
+{
+public:
+	// Rebuilds the index if games were added or removed since the last call, indexes the edited games again otherwise
+	static void refresh();
+
+	// Game having this CRC32 (uppercase), or nullptr
+	static FileData* findByCrc(const std::string& crc);
+
+	// Game having this name or file name, in a system having this core (lowercase), or nullptr
+	static FileData* findByName(const std::string& name, const std::string& lowCore);
+
+	// Called once the CRC32 of a game is computed
+	static void updateCrc(FileData* file);
+
+	static std::string normalizeName(const std::string& name);
+
+private:
+	struct IndexedFile
+	{
+		IndexedFile(FileData* f, unsigned int v, const std::string& n) : file(f), version(v), name(n) { }
+
+		FileData* file;
+		unsigned int version;	// of the metadata list when the game was indexed
+		std::string name;		// normalized name when the game was indexed
+	};
+
+	static void add(std::unordered_map<std::string, std::vector<FileData*>>& map, const std::string& key, FileData* file);
+	static void remove(std::unordered_map<std::string, std::vector<FileData*>>& map, const std::string& key, FileData* file);
+	static void addCrc(FileData* file);
+	static void updateChangedFiles();
+
+	static std::mutex sLock;
+	static bool sBuilt;
+	static unsigned int sTreeVersion;
+	static unsigned int sChangeVersion;
+
+	static std::unordered_map<std::string, FileData*> sByCrc;
+	static std::unordered_map<std::string, std::vector<FileData*>> sByName;			// normalized name or file name
+	static std::unordered_map<std::string, std::vector<FileData*>> sByCompactName;	// normalized name without spaces
+	static std::vector<IndexedFile> sFiles;
+};
+
+#endif // ES_APP_NETPLAY_INDEX_H
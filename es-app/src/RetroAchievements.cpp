@@ -439,76 +439,6 @@ RetroAchievementInfo RetroAchievements::toRetroAchivementInfo(UserSummary& ret)
 	return info;
 }
 
-std::map<std::string, std::string> RetroAchievements::getCheevosHashes()
-{
-	std::map<std::string, std::string> ret;
-
-	try
-	{
-		std::map<int, std::string> officialGames;
-
-		HttpReq hashLibrary("https://retroachievements.org/dorequest.php?r=hashlibrary");
-		HttpReq officialGamesList("https://retroachievements.org/dorequest.php?r=officialgameslist");
-
-		// Official games
-		if (officialGamesList.wait())
-		{
-			rapidjson::Document ogdoc;
-			ogdoc.Parse(officialGamesList.getContent().c_str());
-			if (ogdoc.HasParseError())
-				return ret;
-
-			if (!ogdoc.HasMember("Response"))
-				return ret;
-
-			const rapidjson::Value& response = ogdoc["Response"];
-			for (auto it = response.MemberBegin(); it != response.MemberEnd(); ++it)
-			{
-				int gameId = Utils::String::toInteger(it->name.GetString());
-
-				if (it->value.GetType() == rapidjson::Type::kStringType)
-					officialGames[gameId] = it->value.GetString();
-				else if (it->value.GetType() == rapidjson::Type::kNumberType)
-					officialGames[gameId] = std::to_string(it->value.GetInt());
-			}
-		}
-
-		// Hash library
-		if (hashLibrary.wait())
-		{
-			rapidjson::Document doc;
-			doc.Parse(hashLibrary.getContent().c_str());
-			if (doc.HasParseError())
-				return ret;
-
-			if (!doc.HasMember("MD5List"))
-				return ret;
-
-			const rapidjson::Value& mdlist = doc["MD5List"];
-			for (auto it = mdlist.MemberBegin(); it != mdlist.MemberEnd(); ++it)
-			{
-				std::string name = Utils::String::toUpper(it->name.GetString());
-
-				if (!it->value.IsInt())
-					continue;
-
-				int gameId = it->value.GetInt();
-
-				if (officialGames.find(gameId) == officialGames.cend())
-					continue;
-
-				ret[name] = std::to_string(gameId);
-			}
-		}
-	}
-	catch (...)
-	{
-
-	}
-
-	return ret;
-}
-
 std::string RetroAchievements::getCheevosHashFromFile(int consoleId, const std::string fileName)
 {
 	LOG(LogDebug) << "getCheevosHashFromFile : " << fileName;
@@ -196,8 +196,6 @@ public:
 	static GameInfoAndUserProgress	getGameInfoAndUserProgress(int gameId, const std::string userName = "");
 	static RetroAchievementInfo		toRetroAchivementInfo(UserSummary& ret);
 
-	static std::map<std::string, std::string>	getCheevosHashes();
-
 	static std::string				getCheevosHash(SystemData* pSystem, const std::string fileName);
 	static bool						testAccount(const std::string& username, const std::string& password, std::string& tokenOrError);
 
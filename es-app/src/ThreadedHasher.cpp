@@ -5,6 +5,7 @@
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
 #include "RetroAchievements.h"
+#include "CheevosHashLibrary.h"
 #include "SystemConf.h"
 #include "SystemData.h"
 #include "FileData.h"
@@ -24,7 +25,7 @@ bool ThreadedHasher::mPaused = false;
 static std::mutex mLoaderLock;
 
 ThreadedHasher::ThreadedHasher(Window* window, HasherType type, std::queue<FileData*> searchQueue, bool forceAllGames)
-	: mWindow(window)
+	: mWindow(window), mLibraryRefreshThread(nullptr)
 {
 	mForce = forceAllGames;
 	mExit = false;
@@ -37,8 +38,14 @@ ThreadedHasher::ThreadedHasher(Window* window, HasherType type, std::queue<FileD
 
 	if ((mType & HASH_CHEEVOS_MD5) == HASH_CHEEVOS_MD5)
 	{
-		mCheevosHashes = RetroAchievements::getCheevosHashes();
-		if (mCheevosHashes.size() == 0)
+		// Start with the local library, and check for changes while hashing. The library is only downloaded & awaited the first time.
+		mCheevosLibrary = CheevosHashLibrary::load();
+		if (mCheevosLibrary != nullptr)
+			mLibraryRefreshThread = new std::thread([] { CheevosHashLibrary::refresh(); });
+		else if (CheevosHashLibrary::refresh())
+			mCheevosLibrary = CheevosHashLibrary::load();
+
+		if (mCheevosLibrary == nullptr || mCheevosLibrary->size() == 0)
 			while (!mSearchQueue.empty())
 				mSearchQueue.pop();
 	}
@@ -65,6 +72,12 @@ ThreadedHasher::~ThreadedHasher()
 	mWndNotification->close();
 	mWndNotification = nullptr;
 
+	if (mLibraryRefreshThread != nullptr)
+	{
+		mLibraryRefreshThread->join();
+		delete mLibraryRefreshThread;
+	}
+
 	ThreadedHasher::mInstance = nullptr;
 }
 
@@ -125,9 +138,9 @@ void ThreadedHasher::run()
 			auto hash = Utils::String::toUpper(game->getMetadata(MetaDataId::CheevosHash));
 			if (!hash.empty())
 			{
-				auto cheevos = mCheevosHashes.find(hash);
-				if (cheevos != mCheevosHashes.cend())
-					game->setMetadata(MetaDataId::CheevosId, cheevos->second);
+				int gameId = mCheevosLibrary->getGameId(hash);
+				if (gameId != 0)
+					game->setMetadata(MetaDataId::CheevosId, std::to_string(gameId));
 				else
 					game->setMetadata(MetaDataId::CheevosId, "");
 			}
@@ -6,6 +6,7 @@
 #include "components/AsyncNotificationComponent.h"
 
 class FileData;
+class CheevosHashLibrary;
 
 class ThreadedHasher
 {
@@ -39,7 +40,8 @@ private:
 	std::string		mCurrentAction;
 
 	std::vector<std::string> mErrors;
-	std::map<std::string, std::string>    mCheevosHashes;
+	std::shared_ptr<CheevosHashLibrary>	mCheevosLibrary;
+	std::thread*						mLibraryRefreshThread;
 
 	HasherType mType;
 
@@ -267,13 +267,9 @@ private:
 	bool	 mLocked;
 };
 
-static bool g_isGuiImageViewerRunning = false;
-
 GuiImageViewer::GuiImageViewer(Window* window, bool linearSmooth) :
-	GuiComponent(window), mGrid(window), mPdfThreads(nullptr)
+	GuiComponent(window), mGrid(window), mLinearSmooth(linearSmooth), mPrefetchCursor(-1)
 {
-	g_isGuiImageViewerRunning = true;
-
 	setPosition(0, 0);
 	setSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
 		
@@ -326,10 +322,17 @@ GuiImageViewer::GuiImageViewer(Window* window, bool linearSmooth) :
 	animateTo(Vector2f(0, Renderer::getScreenHeight()), Vector2f(0, 0));
 }
 
-void GuiImageViewer::loadPdf(const std::string& imagePath)
+// Pages are decoded by the texture loader threads, only around the cursor
+#define PREFETCH_PAGES	2
+
+std::string GuiImageViewer::getPagePath(int page)
 {
-	Window* window = mWindow;
+	// Decoded page by page by TextureData, directly from the document
+	return mPdf + "," + std::to_string(page);
+}
 
+void GuiImageViewer::loadPdf(const std::string& imagePath)
+{
 	int pages = ApiSystem::getInstance()->getPdfPageCount(imagePath);
 	if (pages == 0)
 	{
@@ -337,82 +340,12 @@ void GuiImageViewer::loadPdf(const std::string& imagePath)
 		return;
 	}
 
-#define INITIALPAGES	1
-#define PAGESPERTHREAD  1
-
 	mPdf = imagePath;
 	
 	for (int i = 0; i < pages; i++)
-		mGrid.add("", ":/blank.png", "", "", false, false, false, false, std::to_string(i + 1));
-	
-	if (pages > INITIALPAGES)
-	{
-		mPdfThreads = new Utils::ThreadPool(1);
-
-		for (int i = INITIALPAGES; i < pages; i += PAGESPERTHREAD)
-		{
-			mPdfThreads->queueWorkItem([this, imagePath, window, i]
-			{
-				auto fl = ApiSystem::getInstance()->extractPdfImages(imagePath, i + 1, PAGESPERTHREAD);
-				if (fl.size() == 0 || !g_isGuiImageViewerRunning)
-					return;
-
-				window->postToUiThread([this, i, fl]()
-				{
-					if (!g_isGuiImageViewerRunning)
-						return;
-
-					for (int f = 0; f < fl.size(); f++)
-					{
-						auto img = fl[f];
-						ImageIO::removeImageCache(img);
-						mGrid.setImage(img, std::to_string(i + 1 + f));
-					}
-				});
-			});
-		}
+		mGrid.add("", getPagePath(i), "", "", false, false, false, false, std::to_string(i + 1));
 
-		mPdfThreads->start();
-	}
-	
-	window->pushGui(new GuiLoading<std::vector<std::string>>(window, _("Loading..."),
-		[window, imagePath](auto gui)
-		{		
-			return ApiSystem::getInstance()->extractPdfImages(imagePath, 1, INITIALPAGES);
-		},
-			[this, window, imagePath, pages](std::vector<std::string> fileList)
-		{
-			if (fileList.size() == 0)
-				return;
-		
-			for (int i = 0; i < fileList.size(); i++)
-			{
-				ImageIO::removeImageCache(fileList[i]);
-				mGrid.setImage(fileList[i], std::to_string(i + 1));
-			}
-
-			window->pushGui(this);
-		}));
-}
-
-static std::string _extractZipFile(const std::string& zipFileName, const std::string& fileToExtract)
-{
-	auto pdfFolder = Utils::FileSystem::getPdfTempPath();
-
-	Utils::Zip::ZipFile zipFile;
-	if (zipFile.load(zipFileName))
-	{
-		std::string fullPath = Utils::FileSystem::combine(pdfFolder, fileToExtract);
-		std::string folder = Utils::FileSystem::getParent(fullPath);
-		if (folder != pdfFolder)
-			Utils::FileSystem::createDirectory(folder);
-
-		if (zipFile.extract(fileToExtract, fullPath, true))
-			if (Utils::FileSystem::exists(fullPath))
-				return fullPath;
-	}
-
-	return "";
+	mWindow->pushGui(this);
 }
 
 void GuiImageViewer::loadImages(std::vector<std::string>& images)
@@ -436,15 +369,7 @@ void GuiImageViewer::loadImages(std::vector<std::string>& images)
 
 void GuiImageViewer::loadCbz(const std::string& imagePath)
 {
-	auto pdfFolder = Utils::FileSystem::getPdfTempPath();
-	Utils::FileSystem::createDirectory(pdfFolder);
-	Utils::FileSystem::deleteDirectoryFiles(pdfFolder);
-
-	Window* window = mWindow;
-
-	std::vector<std::string> files;
-	std::vector<std::wstring> filesW;
-	
+	int pages = 0;
 
 	try
 	{
@@ -460,10 +385,8 @@ void GuiImageViewer::loadCbz(const std::string& imagePath)
 				if (Utils::String::startsWith(file, "__"))
 					continue;
 
-				files.push_back(file);
+				pages++;
 			}
-
-			std::sort(files.begin(), files.end(), [](std::string a, std::string b) { return Utils::String::toLower(a) < Utils::String::toLower(b); });
 		}
 	}
 	catch (...)
@@ -473,89 +396,65 @@ void GuiImageViewer::loadCbz(const std::string& imagePath)
 		return;
 	}
 
-	int pages = files.size();
 	if (pages == 0)
 	{
 		delete this;
 		return;
 	}
 
-#define INITIALPAGES	1
-
 	mPdf = imagePath;
 
 	for (int i = 0; i < pages; i++)
-		mGrid.add("", ":/blank.png", "", "", false, false, false, false, std::to_string(i + 1));
-
-	if (pages > INITIALPAGES)
-	{
-		mPdfThreads = new Utils::ThreadPool(1);
+		mGrid.add("", getPagePath(i), "", "", false, false, false, false, std::to_string(i + 1));
 
-		for (int i = INITIALPAGES; i < pages; i += PAGESPERTHREAD)
-		{
-			auto fileToExtract = files[i];
-			mPdfThreads->queueWorkItem([this, imagePath, fileToExtract, window, i]
-			{
-				auto localFile = _extractZipFile(imagePath, fileToExtract);
-				if (localFile.empty() || !g_isGuiImageViewerRunning)
-					return;
+	mWindow->pushGui(this);
+}
 
-				window->postToUiThread([this, i, localFile]()
-				{
-					if (!g_isGuiImageViewerRunning)
-						return;
+void GuiImageViewer::update(int deltaTime)
+{
+	GuiComponent::update(deltaTime);
 
-					ImageIO::removeImageCache(localFile);
-					mGrid.setImage(localFile, std::to_string(i + 1));
-				});
-			});
-		}
+	if (!mPdf.empty() && mGrid.getCursorIndex() != mPrefetchCursor)
+		prefetchPages();
+}
 
-		mPdfThreads->start();
-	}
+void GuiImageViewer::prefetchPages()
+{
+	mPrefetchCursor = mGrid.getCursorIndex();
 
-	window->pushGui(new GuiLoading<std::vector<std::string>>(window, _("Loading..."),
-		[window, imagePath, files](auto gui)
-		{
-			std::vector<std::string> ret;
+	int count = mGrid.size();
+	if (count == 0 || mPrefetchCursor < 0)
+		return;
 
-			for (int i = 0; i < INITIALPAGES && i < files.size(); i++)
-			{
-				auto fileToExtract = files[i];
+	MaxSizeInfo maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
 
-				auto localFile = _extractZipFile(imagePath, fileToExtract);
-				if (!localFile.empty())
-					ret.push_back(localFile);
-			}
+	// Pages out of the window are released, the texture manager keeps the decoded ones within MaxVRAM.
+	// Farthest pages are requested first : the loader threads start with the most recent requests
+	std::map<int, std::shared_ptr<TextureResource>> prefetched;
 
-			return ret;
-		},
-		[this, window, imagePath, pages](std::vector<std::string> fileList)
+	for (int distance = PREFETCH_PAGES; distance > 0; distance--)
+	{
+		for (int page : { mPrefetchCursor - distance, mPrefetchCursor + distance })
 		{
-			if (fileList.size() == 0)
-				return;
-
-			for (int i = 0; i < fileList.size(); i++)
-			{
-				ImageIO::removeImageCache(fileList[i]);
-				mGrid.setImage(fileList[i], std::to_string(i + 1));
-			}
-
-			window->pushGui(this);
+			// The grid loops
+			page = (page + count) % count;
+			if (page == mPrefetchCursor || prefetched.find(page) != prefetched.cend())
+				continue;
+
+			auto it = mPrefetched.find(page);
+			if (it != mPrefetched.cend())
+				prefetched[page] = it->second;
+			else
+				prefetched[page] = TextureResource::get(getPagePath(page), false, mLinearSmooth, false, true, true, &maxSize);
 		}
-	));
-}
+	}
 
+	mPrefetched = prefetched;
+}
 
 GuiImageViewer::~GuiImageViewer()
 {
-	g_isGuiImageViewerRunning = false;
-
-	if (mPdfThreads != nullptr)
-	{
-		mPdfThreads->stop();
-		delete mPdfThreads;
-	}
+	mPrefetched.clear();
 
 	auto pdfFolder = Utils::FileSystem::getPdfTempPath();
 	Utils::FileSystem::deleteDirectoryFiles(pdfFolder, true);
@@ -3,7 +3,6 @@
 #include "GuiComponent.h"
 #include "Window.h"
 #include "components/ImageGridComponent.h"
-#include "utils/ThreadPool.h"
 
 class ThemeData;
 class VideoComponent;
@@ -20,6 +19,7 @@ public:
 	~GuiImageViewer();
 
 	bool input(InputConfig* config, Input input) override;
+	void update(int deltaTime) override;
 	virtual std::vector<HelpPrompt> getHelpPrompts() override;
 
 	void add(const std::string imagePath);
@@ -30,11 +30,16 @@ protected:
 	void loadCbz(const std::string& imagePath);
 	void loadImages(std::vector<std::string>& images);
 
+	std::string getPagePath(int page);
+	void prefetchPages();
+
 	ImageGridComponent<std::string> mGrid;
 	std::shared_ptr<ThemeData> mTheme;
 	std::string mPdf;
+	bool mLinearSmooth;
 
-	Utils::ThreadPool* mPdfThreads;
+	int mPrefetchCursor;
+	std::map<int, std::shared_ptr<TextureResource>> mPrefetched;
 };
 
 class GuiVideoViewer : public GuiComponent
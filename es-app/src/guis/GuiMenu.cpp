@@ -799,6 +799,12 @@ void GuiMenu::openDeveloperSettings()
 	optimizeVideo->setState(Settings::getInstance()->getBool("OptimizeVideo"));
 	s->addWithLabel(_("OPTIMIZE VIDEO VRAM USAGE"), optimizeVideo);
 	s->addSaveFunc([optimizeVideo] { Settings::getInstance()->setBool("OptimizeVideo", optimizeVideo->getState()); });
+
+	// videoHalfResolution
+	auto videoHalfResolution = std::make_shared<SwitchComponent>(mWindow);
+	videoHalfResolution->setState(Settings::getInstance()->getBool("VideoHalfResolution"));
+	s->addWithLabel(_("DECODE SMALL VIDEOS AT HALF RESOLUTION"), videoHalfResolution);
+	s->addSaveFunc([videoHalfResolution] { Settings::getInstance()->setBool("VideoHalfResolution", videoHalfResolution->getState()); });
 	
 	s->onFinalize([s, window]
 	{
@@ -17,6 +17,7 @@
 #include "guis/GuiSettings.h"
 #include "guis/GuiTextEditPopup.h"
 #include "guis/GuiTextEditPopupKeyboard.h"
+#include "NetPlayIndex.h"
 
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/pointer.h>
@@ -150,7 +151,12 @@ GuiNetPlay::GuiNetPlay(Window* window)
 	mBusyAnim(window),
 	mBackground(window, ":/frame.png"),
 	mGrid(window, Vector2i(1, 3)),
-	mList(nullptr)
+	mList(nullptr),
+	mMatchingThread(nullptr),
+	mMatchingExit(false),
+	mMatchingDone(false),
+	mGroupAvailable(false),
+	mGroupUnavailable(false)
 {	
 	addChild(&mBackground);
 	addChild(&mGrid);
@@ -215,6 +221,11 @@ GuiNetPlay::GuiNetPlay(Window* window)
 	startRequest();
 }
 
+GuiNetPlay::~GuiNetPlay()
+{
+	stopMatching();
+}
+
 void GuiNetPlay::onSizeChanged()
 {
 	GuiComponent::onSizeChanged();
@@ -240,6 +251,7 @@ void GuiNetPlay::startRequest()
 	if (mLobbyRequest != nullptr)
 		return;
 
+	stopMatching();
 	mList->clear();
 
 	std::string netPlayLobby = SystemConf::getInstance()->get("global.netplay.lobby");
@@ -259,15 +271,19 @@ void GuiNetPlay::update(int deltaTime)
 		if (status != HttpReq::REQ_IN_PROGRESS)
 		{			
 			if (status == HttpReq::REQ_SUCCESS)
-				populateFromJson(mLobbyRequest->getContent());
+				startMatching(mLobbyRequest->getContent());
 			else
 			  mWindow->pushGui(new GuiMsgBox(mWindow, _("FAILED") + std::string(" : ") + mLobbyRequest->getErrorMsg()));
 
 			mLobbyRequest.reset();
 		}
+	}
+
+	if (mMatchingThread != nullptr)
+		addMatchedEntries();
 
+	if (mLobbyRequest || (mMatchingThread != nullptr && mList->size() == 0))
 		mBusyAnim.update(deltaTime);
-	}
 }
 
 bool GuiNetPlay::input(InputConfig* config, Input input)
@@ -290,73 +306,6 @@ std::vector<HelpPrompt> GuiNetPlay::getHelpPrompts()
 }
 
 
-FileData* GuiNetPlay::getFileData(std::string gameInfo, bool crc, std::string coreName)
-{
-	auto normalizeName = [](const std::string name)
-	{
-		auto ret = Utils::String::toLower(name);
-		ret = Utils::String::replace(ret, "_", " ");
-		ret = Utils::String::replace(ret, ".", "");
-		ret = Utils::String::replace(ret, "'", "");
-		return Utils::String::removeParenthesis(ret);
-	};
-
-	std::string lowCore;
-
-	auto coreInfo = coreList.find(coreName);
-	if (coreInfo != coreList.cend())
-		lowCore = Utils::String::toLower(coreInfo->second);
-	else
-		lowCore = Utils::String::toLower(Utils::String::replace(coreName, " ", "_"));
-	
-	std::string normalizedName = normalizeName(gameInfo);
-	for (auto sys : SystemData::sSystemVector)
-	{
-		if (!sys->isNetplaySupported())
-			continue;
-
-		if (!crc)
-		{
-			bool coreExists = false;
-
-			for (auto& emul : sys->getEmulators())
-				for (auto& core : emul.cores)
-					if (Utils::String::toLower(core.name) == lowCore)
-						coreExists = true;
-
-			if (!coreExists)
-				continue;
-		}
-
-		for (auto file : sys->getRootFolder()->getFilesRecursive(GAME))
-		{
-			if (crc)
-			{
-				if (file->getMetadata(MetaDataId::Crc32) == gameInfo)
-					return file;
-
-				continue;
-			}
-			else
-			{
-				std::string stem = normalizeName(file->getName());
-				if (stem == normalizedName)
-					return file;
-
-				stem = normalizeName(Utils::FileSystem::getStem(file->getPath()));
-				if (stem == normalizedName)
-					return file;
-
-				stem = Utils::String::replace(normalizeName(file->getName()), " ", "");
-				if (stem == Utils::String::replace(normalizedName, " ", ""))
-					return file;
-			}
-		}
-	}
-
-	return nullptr;
-}
-
 class NetPlayLobbyListEntry : public ComponentGrid
 {
 public:
@@ -485,164 +434,231 @@ private:
 };
 
 
-bool GuiNetPlay::populateFromJson(const std::string json)
+static void parseLobbyEntry(const rapidjson::Value& fields, LobbyAppEntry& game)
 {
-	rapidjson::Document doc;
-	doc.Parse(json.c_str());
-
-	if (doc.HasParseError())
-	{
-		std::string err = std::string("GuiNetPlay - Error parsing JSON. \n\t");		
-		LOG(LogError) << err;
-		return false;
-	}
+	game.fileData = nullptr;
+	game.isCrcValid = false;
+	game.coreExists = false;
 
-	std::vector<LobbyAppEntry> entries;
+	if (fields.HasMember("core_name") && fields["core_name"].IsString())
+		game.core_name = fields["core_name"].GetString();
 
-	for (auto& item : doc.GetArray())
-	{
-		if (!item.HasMember("fields"))
-			continue;
+	if (fields.HasMember("username") && fields["username"].IsString())
+		game.username = fields["username"].GetString();
 
-		const rapidjson::Value& fields = item["fields"];
-		//if (fields.HasMember("has_password") && fields["has_password"].IsBool() && fields["has_password"].GetBool())
-	//		continue;
+	if (fields.HasMember("game_crc") && fields["game_crc"].IsString())
+		game.game_crc = fields["game_crc"].GetString();
 
-		LobbyAppEntry game;	
-		game.isCrcValid = false;
+	if (fields.HasMember("mitm_ip") && fields["mitm_ip"].IsString())
+		game.mitm_ip = fields["mitm_ip"].GetString();
 
-		if (fields.HasMember("core_name") && fields["core_name"].IsString())
-			game.core_name = fields["core_name"].GetString();
+	if (fields.HasMember("subsystem_name") && fields["subsystem_name"].IsString())
+		game.subsystem_name = fields["subsystem_name"].GetString();
 
-		FileData* file = nullptr;
+	if (fields.HasMember("frontend") && fields["frontend"].IsString())
+		game.frontend = fields["frontend"].GetString();
 
-		if (fields.HasMember("game_crc") && fields["game_crc"].IsString() && fields["game_crc"] != "00000000")
-			file = getFileData(Utils::String::toUpper(fields["game_crc"].GetString()), true, game.core_name);
+	if (fields.HasMember("created") && fields["created"].IsString())
+		game.created = fields["created"].GetString();
 
-		if (file == nullptr && fields.HasMember("game_name") && fields["game_name"].IsString())
-		{
-			file = getFileData(fields["game_name"].GetString(), false, game.core_name);
-			if (file != nullptr)
-				file->checkCrc32();
-		}
+	if (fields.HasMember("ip") && fields["ip"].IsString())
+		game.ip = fields["ip"].GetString();
 
-		game.fileData = file;
+	if (fields.HasMember("updated") && fields["updated"].IsString())
+		game.updated = fields["updated"].GetString();
 
-		if (fields.HasMember("username") && fields["username"].IsString())
-			game.username = fields["username"].GetString();
+	if (fields.HasMember("country") && fields["country"].IsString())
+		game.country = fields["country"].GetString();
 
-		if (fields.HasMember("game_crc") && fields["game_crc"].IsString())
-			game.game_crc = fields["game_crc"].GetString();
+	if (fields.HasMember("host_method") && fields["host_method"].IsInt())
+		game.host_method = fields["host_method"].GetInt();
 
-		if (file != nullptr)
-		{
-			std::string fileCRC = file->getMetadata(MetaDataId::Crc32);
-			if (game.game_crc == fileCRC)
-				game.isCrcValid = true;
-		}
+	if (fields.HasMember("has_password") && fields["has_password"].IsBool())
+		game.has_password = fields["has_password"].GetBool();
 
-		if (fields.HasMember("mitm_ip") && fields["mitm_ip"].IsString())
-			game.mitm_ip = fields["mitm_ip"].GetString();
+	if (fields.HasMember("game_name") && fields["game_name"].IsString())
+		game.game_name = fields["game_name"].GetString();
 
-		if (fields.HasMember("subsystem_name") && fields["subsystem_name"].IsString())
-			game.subsystem_name = fields["subsystem_name"].GetString();
+	if (fields.HasMember("has_spectate_password") && fields["has_spectate_password"].IsBool())
+		game.has_spectate_password = fields["has_spectate_password"].GetBool();		
 
-		if (fields.HasMember("frontend") && fields["frontend"].IsString())
-			game.frontend = fields["frontend"].GetString();
+	if (fields.HasMember("mitm_port") && fields["mitm_port"].IsInt())
+		game.mitm_port = fields["mitm_port"].GetInt();
 
-		if (fields.HasMember("created") && fields["created"].IsString())
-			game.created = fields["created"].GetString();
+	if (fields.HasMember("fixed") && fields["fixed"].IsBool())
+		game.fixed = fields["fixed"].GetBool();
 
-		if (fields.HasMember("ip") && fields["ip"].IsString())
-			game.ip = fields["ip"].GetString();
+	if (fields.HasMember("retroarch_version") && fields["retroarch_version"].IsString())
+		game.retroarch_version = fields["retroarch_version"].GetString();
 
-		if (fields.HasMember("updated") && fields["updated"].IsString())
-			game.updated = fields["updated"].GetString();
+	if (fields.HasMember("port") && fields["port"].IsInt())
+		game.port = fields["port"].GetInt();
+}
 
-		if (fields.HasMember("country") && fields["country"].IsString())
-			game.country = fields["country"].GetString();
+void GuiNetPlay::startMatching(const std::string& json)
+{
+	stopMatching();
 
-		if (fields.HasMember("host_method") && fields["host_method"].IsInt())
-			game.host_method = fields["host_method"].GetInt();
+	mMatchingExit = false;
+	mMatchingDone = false;
+	mGroupAvailable = false;
+	mGroupUnavailable = false;
 
-		if (fields.HasMember("has_password") && fields["has_password"].IsBool())
-			game.has_password = fields["has_password"].GetBool();
+	mMatchingThread = new std::thread(&GuiNetPlay::matchLobbyEntries, this, json);
+}
 
-		if (fields.HasMember("game_name") && fields["game_name"].IsString())
-			game.game_name = fields["game_name"].GetString();
+void GuiNetPlay::stopMatching()
+{
+	if (mMatchingThread == nullptr)
+		return;
 
-		if (fields.HasMember("has_spectate_password") && fields["has_spectate_password"].IsBool())
-			game.has_spectate_password = fields["has_spectate_password"].GetBool();		
+	mMatchingExit = true;
+	mMatchingThread->join();
+	delete mMatchingThread;
+	mMatchingThread = nullptr;
 
-		if (fields.HasMember("mitm_port") && fields["mitm_port"].IsInt())
-			game.mitm_port = fields["mitm_port"].GetInt();
+	std::unique_lock<std::mutex> lock(mEntriesLock);
+	mPendingEntries.clear();
+}
 
-		if (fields.HasMember("fixed") && fields["fixed"].IsBool())
-			game.fixed = fields["fixed"].GetBool();
+void GuiNetPlay::pushEntries(std::vector<LobbyAppEntry>& entries)
+{
+	if (entries.empty())
+		return;
 
-		if (fields.HasMember("retroarch_version") && fields["retroarch_version"].IsString())
-			game.retroarch_version = fields["retroarch_version"].GetString();
+	std::unique_lock<std::mutex> lock(mEntriesLock);
+	mPendingEntries.insert(mPendingEntries.end(), entries.begin(), entries.end());
+	entries.clear();
+}
 
-		if (fields.HasMember("port") && fields["port"].IsInt())
-			game.port = fields["port"].GetInt();
+// Matching thread : rooms whose CRC32 is known come first (same rom), then rooms found by name (needs the CRC32 of the local rom, can be slow), then missing games
+void GuiNetPlay::matchLobbyEntries(const std::string json)
+{
+	rapidjson::Document doc;
+	doc.Parse(json.c_str());
 
-		game.coreExists = coreExists(file, game.core_name);
+	if (doc.HasParseError() || !doc.IsArray())
+	{
+		std::string err = std::string("GuiNetPlay - Error parsing JSON. \n\t");		
+		LOG(LogError) << err;
+		mMatchingDone = true;
+		return;
+	}
 
-		entries.push_back(game);
-	}	
+	NetPlayIndex::refresh();
 
-	auto theme = ThemeData::getMenuTheme();
+	std::vector<LobbyAppEntry> entries;
+	std::vector<LobbyAppEntry> byName;
 
-	bool groupAvailable = false;
+	for (auto& item : doc.GetArray())
+	{
+		if (mMatchingExit)
+			return;
 
-	struct { bool operator()(LobbyAppEntry& a, LobbyAppEntry& b) const 
-	{ 
-		if (a.isCrcValid == b.isCrcValid)
-			return a.coreExists && !b.coreExists;
+		if (!item.HasMember("fields"))
+			continue;
 
-		return a.isCrcValid && !b.isCrcValid;
-	} } sortByValidCrc;
+		LobbyAppEntry game;
+		parseLobbyEntry(item["fields"], game);
 
-	std::sort(entries.begin(), entries.end(), sortByValidCrc);
-	
-	bool netPlayShowMissingGames = Settings::NetPlayShowMissingGames();
+		if (!game.game_crc.empty() && game.game_crc != "00000000")
+			game.fileData = NetPlayIndex::findByCrc(Utils::String::toUpper(game.game_crc));
 
-	for (auto game : entries)
-	{
 		if (game.fileData == nullptr)
+		{
+			byName.push_back(game);
 			continue;
+		}
 
-		if (!netPlayShowMissingGames && !game.coreExists)
-			continue;
+		game.isCrcValid = (game.game_crc == game.fileData->getMetadata(MetaDataId::Crc32));
+		game.coreExists = coreExists(game.fileData, game.core_name);
+		entries.push_back(game);
+	}
 
-		if (netPlayShowMissingGames && !groupAvailable)
-		{			
-			mList->addGroup(_("AVAILABLE GAMES"), true);
-			groupAvailable = true;
+	std::stable_sort(entries.begin(), entries.end(), [](const LobbyAppEntry& a, const LobbyAppEntry& b) { return a.coreExists && !b.coreExists; });
+	pushEntries(entries);
+
+	std::vector<LobbyAppEntry> missing;
+
+	for (auto& game : byName)
+	{
+		if (mMatchingExit)
+			return;
+
+		FileData* file = nullptr;
+
+		if (!game.game_name.empty())
+		{
+			std::string lowCore;
+
+			auto coreInfo = coreList.find(game.core_name);
+			if (coreInfo != coreList.cend())
+				lowCore = Utils::String::toLower(coreInfo->second);
+			else
+				lowCore = Utils::String::toLower(Utils::String::replace(game.core_name, " ", "_"));
+
+			file = NetPlayIndex::findByName(game.game_name, lowCore);
 		}
-		
-		ComponentListRow row;
-		row.addElement(std::make_shared<NetPlayLobbyListEntry>(mWindow, game), true);
 
-		if (game.fileData != nullptr)
-			row.makeAcceptInputHandler([this, game] { launchGame(game); });
+		if (file == nullptr)
+		{
+			missing.push_back(game);
+			continue;
+		}
 
-		mList->addRow(row);
+		file->checkCrc32();
+
+		game.fileData = file;
+		game.isCrcValid = (game.game_crc == file->getMetadata(MetaDataId::Crc32));
+		game.coreExists = coreExists(file, game.core_name);
+		entries.push_back(game);
+		pushEntries(entries);
 	}
 
-	if (netPlayShowMissingGames)
+	pushEntries(missing);
+	mMatchingDone = true;
+}
+
+// UI thread : adds the rows matched since the last update
+void GuiNetPlay::addMatchedEntries()
+{
+	std::vector<LobbyAppEntry> entries;
+	bool matchingDone;
+
 	{
-		bool groupUnavailable = false;
+		// The matching thread pushes its last entries before setting mMatchingDone : once it is set, every entry is in this swap
+		std::unique_lock<std::mutex> lock(mEntriesLock);
+		entries.swap(mPendingEntries);
+		matchingDone = mMatchingDone;
+	}
 
-		for (auto game : entries)
+	bool wasEmpty = (mList->size() == 0);
+	bool netPlayShowMissingGames = Settings::NetPlayShowMissingGames();
+
+	for (auto game : entries)
+	{
+		if (game.fileData != nullptr)
 		{
-			if (game.fileData != nullptr)
+			if (!netPlayShowMissingGames && !game.coreExists)
 				continue;
 
-			if (!groupUnavailable)
+			if (netPlayShowMissingGames && !mGroupAvailable)
+			{			
+				mList->addGroup(_("AVAILABLE GAMES"), true);
+				mGroupAvailable = true;
+			}
+
+			ComponentListRow row;
+			row.addElement(std::make_shared<NetPlayLobbyListEntry>(mWindow, game), true);
+			row.makeAcceptInputHandler([this, game] { launchGame(game); });
+			mList->addRow(row);
+		}
+		else if (netPlayShowMissingGames)
+		{
+			if (!mGroupUnavailable)
 			{
 				mList->addGroup(_("UNAVAILABLE GAMES"), true);
-				groupUnavailable = true;
+				mGroupUnavailable = true;
 			}
 
 			ComponentListRow row;
@@ -651,6 +667,17 @@ bool GuiNetPlay::populateFromJson(const std::string json)
 		}
 	}
 
+	if (!matchingDone)
+	{
+		if (wasEmpty && mList->size() != 0)
+			mList->setCursorIndex(0, true);
+
+		return;
+	}
+
+	// Matching finished
+	stopMatching();
+
 	if (mList->size() == 0)
 	{
 		ComponentListRow row;
@@ -661,17 +688,16 @@ bool GuiNetPlay::populateFromJson(const std::string json)
 
 		mGrid.moveCursor(Vector2i(0, 1));
 	}
-	else
+	else if (wasEmpty)
 		mList->setCursorIndex(0, true);
-
-	return true;
 }
 
+
 void GuiNetPlay::render(const Transform4x4f &parentTrans) 
 {
 	GuiComponent::render(parentTrans);
 
-	if (mLobbyRequest)
+	if (mLobbyRequest || (mMatchingThread != nullptr && mList->size() == 0))
 		mBusyAnim.render(parentTrans);
 }
 
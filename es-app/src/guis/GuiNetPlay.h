@@ -6,7 +6,10 @@
 #include "components/BusyComponent.h"
 #include "components/NinePatchComponent.h"
 #include "components/TextComponent.h"
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 
 class HttpReq;
@@ -44,6 +47,7 @@ class GuiNetPlay : public GuiComponent
 {
 public:
 	GuiNetPlay(Window *window);
+	~GuiNetPlay();
 
 	void update(int deltaTime) override;
 	void render(const Transform4x4f &parentTrans) override;
@@ -56,10 +60,15 @@ public:
 
 private:
 	void startRequest();
-	bool populateFromJson(const std::string json);
 	void launchGame(LobbyAppEntry entry);
 
-	FileData* getFileData(const std::string gameInfo, bool crc = true, std::string coreName = "");
+	// Lobby rooms are matched with local games by a thread, the list is filled as they are found
+	void startMatching(const std::string& json);
+	void stopMatching();
+	void matchLobbyEntries(const std::string json);
+	void pushEntries(std::vector<LobbyAppEntry>& entries);
+	void addMatchedEntries();
+
 	bool coreExists(FileData* file, std::string core_name);
 
 	NinePatchComponent				mBackground;
@@ -76,4 +85,14 @@ private:
 	BusyComponent					mBusyAnim;
 
 	std::unique_ptr<HttpReq> mLobbyRequest;
+
+	std::thread*					mMatchingThread;
+	std::atomic<bool>				mMatchingExit;
+	std::atomic<bool>				mMatchingDone;
+
+	std::mutex						mEntriesLock;
+	std::vector<LobbyAppEntry>		mPendingEntries;
+
+	bool							mGroupAvailable;
+	bool							mGroupUnavailable;
 };
@@ -6,6 +6,7 @@
 #include "FileData.h"
 #include "SystemData.h"
 #include "scrapers/ThreadedScraper.h"
+#include "scrapers/ScraperCache.h"
 #include "LocaleES.h"
 #include "GuiLoading.h"
 #include "GuiScraperSettings.h"
@@ -100,6 +101,14 @@ GuiScraperStart::GuiScraperStart(Window* window)
 
 	addWithLabel(_("SYSTEMS INCLUDED"), mSystems);
 
+	// Cached responses & medias are served without asking the server until they expire
+	if (ScraperCache::isEnabled())
+	{
+		mRefreshCache = std::make_shared<SwitchComponent>(mWindow);
+		mRefreshCache->setState(false);
+		addWithLabel(_("REFRESH CACHED DATA"), mRefreshCache);
+	}
+
 	// mApproveResults = std::make_shared<SwitchComponent>(mWindow);
 	// mApproveResults->setState(false);
 	// addWithLabel(_("USER DECIDES ON CONFLICTS"), mApproveResults);
@@ -178,7 +187,7 @@ void GuiScraperStart::start()
 				mWindow->pushGui(new GuiMsgBox(mWindow, _("NO GAMES FIT THAT CRITERIA.")));
 			else
 			{
-				ThreadedScraper::start(mWindow, searches);
+				ThreadedScraper::start(mWindow, searches, mRefreshCache != nullptr && mRefreshCache->getState());
 				close();
 			}
 		}));
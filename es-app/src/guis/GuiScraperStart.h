@@ -36,6 +36,7 @@ private:
 	std::shared_ptr<OptionListComponent<FilterFunc>> mDateFilters;
 	std::shared_ptr<OptionListComponent<FilterFunc>> mFilters;
 	std::shared_ptr<OptionListComponent<SystemData*>> mSystems;
+	std::shared_ptr<SwitchComponent> mRefreshCache;
 
 	bool mOverwriteMedias;
 };
@@ -20,6 +20,9 @@
 #include <SDL_events.h>
 #include <SDL_main.h>
 #include <SDL_timer.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <time.h>
 #include "LocaleES.h"
@@ -38,6 +41,12 @@
 #include "TextToSpeech.h"
 #include "Paths.h"
 #include "resources/TextureData.h"
+#include "resources/ResourceManager.h"
+#include "resources/ResourcePack.h"
+#include "resources/SvgCache.h"
+#include "resources/Font.h"
+#include "utils/TaskGraph.h"
+#include "InputRecorder.h"
 
 #ifdef WIN32
 #include <Windows.h>
@@ -216,6 +225,69 @@ bool parseArgs(int argc, char* argv[])
 		{
 			Settings::getInstance()->setBool("ForceDisableFilters", true);
 		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			Settings::getInstance()->setBool("Headless", true);
+		}
+		else if (strcmp(argv[i], "--headless-dump") == 0)
+		{
+			if (i >= argc - 1)
+			{
+				std::cerr << "Invalid headless-dump folder supplied.";
+				return false;
+			}
+
+			Settings::getInstance()->setBool("Headless", true);
+			Settings::getInstance()->setString("HeadlessFrameDump", argv[i + 1]);
+			++i; // skip the argument value
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			if (i >= argc - 1)
+			{
+				std::cerr << "Invalid benchmark frame count supplied.";
+				return false;
+			}
+
+			Settings::getInstance()->setInt("BenchmarkFrames", atoi(argv[i + 1]));
+			++i; // skip the argument value
+		}
+		else if (strcmp(argv[i], "--record-input") == 0 || strcmp(argv[i], "--replay-input") == 0)
+		{
+			if (i >= argc - 1)
+			{
+				std::cerr << "Invalid input journal supplied.";
+				return false;
+			}
+
+			// Replay is started now, so the recorded random seed is set before anything is randomized
+			bool replay = strcmp(argv[i], "--replay-input") == 0;
+			if (replay ? !InputRecorder::startReplay(argv[i + 1]) : !InputRecorder::startRecording(argv[i + 1]))
+			{
+				std::cerr << "Unable to open input journal " << argv[i + 1] << "\n";
+				return false;
+			}
+
+			++i; // skip the argument value
+		}
+		else if (strcmp(argv[i], "--build-resource-pack") == 0)
+		{
+			if (i >= argc - 2)
+			{
+				std::cerr << "Invalid build-resource-pack supplied.";
+				return false;
+			}
+
+			// Packs a theme or builtin resources folder, to be placed next to it
+			std::string folder = argv[i + 1];
+			std::string pack = argv[i + 2];
+			i += 2;
+
+			if (!ResourcePack::build(folder, pack))
+				std::cerr << "Unable to build resource pack " << pack << " from " << folder << "\n";
+
+			return false;
+		}
 		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
 		{
 #ifdef WIN32
@@ -245,6 +317,12 @@ bool parseArgs(int argc, char* argv[])
 				"--force-kiosk		Force the UI mode to be Kiosk\n"
 				"--force-disable-filters		Force the UI to ignore applied filters in gamelist\n"
 				"--home [path]		Directory to use as home path\n"
+				"--build-resource-pack [folder] [file]	pack a resources folder into a file (ex: resources -> resources.pak) and exit\n"
+				"--headless			render without GPU nor display, draws are only counted\n"
+				"--headless-dump [folder]	render without GPU, and save each frame to folder as PNG\n"
+				"--benchmark [frames]		render frames with a fixed time step, log frame times and exit\n"
+				"--record-input [file]		save inputs & random seed to file, to replay the session later\n"
+				"--replay-input [file]		replay a recorded session with a fixed time step, save frame times to file.timings.csv and exit\n"
 				"--help, -h			summon a sentient, angry tuba\n\n"
 				"--monitor [index]			monitor index\n\n"				
 				"More information available in README.md.\n";
@@ -280,8 +358,6 @@ bool loadSystemConfigFile(Window* window, const char** errorString)
 
 	StopWatch stopWatch("loadSystemConfigFile :", LogDebug);
 
-	ImageIO::loadImageCache();
-
 	if(!SystemData::loadConfig(window))
 	{
 		LOG(LogError) << "Error while parsing systems configuration file!";
@@ -517,14 +593,25 @@ int main(int argc, char* argv[])
 	}
 #endif
 
-	// metadata init
-	Genres::init();
-	MetaDataList::initMetadata();
+	// Boot phases are declared with their dependencies : the independent ones run in the background
+	// while the window is created, then while systems are loaded & the UI is preloaded on the main thread.
+	// Singletons used by background tasks are created here, so they can't be created twice concurrently.
+	ResourceManager::getInstance();
+	ApiSystem::getInstance();
+
+	Utils::TaskGraph startup("Startup");
+	startup.add("genres", { }, [] { Genres::init(); });
+	startup.add("metadata", { }, [] { MetaDataList::initMetadata(); });
+	startup.add("mamenames", { }, [] { MameNames::init(); });
+	startup.add("imagecache", { }, [] { ImageIO::loadImageCache(); });
+	startup.add("svgcache", { }, [] { SvgCache::purgeDiskCache(); });
+	startup.add("fontcache", { }, [] { Font::purgeGlyphCache(); });
+	startup.add("ipaddress", { }, [] { ApiSystem::getInstance()->getIpAdress(); });
+	startup.start();
 
 	Window window;
 	SystemScreenSaver screensaver(&window);
 	ViewController::init(&window);
-	CollectionSystemManager::init(&window);
 	VideoVlcComponent::init();
 
 	window.pushGui(ViewController::get());
@@ -548,55 +635,74 @@ int main(int argc, char* argv[])
 		window.renderSplashScreen(progressText);
 	}
 
-	MameNames::init();
+	const char* errorMsg = NULL;
+	bool systemsLoaded = true;
 
+	// Main thread tasks run in declaration order, as soon as their dependencies are done :
+	// input is initialized while the background tasks needed by the systems are still running
+	startup.add("input", { }, []
+	{
+		InputConfig::AssignActionButtons();
+		InputManager::getInstance()->init();
+		SDL_StopTextInput();
+	}, true);
 
-	const char* errorMsg = NULL;
-	if(!loadSystemConfigFile(splashScreen && splashScreenProgress ? &window : nullptr, &errorMsg))
+	// The collection declarations list the genres & read the metadata declarations
+	startup.add("collections", { "genres", "metadata" }, [&window]
 	{
-		// something went terribly wrong
-		if(errorMsg == NULL)
-		{
-			LOG(LogError) << "Unknown error occured while parsing system config file.";
-			Renderer::deinit();
-			return 1;
-		}
+		CollectionSystemManager::init(&window);
+	}, true);
 
-		// we can't handle es_systems.cfg file problems inside ES itself, so display the error message then quit
-		window.pushGui(new GuiMsgBox(&window, errorMsg, _("QUIT"), [] { quitES(); }));
-	}
+	startup.add("systems", { "collections", "mamenames", "imagecache" }, [&]
+	{
+		systemsLoaded = loadSystemConfigFile(splashScreen && splashScreenProgress ? &window : nullptr, &errorMsg);
+	}, true);
 
-	SystemConf* systemConf = SystemConf::getInstance();
+	startup.add("preload", { "systems", "input" }, [&]
+	{
+		if (!systemsLoaded && errorMsg == NULL)
+			return;
 
 #ifdef _ENABLE_KODI_
-	if (systemConf->getBool("kodi.enabled", true) && systemConf->getBool("kodi.atstartup"))
-	{
-		if (splashScreen)
-			window.closeSplashScreen();
+		SystemConf* systemConf = SystemConf::getInstance();
+		if (systemConf->getBool("kodi.enabled", true) && systemConf->getBool("kodi.atstartup"))
+		{
+			if (splashScreen)
+				window.closeSplashScreen();
 
-		ApiSystem::getInstance()->launchKodi(&window);
+			ApiSystem::getInstance()->launchKodi(&window);
 
-		if (splashScreen)
-		{
-			window.renderSplashScreen("");
-			splashScreen = false;
+			if (splashScreen)
+			{
+				window.renderSplashScreen("");
+				splashScreen = false;
+			}
 		}
-	}
 #endif
 
-	if (ApiSystem::getInstance()->isScriptingSupported(ApiSystem::PDFEXTRACTION))
-		TextureData::PdfHandler = ApiSystem::getInstance();
+		if (ApiSystem::getInstance()->isScriptingSupported(ApiSystem::PDFEXTRACTION))
+			TextureData::PdfHandler = ApiSystem::getInstance();
+
+		// preload what we can right away instead of waiting for the user to select it
+		// this makes for no delays when accessing content, but a longer startup time
+		ViewController::get()->preload();
+	}, true);
 
-	ApiSystem::getInstance()->getIpAdress();
+	startup.run();
 
-	// preload what we can right away instead of waiting for the user to select it
-	// this makes for no delays when accessing content, but a longer startup time
-	ViewController::get()->preload();
+	if (!systemsLoaded)
+	{
+		// something went terribly wrong
+		if(errorMsg == NULL)
+		{
+			LOG(LogError) << "Unknown error occured while parsing system config file.";
+			Renderer::deinit();
+			return 1;
+		}
 
-	// Initialize input
-	InputConfig::AssignActionButtons();
-	InputManager::getInstance()->init();
-	SDL_StopTextInput();
+		// we can't handle es_systems.cfg file problems inside ES itself, so display the error message then quit
+		window.pushGui(new GuiMsgBox(&window, errorMsg, _("QUIT"), [] { quitES(); }));
+	}
 
 	NetworkThread* nthread = new NetworkThread(&window);
 	HttpServerThread httpServer(&window);
@@ -642,17 +748,32 @@ int main(int argc, char* argv[])
 	int lastTime = SDL_GetTicks();
 	int ps_time = SDL_GetTicks();
 
+	// Benchmark : a fixed time step makes animations, and thus frames, the same on every run
+	int benchmarkFrames = Settings::getInstance()->getInt("BenchmarkFrames");
+	bool benchmark = benchmarkFrames > 0 || InputRecorder::isReplaying();
+	std::vector<double> benchmarkTimes;
+	Renderer::Statistics benchmarkStatistics;
+
+	std::ofstream replayTimings;
+	if (InputRecorder::isReplaying())
+	{
+		replayTimings.open(InputRecorder::getPath() + ".timings.csv");
+		replayTimings << "frame,ms,drawcalls,vertices,textureuploads\n";
+	}
+
 	bool running = true;
 
 	while(running)
 	{
+		auto frameStart = std::chrono::steady_clock::now();
+
 #ifdef WIN32	
 		int processStart = SDL_GetTicks();
 #endif
 
 		SDL_Event event;
 
-		bool ps_standby = PowerSaver::getState() && (int) SDL_GetTicks() - ps_time > PowerSaver::getMode();
+		bool ps_standby = !benchmark && PowerSaver::getState() && (int) SDL_GetTicks() - ps_time > PowerSaver::getMode();
 		if(ps_standby ? SDL_WaitEventTimeout(&event, PowerSaver::getTimeout()) : SDL_PollEvent(&event))
 		{
 			// PowerSaver can push events to exit SDL_WaitEventTimeout immediatly
@@ -689,9 +810,14 @@ int main(int argc, char* argv[])
 		  //	ps_time = SDL_GetTicks();
 		}
 
-		if (window.isSleeping())
+		// Recording & replaying must see the same frames : neither sleeps
+		if (window.isSleeping() && !benchmark && !InputRecorder::isRecording())
 		{
-			lastTime = SDL_GetTicks();
+			// The web api catalog is still published while the screen sleeps
+			int sleepTime = SDL_GetTicks();
+			httpServer.update(sleepTime - lastTime);
+
+			lastTime = sleepTime;
 			SDL_Delay(1); // this doesn't need to be accurate, we're just giving up our CPU time until something wakes us up
 			continue;
 		}
@@ -704,7 +830,14 @@ int main(int argc, char* argv[])
 		if(deltaTime < 0)
 			deltaTime = 1000;
 
+		// Fixed step while recording too, so journal times are frame indices and the replay follows the same updates
+		if (benchmark || InputRecorder::isRecording())
+			deltaTime = InputRecorder::getTimeStep();
+
+		InputRecorder::update(&window, deltaTime);
+
 		TRYCATCH("Window.update" ,window.update(deltaTime))	
+		httpServer.update(deltaTime);
 		TRYCATCH("Window.render", window.render())
 
 #ifdef WIN32		
@@ -719,9 +852,50 @@ int main(int argc, char* argv[])
 
 		Renderer::swapBuffers();
 
+		if (benchmark)
+		{
+			double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			benchmarkTimes.push_back(frameTime);
+
+			Renderer::Statistics stats = Renderer::getStatistics();
+			benchmarkStatistics.drawCalls += stats.drawCalls;
+			benchmarkStatistics.vertices += stats.vertices;
+			benchmarkStatistics.textureUploads += stats.textureUploads;
+
+			if (replayTimings.is_open())
+				replayTimings << benchmarkTimes.size() << "," << frameTime << "," << stats.drawCalls << "," << stats.vertices << "," << stats.textureUploads << "\n";
+
+			if ((benchmarkFrames > 0 && (int)benchmarkTimes.size() >= benchmarkFrames) || InputRecorder::isReplayFinished())
+			{
+				std::vector<double> sorted = benchmarkTimes;
+				std::sort(sorted.begin(), sorted.end());
+
+				double total = 0;
+				for (auto time : sorted)
+					total += time;
+
+				size_t count = sorted.size();
+
+				LOG(LogInfo) << "Benchmark : " << count << " frames with " << Renderer::getDriverName() << 
+					", average " << (total / count) << "ms, min " << sorted.front() << "ms, median " << sorted[count / 2] << 
+					"ms, 95th percentile " << sorted[std::min(count - 1, count * 95 / 100)] << "ms, max " << sorted.back() << "ms";
+
+				LOG(LogInfo) << "Benchmark : per frame " << benchmarkStatistics.drawCalls / count << " draw calls, " << 
+					benchmarkStatistics.vertices / count << " vertices, " << benchmarkStatistics.textureUploads << " texture uploads in total";
+
+				VideoVlcComponent::FrameStatistics videoStats = VideoVlcComponent::getFrameStatistics();
+				if (videoStats.uploaded > 0)
+					LOG(LogInfo) << "Benchmark : " << videoStats.uploaded << " video frames uploaded, " << videoStats.dropped << " dropped";
+
+				running = false;
+			}
+		}
+
 		Log::flush();
 	}
 
+	InputRecorder::stop();
+
 	if (isFastShutdown())
 		Settings::getInstance()->setBool("IgnoreGamelist", true);
 
@@ -737,6 +911,7 @@ int main(int argc, char* argv[])
 		window.renderSplashScreen(_("SAVING METADATAS. PLEASE WAIT..."));
 
 	ImageIO::saveImageCache();
+	VideoVlcComponent::deinit();
 	MameNames::deinit();
 	ViewController::saveState();
 	CollectionSystemManager::deinit();
@@ -51,7 +51,7 @@ class HfsDBRequest : public ScraperHttpRequest
 	virtual bool retryOn249() { return !mIsManualScrape; }
 
   protected:
-	bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) override;
+	bool process(const std::string& content, std::vector<ScraperSearchResult>& results) override;
 	bool isGameRequest() { return !mRequestQueue; }
 
 	bool mIsManualScrape;
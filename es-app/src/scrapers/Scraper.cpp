@@ -14,6 +14,7 @@
 #include <thread>
 #include <SDL_timer.h>
 #include "HfsDBScraper.h"
+#include "scrapers/ScraperCache.h"
 
 #define OVERQUOTA_RETRY_DELAY 15000
 #define OVERQUOTA_RETRY_COUNT 5
@@ -203,9 +204,26 @@ std::vector<std::string> Scraper::getScraperList()
 // ScraperSearchHandle
 ScraperSearchHandle::ScraperSearchHandle()
 {
+	mThrottled = false;
+	mCached = true;
 	setStatus(ASYNC_IN_PROGRESS);
 }
 
+bool ScraperSearchHandle::isCacheHit()
+{
+	bool cached = true;
+
+	// std::queue can't be iterated : rotate it
+	for (size_t i = 0; i < mRequestQueue.size(); i++)
+	{
+		cached = cached && mRequestQueue.front()->isCached();
+		mRequestQueue.push(std::move(mRequestQueue.front()));
+		mRequestQueue.pop();
+	}
+
+	return cached;
+}
+
 void ScraperSearchHandle::update()
 {
 	if(mStatus == ASYNC_DONE)
@@ -218,6 +236,12 @@ void ScraperSearchHandle::update()
 		auto& req = *(mRequestQueue.front());
 		AsyncHandleStatus status = req.status();
 
+		if (status != ASYNC_IN_PROGRESS)
+		{
+			mThrottled = mThrottled || req.isThrottled();
+			mCached = mCached && req.isCached();
+		}
+
 		if(status == ASYNC_ERROR)
 		{
 			// propagate error
@@ -261,7 +285,14 @@ ScraperHttpRequest::ScraperHttpRequest(std::vector<ScraperSearchResult>& results
 	if (options != nullptr)
 		mOptions = *options;
 
-	mRequest = new HttpReq(url, &mOptions);
+	mUrl = url;
+	mRequest = nullptr;
+
+	// Fresh cached response : no need to ask the server, update() will process it.
+	// Otherwise the request is sent on the first update, so that callers can check isCacheHit() before any network access
+	mCacheEntry = ScraperCache::get(url);
+	mCached = mCacheEntry.isFresh();
+
 	mRetryCount = 0;
 	mOverQuotaPendingTime = 0;
 	mOverQuotaRetryDelay = OVERQUOTA_RETRY_DELAY;
@@ -270,11 +301,37 @@ ScraperHttpRequest::ScraperHttpRequest(std::vector<ScraperSearchResult>& results
 
 ScraperHttpRequest::~ScraperHttpRequest()
 {
-	delete mRequest;	
+	if (mRequest != nullptr)
+		delete mRequest;	
+}
+
+void ScraperHttpRequest::processContent(const std::string& content, HttpReq* request)
+{
+	setStatus(ASYNC_DONE); // if process() has an error, status will be changed to ASYNC_ERROR
+
+	if (process(content, mResults) && mStatus == ASYNC_DONE && request != nullptr)
+		ScraperCache::put(mUrl, request, content);
 }
 
 void ScraperHttpRequest::update()
 {
+	if (mStatus != ASYNC_IN_PROGRESS)
+		return;
+
+	if (mCached)
+	{
+		LOG(LogDebug) << "ScraperHttpRequest : using cached response for " << mUrl;
+		processContent(ScraperCache::readContent(mCacheEntry), nullptr);
+		return;
+	}
+
+	if (mRequest == nullptr)
+	{
+		ScraperCache::addValidationHeaders(mCacheEntry, mOptions);
+		mRequest = new HttpReq(mUrl, &mOptions);
+		return;
+	}
+
 	if (mOverQuotaPendingTime > 0)
 	{
 		int lastTime = SDL_GetTicks();
@@ -300,13 +357,21 @@ void ScraperHttpRequest::update()
 
 	if(status == HttpReq::REQ_SUCCESS)
 	{
-		setStatus(ASYNC_DONE); // if process() has an error, status will be changed to ASYNC_ERROR
-		process(mRequest, mResults);
+		processContent(mRequest->getContent(), mRequest);
+		return;
+	}
+
+	if (status == HttpReq::REQ_304_NOTMODIFIED && mCacheEntry.exists())
+	{
+		ScraperCache::touch(mCacheEntry);
+		processContent(ScraperCache::readContent(mCacheEntry), nullptr);
 		return;
 	}
 
 	if (status == HttpReq::REQ_429_TOOMANYREQUESTS)
 	{
+		mThrottled = true;
+
 		mRetryCount++;
 		if (mRetryCount >= mOverQuotaRetryCount)
 		{
@@ -491,36 +556,61 @@ std::unique_ptr<ImageDownloadHandle> MDResolveHandle::downloadImageAsync(const s
 }
 
 ImageDownloadHandle::ImageDownloadHandle(const std::string& url, const std::string& path, int maxWidth, int maxHeight) : 
-	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
+	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight), mRequest(nullptr)
 {
 	mRetryCount = 0;
 	mOverQuotaPendingTime = 0;
 	mOverQuotaRetryDelay = OVERQUOTA_RETRY_DELAY;
 	mOverQuotaRetryCount = OVERQUOTA_RETRY_COUNT;
 
+	mUrl = url;
+
 	if (url.find("screenscraper") != std::string::npos && (path.find(".jpg") != std::string::npos || path.find(".png") != std::string::npos) && url.find("media=map") == std::string::npos)
 	{
-		if (maxWidth > 0 && maxHeight > 0)
-			mRequest = new HttpReq(url + "&maxwidth=" + std::to_string(maxWidth), path);
-		else if (maxWidth > 0)
-			mRequest = new HttpReq(url + "&maxwidth=" + std::to_string(maxWidth), path);
+		if (maxWidth > 0)
+			mUrl = url + "&maxwidth=" + std::to_string(maxWidth);
 		else if (maxHeight > 0)
-			mRequest = new HttpReq(url + "&maxheight=" + std::to_string(maxHeight), path);
-		else 
-			mRequest = new HttpReq(url, path);
+			mUrl = url + "&maxheight=" + std::to_string(maxHeight);
 	}
-	else
-		mRequest = new HttpReq(url, path);
+
+	mResizeInMemory = (mMaxWidth > 0 || mMaxHeight > 0) && isResizableImage();
+
+	// Fresh cached media : no need to ask the server, update() will save it
+	mCacheEntry = ScraperCache::get(mUrl);
+	if (!mCacheEntry.isFresh())
+		mRequest = createRequest();
 }
 
 ImageDownloadHandle::~ImageDownloadHandle()
 {
-	delete mRequest;
+	if (mRequest != nullptr)
+		delete mRequest;
+}
+
+HttpReq* ImageDownloadHandle::createRequest()
+{
+	HttpReqOptions options;
+
+	// A revalidated media is downloaded in memory : writing to a file would remove the cached media, which is the saved file
+	if (!mResizeInMemory && !mCacheEntry.exists())
+		options.outputFilename = mSavePath;
+
+	ScraperCache::addValidationHeaders(mCacheEntry, options);
+	return new HttpReq(mUrl, &options);
+}
+
+bool ImageDownloadHandle::isResizableImage()
+{
+	if (mSavePath.find("-fanart") != std::string::npos || mSavePath.find("-bezel") != std::string::npos || mSavePath.find("-map") != std::string::npos)
+		return false;
+
+	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
+	return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif";
 }
 
 int ImageDownloadHandle::getPercent()
 {
-	if (mRequest->status() == HttpReq::REQ_IN_PROGRESS)
+	if (mRequest != nullptr && mRequest->status() == HttpReq::REQ_IN_PROGRESS)
 		return mRequest->getPercent();
 
 	return -1;
@@ -528,6 +618,17 @@ int ImageDownloadHandle::getPercent()
 
 void ImageDownloadHandle::update()
 {
+	if (mStatus != ASYNC_IN_PROGRESS)
+		return;
+
+	if (mRequest == nullptr)
+	{
+		LOG(LogDebug) << "ImageDownloadHandle : using cached media for " << mUrl;
+		useCachedMedia();
+		setStatus(ASYNC_DONE);
+		return;
+	}
+
 	if (mOverQuotaPendingTime > 0)
 	{
 		int lastTime = SDL_GetTicks();
@@ -537,9 +638,8 @@ void ImageDownloadHandle::update()
 
 			LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
 
-			std::string url = mRequest->getUrl();
 			delete mRequest;
-			mRequest = new HttpReq(url, mSavePath);
+			mRequest = createRequest();
 		}
 
 		return;
@@ -573,6 +673,14 @@ void ImageDownloadHandle::update()
 		return;
 	}
 
+	if (status == HttpReq::REQ_304_NOTMODIFIED && mCacheEntry.exists())
+	{
+		ScraperCache::touch(mCacheEntry);
+		useCachedMedia();
+		setStatus(ASYNC_DONE);
+		return;
+	}
+
 	// Ignored errors
 	if (status == HttpReq::REQ_404_NOTFOUND || status == HttpReq::REQ_IO_ERROR)
 	{
@@ -587,51 +695,117 @@ void ImageDownloadHandle::update()
 		return;
 	}
 
-	if (status == HttpReq::REQ_SUCCESS && mStatus == ASYNC_IN_PROGRESS)
+	onDownloaded(mRequest);
+	setStatus(ASYNC_DONE);
+}
+
+std::string ImageDownloadHandle::getExtensionFromContentType(const std::string& contentType)
+{
+	std::string trueExtension;
+
+	if (Utils::String::startsWith(contentType, "image/"))
+	{
+		trueExtension = "." + contentType.substr(6);
+		if (trueExtension == ".jpeg")
+			trueExtension = ".jpg";
+		else if (trueExtension == ".svg+xml")
+			trueExtension = ".svg";
+	}
+	else if (Utils::String::startsWith(contentType, "video/"))
 	{
-		std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
+		trueExtension = "." + contentType.substr(6);
+		if (trueExtension == ".quicktime")
+			trueExtension = ".mov";
+	}
 
-		// Make sure extension is the good one, according to the response 'Content-Type'
-		std::string contentType = mRequest->getResponseHeader("Content-Type");
-		if (!contentType.empty())
-		{
-			std::string trueExtension;
-			if (Utils::String::startsWith(contentType, "image/"))
-			{
-				trueExtension = "." + contentType.substr(6);
-				if (trueExtension == ".jpeg")
-					trueExtension = ".jpg";
-				else if (trueExtension == ".svg+xml")
-					trueExtension = ".svg";
+	return trueExtension;
+}
 
-			}
-			else if (Utils::String::startsWith(contentType, "video/"))
-			{
-				trueExtension = "." + contentType.substr(6);
-				if (trueExtension == ".quicktime")
-					trueExtension = ".mov";
-			}
+static bool writeMediaFile(const std::string& path, const std::string& data)
+{
+	std::ofstream file(WINSTRINGW(path), std::ios::binary | std::ios::out);
+	if (!file.is_open())
+		return false;
 
-			if (!trueExtension.empty() && trueExtension != ext)
-			{
-				auto newFileName = Utils::FileSystem::changeExtension(mSavePath, trueExtension);
-				if (Utils::FileSystem::renameFile(mSavePath, newFileName))
-				{
-					mSavePath = newFileName;
-					ext = trueExtension;
-				}
-			}
-		}
+	file.write(data.c_str(), data.size());
+	file.close();
+	return !file.fail();
+}
+
+void ImageDownloadHandle::saveFromMemory(const std::string& data, const std::string& contentType)
+{
+	if (data.empty())
+		return;
+
+	// Make sure extension is the good one, according to the response 'Content-Type'
+	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
+	std::string trueExtension = getExtensionFromContentType(contentType);
+	if (!trueExtension.empty() && trueExtension != ext)
+		mSavePath = Utils::FileSystem::changeExtension(mSavePath, trueExtension);
+
+	bool saved = false;
+
+	if (isResizableImage())
+	{
+		try { saved = resizeImageFromMemory(data, mSavePath, mMaxWidth, mMaxHeight); }
+		catch (...) { }
+	}
+
+	if (!saved && !writeMediaFile(mSavePath, data))
+		LOG(LogError) << "ImageDownloadHandle : unable to write " << mSavePath;
+}
+
+// The cache entry of a media points to the file saved when it was downloaded
+void ImageDownloadHandle::useCachedMedia()
+{
+	std::string trueExtension = getExtensionFromContentType(mCacheEntry.contentType);
+	std::string savePath = mSavePath;
+	if (!trueExtension.empty() && trueExtension != Utils::String::toLower(Utils::FileSystem::getExtension(savePath)))
+		savePath = Utils::FileSystem::changeExtension(savePath, trueExtension);
+
+	if (savePath == mCacheEntry.path)
+	{
+		mSavePath = savePath;
+		return;
+	}
+
+	// Same media for another game
+	saveFromMemory(ScraperCache::readContent(mCacheEntry), mCacheEntry.contentType);
+}
+
+void ImageDownloadHandle::onDownloaded(HttpReq* request)
+{
+	std::string contentType = request->getResponseHeader("Content-Type");
 
-		// It's an image ?
-		if (mSavePath.find("-fanart") == std::string::npos && mSavePath.find("-bezel") == std::string::npos && mSavePath.find("-map") == std::string::npos && (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif"))
+	if (mResizeInMemory || mCacheEntry.exists())
+	{
+		saveFromMemory(request->getContent(), contentType);
+		ScraperCache::putFile(mUrl, request, mSavePath);
+		return;
+	}
+
+	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
+
+	// Make sure extension is the good one, according to the response 'Content-Type'
+	std::string trueExtension = getExtensionFromContentType(contentType);
+	if (!trueExtension.empty() && trueExtension != ext)
+	{
+		auto newFileName = Utils::FileSystem::changeExtension(mSavePath, trueExtension);
+		if (Utils::FileSystem::renameFile(mSavePath, newFileName))
 		{
-			try { resizeImage(mSavePath, mMaxWidth, mMaxHeight); }
-			catch(...) { }
+			mSavePath = newFileName;
+			ext = trueExtension;
 		}
 	}
 
-	setStatus(ASYNC_DONE);
+	// It's an image ?
+	if (isResizableImage())
+	{
+		try { resizeImage(mSavePath, mMaxWidth, mMaxHeight); }
+		catch(...) { }
+	}
+
+	ScraperCache::putFile(mUrl, request, mSavePath);
 }
 
 //you can pass 0 for width or height to keep aspect ratio
@@ -708,6 +882,75 @@ bool resizeImage(const std::string& path, int maxWidth, int maxHeight)
 	return saved;
 }
 
+bool resizeImageFromMemory(const std::string& data, const std::string& path, int maxWidth, int maxHeight)
+{
+	FIMEMORY* memory = FreeImage_OpenMemory((BYTE*)data.c_str(), (DWORD)data.size());
+	if (memory == NULL)
+		return false;
+
+	FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory(memory, 0);
+	if (format == FIF_UNKNOWN)
+		format = FreeImage_GetFIFFromFilename(path.c_str());
+
+	if (format == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(format))
+	{
+		FreeImage_CloseMemory(memory);
+		LOG(LogError) << "Error - could not detect filetype for image \"" << path << "\"!";
+		return false;
+	}
+
+	FIBITMAP* image = FreeImage_LoadFromMemory(format, memory, 0);
+	FreeImage_CloseMemory(memory);
+
+	if (image == NULL)
+		return false;
+
+	float width = (float)FreeImage_GetWidth(image);
+	float height = (float)FreeImage_GetHeight(image);
+
+	if (width == 0 || height == 0 || (maxWidth == 0 && maxHeight == 0))
+	{
+		FreeImage_Unload(image);
+		return writeMediaFile(path, data);
+	}
+
+	if (maxWidth == 0)
+		maxWidth = (int)((maxHeight / height) * width);
+	else if (maxHeight == 0)
+		maxHeight = (int)((maxWidth / width) * height);
+
+	// Small enough : keep the original encoding
+	if (width <= maxWidth && height <= maxHeight)
+	{
+		FreeImage_Unload(image);
+		return writeMediaFile(path, data);
+	}
+
+	FIBITMAP* imageRescaled = FreeImage_Rescale(image, maxWidth, maxHeight, FILTER_BILINEAR);
+	FreeImage_Unload(image);
+
+	if (imageRescaled == NULL)
+	{
+		LOG(LogError) << "Could not resize image! (not enough memory? invalid bitdepth?)";
+		return false;
+	}
+
+	bool saved = false;
+
+	try
+	{
+		saved = (FreeImage_Save(format, imageRescaled, path.c_str()) != 0);
+	}
+	catch (...) { }
+
+	FreeImage_Unload(imageRescaled);
+
+	if (!saved)
+		LOG(LogError) << "Failed to save resized image!";
+
+	return saved;
+}
+
 std::string Scraper::getSaveAsPath(FileData* game, const MetaDataId metadataId, const std::string& extension)
 {
 	std::string suffix = "image";
@@ -12,6 +12,7 @@
 #include <set>
 #include <assert.h>
 #include "FileData.h"
+#include "scrapers/ScraperCache.h"
 
 class FileData;
 class SystemData;
@@ -74,13 +75,22 @@ struct ScraperSearchResult
 class ScraperRequest : public AsyncHandle
 {
 public:
-	ScraperRequest(std::vector<ScraperSearchResult>& resultsWrite) : mResults(resultsWrite) {};
+	ScraperRequest(std::vector<ScraperSearchResult>& resultsWrite) : mResults(resultsWrite), mThrottled(false), mCached(false) {};
 
 	// returns "true" once we're done
 	virtual void update() = 0;
+
+	// The server asked us to slow down while processing this request
+	bool isThrottled() { return mThrottled; }
+
+	// The request was answered from the scraper cache, without network access
+	bool isCached() { return mCached; }
 	
 protected:
 	std::vector<ScraperSearchResult>& mResults;
+
+	bool mThrottled;
+	bool mCached;
 };
 
 // a single HTTP request that needs to be processed to get the results
@@ -94,13 +104,18 @@ public:
 	virtual bool retryOn249() { return true; }
 
 protected:
-	virtual bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) = 0;
+	virtual bool process(const std::string& content, std::vector<ScraperSearchResult>& results) = 0;
 
 private:
+	void processContent(const std::string& content, HttpReq* request);
+
 	HttpReq* mRequest;
 	HttpReqOptions mOptions;
 	int	mRetryCount;
 
+	std::string mUrl;
+	ScraperCache::Entry mCacheEntry;
+
 	int mOverQuotaPendingTime;
 	int mOverQuotaRetryDelay;
 	int mOverQuotaRetryCount;
@@ -117,9 +132,18 @@ public:
 	void update();
 	inline const std::vector<ScraperSearchResult>& getResults() const { assert(mStatus != ASYNC_IN_PROGRESS); return mResults; }
 
+	bool isThrottled() { return mThrottled; }
+	bool isCached() { return mCached; }
+
+	// Before the first update : true if every request will be answered from the scraper cache
+	bool isCacheHit();
+
 protected:
 	std::queue< std::unique_ptr<ScraperRequest> > mRequestQueue;
 	std::vector<ScraperSearchResult> mResults;
+
+	bool mThrottled;
+	bool mCached;
 };
 
 typedef void (*generate_scraper_requests_func)(const ScraperSearchParams& params, std::queue< std::unique_ptr<ScraperRequest> >& requests, std::vector<ScraperSearchResult>& results);
@@ -138,6 +162,14 @@ public:
 	std::string getImageFileName() { return mSavePath; }
 
 private:
+	void onDownloaded(HttpReq* request);
+	void saveFromMemory(const std::string& data, const std::string& contentType);
+	void useCachedMedia();
+	std::string getExtensionFromContentType(const std::string& contentType);
+	bool isResizableImage();
+
+	HttpReq* createRequest();
+
 	HttpReq* mRequest;
 
 	int	mRetryCount;
@@ -145,9 +177,14 @@ private:
 	int mOverQuotaRetryDelay;
 	int mOverQuotaRetryCount;
 
+	std::string mUrl;
 	std::string mSavePath;
 	int mMaxWidth;
 	int mMaxHeight;
+
+	// Images which must be resized are downloaded in memory, and only written once resized
+	bool mResizeInMemory;
+	ScraperCache::Entry mCacheEntry;
 };
 
 
@@ -209,6 +246,21 @@ private:
 	int mPercent;
 };
 
+// Limits given by the scraper service, 0 or -1 when unknown
+struct ScraperQuota
+{
+	ScraperQuota()
+	{
+		maxThreads = 1;
+		maxRequestsPerMin = 0;
+		remainingRequestsToday = -1;
+	}
+
+	int maxThreads;
+	int maxRequestsPerMin;
+	int remainingRequestsToday;
+};
+
 class Scraper
 {
 public:
@@ -257,8 +309,9 @@ public:
 
 	std::unique_ptr<ScraperSearchHandle> search(const ScraperSearchParams& params);
 
-	virtual	int getThreadCount(std::string &result) {
-		return 1;
+	// Returns false if the scraper can't be used (bad login...), with the reason in result
+	virtual	bool getQuota(ScraperQuota& quota, std::string &result) {
+		return true;
 	}
 
 	bool isMediaSupported(const ScraperMediaSource& md);
@@ -274,4 +327,7 @@ protected:
 //Returns true if successful, false otherwise.
 bool resizeImage(const std::string& path, int maxWidth, int maxHeight);
 
+//Same as resizeImage, but the source image is in memory : it is written only once, at [path].
+bool resizeImageFromMemory(const std::string& data, const std::string& path, int maxWidth, int maxHeight);
+
 #endif // ES_APP_SCRAPERS_SCRAPER_H
@@ -0,0 +1,255 @@
+#include "scrapers/ScraperCache.h"
+
+#include "HttpReq.h"
+#include "Log.h"
+#include "Paths.h"
+#include "Settings.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "utils/md5.h"
+#include "math/Misc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+
+#define SECONDS_PER_DAY			(24 * 60 * 60)
+#define CACHE_MAX_UNUSED_DAYS	180
+
+static std::atomic<bool> sRefresh(false);
+
+void ScraperCache::setRefresh(bool refresh)
+{
+	sRefresh = refresh;
+}
+
+bool ScraperCache::isEnabled()
+{
+	return Settings::getInstance()->getInt("ScraperCacheDays") > 0;
+}
+
+bool ScraperCache::Entry::isFresh() const
+{
+	if (!exists())
+		return false;
+
+	return time(NULL) - date < (time_t)Settings::getInstance()->getInt("ScraperCacheDays") * SECONDS_PER_DAY;
+}
+
+std::string ScraperCache::getCachePath()
+{
+	return Utils::FileSystem::getGenericPath(Paths::getUserEmulationStationPath() + "/cache/scraper");
+}
+
+std::string ScraperCache::getKey(const std::string& url)
+{
+	return md5(url);
+}
+
+ScraperCache::Entry ScraperCache::get(const std::string& url)
+{
+	Entry entry;
+
+	if (!isEnabled())
+		return entry;
+
+	entry.key = getKey(url);
+	entry.path = getCachePath() + "/" + entry.key.substr(0, 2) + "/" + entry.key;
+
+	// The user asked for fresh data : ask the server without validators, the responses are stored again
+	if (sRefresh)
+		return entry;
+
+	std::ifstream info(WINSTRINGW(entry.path + ".info"));
+	if (!info.is_open())
+		return entry;
+
+	std::string line;
+	while (std::getline(info, line))
+	{
+		auto eq = line.find('=');
+		if (eq == std::string::npos)
+			continue;
+
+		std::string name = line.substr(0, eq);
+		std::string value = line.substr(eq + 1);
+
+		if (name == "etag")
+			entry.etag = value;
+		else if (name == "last-modified")
+			entry.lastModified = value;
+		else if (name == "content-type")
+			entry.contentType = value;
+		else if (name == "date")
+			entry.date = (time_t)atoll(value.c_str());
+		else if (name == "file")
+			entry.path = value;
+	}
+
+	if (entry.exists() && !Utils::FileSystem::exists(entry.path))
+		entry.date = 0;
+
+	return entry;
+}
+
+void ScraperCache::addValidationHeaders(const Entry& entry, HttpReqOptions& options)
+{
+	if (!entry.exists())
+		return;
+
+	if (!entry.etag.empty())
+		options.customHeaders.push_back("If-None-Match: " + entry.etag);
+
+	if (!entry.lastModified.empty())
+		options.customHeaders.push_back("If-Modified-Since: " + entry.lastModified);
+}
+
+std::string ScraperCache::readContent(const Entry& entry)
+{
+	if (!entry.exists())
+		return "";
+
+	std::ifstream file(WINSTRINGW(entry.path), std::ios::binary | std::ios::in);
+	if (!file.is_open())
+		return "";
+
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void ScraperCache::writeEntryInfo(const std::string& path, const std::string& etag, const std::string& lastModified, const std::string& contentType, const std::string& file)
+{
+	std::string info;
+
+	if (!file.empty())
+		info += "file=" + file + "\n";
+
+	if (!etag.empty())
+		info += "etag=" + etag + "\n";
+
+	if (!lastModified.empty())
+		info += "last-modified=" + lastModified + "\n";
+
+	if (!contentType.empty())
+		info += "content-type=" + contentType + "\n";
+
+	info += "date=" + std::to_string((long long)time(NULL)) + "\n";
+
+	Utils::FileSystem::writeAllText(path + ".info.tmp", info);
+	Utils::FileSystem::renameFile(path + ".info.tmp", path + ".info");
+}
+
+void ScraperCache::put(const std::string& url, HttpReq* request, const std::string& content)
+{
+	if (!isEnabled() || request == nullptr || content.empty())
+		return;
+
+	std::string key = getKey(url);
+	std::string folder = getCachePath() + "/" + key.substr(0, 2);
+	std::string path = folder + "/" + key;
+
+	if (!Utils::FileSystem::isDirectory(folder))
+		Utils::FileSystem::createDirectory(folder);
+
+	// Write data first & rename, so that readers never see a partial file
+	std::ofstream file(WINSTRINGW(path + ".tmp"), std::ios::binary | std::ios::out);
+	if (!file.is_open())
+	{
+		LOG(LogWarning) << "ScraperCache : unable to write " << path;
+		return;
+	}
+
+	file.write(content.c_str(), content.size());
+	file.close();
+
+	if (!Utils::FileSystem::renameFile(path + ".tmp", path))
+		return;
+
+	writeEntryInfo(path, request->getResponseHeader("ETag"), request->getResponseHeader("Last-Modified"), request->getResponseHeader("Content-Type"));
+}
+
+void ScraperCache::putFile(const std::string& url, HttpReq* request, const std::string& filePath)
+{
+	if (!isEnabled() || request == nullptr || Utils::FileSystem::getFileSize(filePath) == 0)
+		return;
+
+	std::string key = getKey(url);
+	std::string folder = getCachePath() + "/" + key.substr(0, 2);
+
+	if (!Utils::FileSystem::isDirectory(folder))
+		Utils::FileSystem::createDirectory(folder);
+
+	// Only the validators are stored : the media saved in the game folders is the cached data
+	writeEntryInfo(folder + "/" + key, request->getResponseHeader("ETag"), request->getResponseHeader("Last-Modified"), request->getResponseHeader("Content-Type"), filePath);
+}
+
+void ScraperCache::touch(const Entry& entry)
+{
+	if (!entry.exists())
+		return;
+
+	std::string path = getCachePath() + "/" + entry.key.substr(0, 2) + "/" + entry.key;
+
+	if (entry.path == path)
+		writeEntryInfo(path, entry.etag, entry.lastModified, entry.contentType);
+	else
+		writeEntryInfo(path, entry.etag, entry.lastModified, entry.contentType, entry.path);
+}
+
+// The date of the .info file is the last time the entry was stored or revalidated : the least recently used entries are removed first
+void ScraperCache::purge()
+{
+	struct CacheFile
+	{
+		std::string path;
+		time_t date;
+		unsigned long long size;
+	};
+
+	std::vector<CacheFile> files;
+	unsigned long long totalSize = 0;
+
+	for (auto folder : Utils::FileSystem::getDirContent(getCachePath()))
+	{
+		if (!Utils::FileSystem::isDirectory(folder))
+			continue;
+
+		for (auto file : Utils::FileSystem::getDirContent(folder))
+		{
+			if (Utils::FileSystem::getExtension(file) != ".info")
+				continue;
+
+			CacheFile cacheFile;
+			cacheFile.path = file.substr(0, file.size() - 5);
+			cacheFile.date = Utils::FileSystem::getFileModificationDate(file).getTime();
+			cacheFile.size = Utils::FileSystem::getFileSize(file) + Utils::FileSystem::getFileSize(cacheFile.path);
+
+			totalSize += cacheFile.size;
+			files.push_back(cacheFile);
+		}
+	}
+
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.date < b.date; });
+
+	unsigned long long maxSize = (unsigned long long)Math::max(0, Settings::getInstance()->getInt("ScraperCacheMaxSize")) * 1024 * 1024;
+	time_t oldest = time(NULL) - (time_t)CACHE_MAX_UNUSED_DAYS * SECONDS_PER_DAY;
+
+	int removed = 0;
+
+	for (auto& file : files)
+	{
+		if (file.date >= oldest && totalSize <= maxSize)
+			break;
+
+		// Media entries only have a .info file here, the media itself is in the game folders
+		Utils::FileSystem::removeFile(file.path + ".info");
+		if (Utils::FileSystem::exists(file.path))
+			Utils::FileSystem::removeFile(file.path);
+
+		totalSize -= file.size;
+		removed++;
+	}
+
+	if (removed > 0)
+		LOG(LogInfo) << "ScraperCache : " << removed << " entries removed, " << (totalSize / 1024) << " KB left";
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef ES_APP_SCRAPERS_SCRAPER_CACHE_H
+#define ES_APP_SCRAPERS_SCRAPER_CACHE_H
+
+#include <string>
+#include <ctime>
+
+class HttpReq;
+class HttpReqOptions;
+
+// On-disk cache of scraper responses & medias, stored under ~/.emulationstation/cache/scraper
+// Entries are keyed by a hash of the request url (which holds the scraper, game id/crc & media type)
+// Fresh entries are served without any network access, stale ones are revalidated with ETag/Last-Modified
+// Medias are not copied in the cache : their entry points to the file saved in the game folders
+class ScraperCache
+{
+public:
+	struct Entry
+	{
+		Entry() : date(0) { }
+
+		std::string key;
+		std::string path;	// cached data, or saved media
+
+		std::string etag;
+		std::string lastModified;
+		std::string contentType;
+		time_t		date;
+
+		bool exists() const { return date != 0; }
+		bool isFresh() const;
+		bool hasValidators() const { return !etag.empty() || !lastModified.empty(); }
+	};
+
+	static bool isEnabled();
+
+	// When set, cached entries are ignored & replaced by the server responses
+	static void setRefresh(bool refresh);
+
+	// Removes the entries unused for months, then the least recently used ones while the cache is over ScraperCacheMaxSize (MB)
+	static void purge();
+
+	static Entry get(const std::string& url);
+
+	// Adds If-None-Match / If-Modified-Since headers when the entry can be revalidated
+	static void addValidationHeaders(const Entry& entry, HttpReqOptions& options);
+
+	static std::string readContent(const Entry& entry);
+
+	static void put(const std::string& url, HttpReq* request, const std::string& content);
+	static void putFile(const std::string& url, HttpReq* request, const std::string& filePath);
+
+	// Called when the server answered 304 : the cached data is fresh again
+	static void touch(const Entry& entry);
+
+private:
+	static std::string getCachePath();
+	static std::string getKey(const std::string& url);
+	static void writeEntryInfo(const std::string& path, const std::string& etag, const std::string& lastModified, const std::string& contentType, const std::string& file = "");
+};
+
+#endif // ES_APP_SCRAPERS_SCRAPER_CACHE_H
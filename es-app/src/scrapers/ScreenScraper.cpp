@@ -320,11 +320,8 @@ void ScreenScraperScraper::generateRequests(const ScraperSearchParams& params,
 }
 
 // Process should return false only when we reached a maximum scrap by minute, to retry
-bool ScreenScraperRequest::process(HttpReq* request, std::vector<ScraperSearchResult>& results)
+bool ScreenScraperRequest::process(const std::string& content, std::vector<ScraperSearchResult>& results)
 {
-	assert(request->status() == HttpReq::REQ_SUCCESS);
-
-	auto content = request->getContent();
 	if (content.empty())
 		return false;
 
@@ -346,7 +343,10 @@ bool ScreenScraperRequest::process(HttpReq* request, std::vector<ScraperSearchRe
 		LOG(LogWarning) << err;
 				
 		if (Utils::String::toLower(content).find("maximum threads per minute reached") != std::string::npos)
+		{
+			mThrottled = true;
 			return false;
+		}
 		
 		return true;
 	}
@@ -886,7 +886,7 @@ ScreenScraperUser ScreenScraperRequest::processUserInfo(const pugi::xml_document
 	return user;
 }
 
-int ScreenScraperScraper::getThreadCount(std::string &result)
+bool ScreenScraperScraper::getQuota(ScraperQuota& quota, std::string &result)
 {
 	ScreenScraperRequest::ScreenScraperConfig ssConfig;
 	std::string url = ssConfig.getUserInfoUrl();
@@ -898,7 +898,7 @@ int ScreenScraperScraper::getThreadCount(std::string &result)
 	{
 		result = httpreq.getErrorMsg();
 		result = Utils::String::trim(Utils::String::replace(result, "<br>", "\r\n"));
-		return -1;
+		return false;
 	}
 
 	auto content = httpreq.getContent();
@@ -909,13 +909,16 @@ int ScreenScraperScraper::getThreadCount(std::string &result)
 	{
 		auto userInfo = ScreenScraperRequest::processUserInfo(doc);
 		
-		// userInfo.maxRequestsPerMin / userInfo.maxthreads;
-
 		if (userInfo.maxthreads > 0)
-			return userInfo.maxthreads;
+			quota.maxThreads = userInfo.maxthreads;
+
+		quota.maxRequestsPerMin = userInfo.maxRequestsPerMin;
+
+		if (userInfo.maxRequestsPerDay > 0)
+			quota.remainingRequestsToday = std::max(0, userInfo.maxRequestsPerDay - userInfo.requestsToday);
 	}	
 
-	return 1;
+	return true;
 }
 
 #endif
\ No newline at end of file
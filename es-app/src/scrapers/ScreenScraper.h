@@ -20,7 +20,7 @@ public:
 		std::vector<ScraperSearchResult>& results) override;
 
 	bool isSupportedPlatform(SystemData* system) override;
-	int getThreadCount(std::string &result) override;
+	bool getQuota(ScraperQuota& quota, std::string &result) override;
 
 	const std::set<ScraperMediaSource>& getSupportedMedias() override;
 };
@@ -79,7 +79,7 @@ public:
 	static ScreenScraperUser processUserInfo(const pugi::xml_document& xmldoc);
 
 protected:
-	bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) override;
+	bool process(const std::string& content, std::vector<ScraperSearchResult>& results) override;
 	std::string ensureUrl(const std::string url);
 	
 	void processGame(const pugi::xml_document& xmldoc, std::vector<ScraperSearchResult>& results);
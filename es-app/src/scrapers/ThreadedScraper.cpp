@@ -1,4 +1,5 @@
 #include "ThreadedScraper.h"
+#include "scrapers/ScraperCache.h"
 #include "Window.h"
 #include "FileData.h"
 #include "components/AsyncNotificationComponent.h"
@@ -6,35 +7,40 @@
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
 #include "Log.h"
+#include "math/Misc.h"
+#include <SDL_timer.h>
+#include <algorithm>
 
 #define GUIICON _U("\uF03E ")
 
 ThreadedScraper* ThreadedScraper::mInstance = nullptr;
 bool ThreadedScraper::mPaused = false;
 
-ThreadedScraper::ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches, int threadCount)
-	: mSearchQueue(searches), mWindow(window)
+ThreadedScraper::ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches, const ScraperQuota& quota)
+	: mSearchQueue(searches), mWindow(window), mRateLimiter(quota.maxRequestsPerMin)
 {
 	mExitCode = ASYNC_IN_PROGRESS;
 	mTotal = (int) mSearchQueue.size();
+	mNextThreadId = 0;
+
+	mMaxThreads = Math::max(1, quota.maxThreads);
+	mConcurrency = mMaxThreads;
+	mFinishedSinceAdjust = 0;
+	mMinLatency = 0;
+	mAverageLatency = 0;
+	mRemainingRequests = quota.remainingRequestsToday;
+
+	LOG(LogInfo) << "ThreadedScraper : " << mMaxThreads << " threads, " << quota.maxRequestsPerMin << " requests/min, " << mRemainingRequests << " requests left today";
 
 	mWndNotification = mWindow->createAsyncNotificationComponent();
 	mWndNotification->updateTitle(GUIICON + _("SCRAPING"));
 
-	for (int i = 0; i < threadCount; i++)
-	{
-		if (mSearchQueue.size() == 0)
-			break;
-
-		ScraperThread* thread = new ScraperThread(i);
-		mScraperThreads.push_back(thread);
-		ProcessNextGame(thread);
-	}	
+	startSearches();
 
 	mHandle = new std::thread(&ThreadedScraper::run, this);	
 }
 
-void ThreadedScraper::ProcessNextGame(ScraperThread* thread)
+void ThreadedScraper::ProcessNextGame(ScraperThread* thread, std::unique_ptr<ScraperSearchHandle> search)
 {
 	auto item = mSearchQueue.front();
 	mSearchQueue.pop();
@@ -42,11 +48,97 @@ void ThreadedScraper::ProcessNextGame(ScraperThread* thread)
 
 	LOG(LogInfo) << "[Thread " << thread->mThreadId << "] ProcessNextGame : " << mCurrentGame;
 
-	thread->run(item);
+	thread->run(item, std::move(search));
 
 	updateUI();
 }
 
+int ThreadedScraper::getSearchCount()
+{
+	int count = 0;
+
+	for (auto scraperThread : mScraperThreads)
+		if (scraperThread->isSearching())
+			count++;
+
+	return count;
+}
+
+// Metadata lookups and media downloads are pipelined : a game can be looked up while the medias of the previous ones are downloading.
+// Lookups & downloads share the thread limit of the account, and new lookups are started while the quotas allow them.
+// Lookups answered from the scraper cache don't use the rate limiter nor the daily quota.
+bool ThreadedScraper::startSearches()
+{
+	bool started = false;
+
+	while (!mSearchQueue.empty())
+	{
+		if (getSearchCount() >= mConcurrency || (int)mScraperThreads.size() >= mMaxThreads)
+			break;
+
+		// Kept until the quotas allow it, so the cache is only checked once per game
+		if (mNextSearch == nullptr)
+			mNextSearch = Scraper::getScraper()->search(mSearchQueue.front());
+
+		if (!mNextSearch->isCacheHit())
+		{
+			if (mRemainingRequests == 0 || !mRateLimiter.tryAcquire())
+				break;
+
+			if (mRemainingRequests > 0)
+				mRemainingRequests--;
+		}
+
+		ScraperThread* thread = new ScraperThread(mNextThreadId++);
+		mScraperThreads.push_back(thread);
+		ProcessNextGame(thread, std::move(mNextSearch));
+		started = true;
+	}
+
+	return started;
+}
+
+// Additive increase / multiplicative decrease of the lookup concurrency.
+// When the latency grows while we add threads, the server is saturated : adding more only gets us throttled.
+void ThreadedScraper::onSearchFinished(int latency, bool throttled)
+{
+	if (throttled)
+	{
+		mConcurrency = Math::max(1, mConcurrency / 2);
+		mFinishedSinceAdjust = 0;
+		mRateLimiter.drain();
+
+		LOG(LogDebug) << "ThreadedScraper : throttled by server, concurrency is now " << mConcurrency;
+		return;
+	}
+
+	latency = Math::max(1, latency);
+
+	if (mMinLatency == 0 || latency < mMinLatency)
+		mMinLatency = latency;
+
+	if (mAverageLatency == 0)
+		mAverageLatency = (float)latency;
+	else
+		mAverageLatency = mAverageLatency * 0.8f + latency * 0.2f;
+
+	// Adjust once per round of lookups
+	mFinishedSinceAdjust++;
+	if (mFinishedSinceAdjust < mConcurrency)
+		return;
+
+	mFinishedSinceAdjust = 0;
+
+	if (mAverageLatency > mMinLatency * 2.0f && mConcurrency > 1)
+		mConcurrency--;
+	else if (mAverageLatency < mMinLatency * 1.5f && mConcurrency < mMaxThreads)
+		mConcurrency++;
+	else
+		return;
+
+	LOG(LogDebug) << "ThreadedScraper : average latency " << (int)mAverageLatency << "ms (min " << mMinLatency << "ms), concurrency is now " << mConcurrency;
+}
+
 ThreadedScraper::~ThreadedScraper()
 {
 	mWndNotification->close();
@@ -58,6 +150,7 @@ ThreadedScraper::~ThreadedScraper()
 	mScraperThreads.clear();
 
 	ThreadedScraper::mInstance = nullptr;
+	ScraperCache::setRefresh(false);
 }
 
 std::string ThreadedScraper::formatGameName(FileData* game)
@@ -70,9 +163,15 @@ ScraperThread::ScraperThread(int threadId)
 	mThreadId = threadId;
 	mErrorStatus = 0;
 	mStatus = ASYNC_IN_PROGRESS;
+
+	mSearchStartTime = 0;
+	mSearchLatency = 0;
+	mSearchFinished = false;
+	mSearchThrottled = false;
+	mSearchCached = false;
 }
 
-void ScraperThread::run(const ScraperSearchParams& params)
+void ScraperThread::run(const ScraperSearchParams& params, std::unique_ptr<ScraperSearchHandle> search)
 {
 	mResult = ScraperSearchResult();
 	mErrorStatus = 0;
@@ -81,7 +180,22 @@ void ScraperThread::run(const ScraperSearchParams& params)
 	mSearch = params;
 	mMDResolveHandle.reset();
 
-	mSearchHandle = Scraper::getScraper()->search(params);
+	mSearchFinished = false;
+	mSearchStartTime = SDL_GetTicks();
+	mSearchHandle = std::move(search);
+}
+
+bool ScraperThread::popSearchStats(int& latency, bool& throttled, bool& cached)
+{
+	if (!mSearchFinished)
+		return false;
+
+	mSearchFinished = false;
+
+	latency = mSearchLatency;
+	throttled = mSearchThrottled;
+	cached = mSearchCached;
+	return true;
 }
 
 int ScraperThread::updateState()
@@ -95,6 +209,11 @@ int ScraperThread::updateState()
 
 		LOG(LogInfo) << "[Thread " << mThreadId << "] ThreadedScraper::SearchResponse : " << httpCode << " " << statusString;
 
+		mSearchLatency = SDL_GetTicks() - mSearchStartTime;
+		mSearchThrottled = mSearchHandle->isThrottled();
+		mSearchCached = mSearchHandle->isCached();
+		mSearchFinished = true;
+
 		mSearchHandle.reset();
 
 		if (status == ASYNC_DONE)
@@ -152,6 +271,8 @@ void ThreadedScraper::processError(int status, const std::string statusString)
 
 void ThreadedScraper::run()
 {
+	ScraperCache::purge();
+
 	while (mExitCode == ASYNC_IN_PROGRESS)
 	{
 		if (mPaused)
@@ -162,8 +283,10 @@ void ThreadedScraper::run()
 				std::this_thread::sleep_for(std::chrono::milliseconds(500));
 			}
 		}
-		
-		for (auto iter = mScraperThreads.cbegin(); iter != mScraperThreads.cend(); ++iter)
+
+		bool changed = false;
+
+		for (auto iter = mScraperThreads.begin(); iter != mScraperThreads.end(); )
 		{
 			if (mExitCode != ASYNC_IN_PROGRESS)
 				break;
@@ -171,6 +294,18 @@ void ThreadedScraper::run()
 			auto mScraperThread = *iter;
 
 			int state = mScraperThread->updateState();
+
+			int latency;
+			bool throttled, cached;
+			if (mScraperThread->popSearchStats(latency, throttled, cached))
+			{
+				// Cached responses don't tell anything about the server
+				if (!cached || throttled)
+					onSearchFinished(latency, throttled);
+
+				changed = true;
+			}
+
 			switch (state)
 			{
 			case ASYNC_DONE:
@@ -182,27 +317,48 @@ void ThreadedScraper::run()
 				break;
 
 			default:
-				//std::this_thread::yield();
-				// std::this_thread::sleep_for(std::chrono::milliseconds(10));
 				break;
 			}
 
-			if (mExitCode == ASYNC_IN_PROGRESS && state != ASYNC_IN_PROGRESS)
+			if (state == ASYNC_IN_PROGRESS)
 			{
-				if (!mSearchQueue.empty())
-					ProcessNextGame(mScraperThread);
-				else
-				{					
-					mScraperThreads.erase(iter);
-					if (mScraperThreads.size() == 0)
-					{
-						mExitCode = ASYNC_DONE;
-						LOG(LogDebug) << "ThreadedScraper::finished";
-					}
-					break;
-				}
+				++iter;
+				continue;
+			}
+
+			delete mScraperThread;
+			iter = mScraperThreads.erase(iter);
+			changed = true;
+		}
+
+		if (mExitCode != ASYNC_IN_PROGRESS)
+			break;
+
+		if (startSearches())
+			changed = true;
+
+		if (mScraperThreads.size() == 0)
+		{
+			if (mSearchQueue.empty())
+			{
+				mExitCode = ASYNC_DONE;
+				LOG(LogDebug) << "ThreadedScraper::finished";
+				break;
+			}
+
+			if (mRemainingRequests == 0)
+			{
+				mExitCode = ASYNC_ERROR;
+
+				Window* w = mWindow;
+				mWindow->postToUiThread([w]() { w->pushGui(new GuiMsgBox(w, _("SCRAPE FAILED") + " : " + _("DAILY REQUEST QUOTA REACHED"))); });
+				break;
 			}
 		}
+
+		// Nothing to do until a request completes, or the rate limiter gives a new token
+		if (!changed)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
 	}
 	
 	if (mExitCode == ASYNC_DONE)
@@ -212,6 +368,42 @@ void ThreadedScraper::run()
 	ThreadedScraper::mInstance = nullptr;
 }
 
+ScraperRateLimiter::ScraperRateLimiter(int requestsPerMinute)
+{
+	// 0 means unknown : no limit
+	mRatePerMs = requestsPerMinute > 0 ? requestsPerMinute / 60000.0 : 0;
+	mCapacity = Math::max(1.0f, requestsPerMinute / 6.0f);
+	mTokens = mCapacity;
+	mLastRefill = SDL_GetTicks();
+}
+
+void ScraperRateLimiter::refill()
+{
+	int now = SDL_GetTicks();
+	mTokens = std::min(mCapacity, mTokens + (now - mLastRefill) * mRatePerMs);
+	mLastRefill = now;
+}
+
+bool ScraperRateLimiter::tryAcquire()
+{
+	if (mRatePerMs <= 0)
+		return true;
+
+	refill();
+
+	if (mTokens < 1.0)
+		return false;
+
+	mTokens -= 1.0;
+	return true;
+}
+
+void ScraperRateLimiter::drain()
+{
+	refill();
+	mTokens = 0;
+}
+
 void ThreadedScraper::updateUI()
 {
 	int remaining = mTotal + 1 - mSearchQueue.size() - mScraperThreads.size();
@@ -256,23 +448,23 @@ void ThreadedScraper::acceptResult(ScraperThread& thread)
 	LOG(LogDebug) << "ThreadedScraper::acceptResult <<";
 }
 
-void ThreadedScraper::start(Window* window, const std::queue<ScraperSearchParams>& searches)
+void ThreadedScraper::start(Window* window, const std::queue<ScraperSearchParams>& searches, bool refreshCache)
 {
 	if (ThreadedScraper::mInstance != nullptr)
 		return;
 
 	std::string error;
-	int threadCount = Scraper::getScraper()->getThreadCount(error);
-	if (threadCount < 0)
+	ScraperQuota quota;
+	if (!Scraper::getScraper()->getQuota(quota, error))
 	{
 		window->pushGui(new GuiMsgBox(window, _("AN ERROR OCCURRED") + std::string(" :\r\n") + error));
 		return;
 	}
 
-	if (threadCount == 0)
-		threadCount = 1;
+	// Set before the first lookups are created
+	ScraperCache::setRefresh(refreshCache);
 
-	ThreadedScraper::mInstance = new ThreadedScraper(window, searches, threadCount);
+	ThreadedScraper::mInstance = new ThreadedScraper(window, searches, quota);
 }
 
 void ThreadedScraper::stop()
@@ -8,9 +8,15 @@ class ScraperThread
 {
 public:
 	ScraperThread(int threadId);
-	void run(const ScraperSearchParams& params);
+	void run(const ScraperSearchParams& params, std::unique_ptr<ScraperSearchHandle> search);
 	int updateState();
 
+	// Metadata lookup is the first stage of a game, media downloads are the second one
+	bool isSearching() { return mSearchHandle != nullptr; }
+
+	// Returns true only once, when the metadata lookup has just finished
+	bool popSearchStats(int& latency, bool& throttled, bool& cached);
+
 	ScraperSearchParams& getSearchParams() { return mSearch; }
 	ScraperSearchResult& getResult() { return mResult; }
 
@@ -39,17 +45,43 @@ private:
 	int mErrorStatus;
 	std::string mStatusString;
 
+	int  mSearchStartTime;
+	int  mSearchLatency;
+	bool mSearchFinished;
+	bool mSearchThrottled;
+	bool mSearchCached;
+
 	ScraperSearchResult mResult;
 	ScraperSearchParams mSearch;
 	std::unique_ptr<ScraperSearchHandle> mSearchHandle;
 	std::unique_ptr<MDResolveHandle> mMDResolveHandle;
 };
 
+// Token bucket : requests are spread over the minute, with a short burst allowed
+class ScraperRateLimiter
+{
+public:
+	ScraperRateLimiter(int requestsPerMinute);
+
+	bool tryAcquire();
+
+	// The server refused a request : wait for the bucket to refill
+	void drain();
+
+private:
+	void refill();
+
+	double mRatePerMs;
+	double mCapacity;
+	double mTokens;
+	int    mLastRefill;
+};
 
 class ThreadedScraper
 {
 public:
-	static void start(Window* window, const std::queue<ScraperSearchParams>& searches);
+	// refreshCache : the cached responses & medias are ignored and replaced
+	static void start(Window* window, const std::queue<ScraperSearchParams>& searches, bool refreshCache = false);
 	static void stop();
 	static bool isRunning() { return mInstance != nullptr; }
 	
@@ -59,10 +91,14 @@ public:
 	static std::string formatGameName(FileData* game);
 
 private:
-	ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches, int threadCount);
+	ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches, const ScraperQuota& quota);
 	~ThreadedScraper();
 
-	void ProcessNextGame(ScraperThread* thread);
+	void ProcessNextGame(ScraperThread* thread, std::unique_ptr<ScraperSearchHandle> search);
+
+	int  getSearchCount();
+	bool startSearches();
+	void onSearchFinished(int latency, bool throttled);
 
 	Window* mWindow;
 	AsyncNotificationComponent* mWndNotification;
@@ -75,6 +111,7 @@ private:
 
 	std::thread* mHandle;
 	std::queue<ScraperSearchParams> mSearchQueue;
+	std::unique_ptr<ScraperSearchHandle> mNextSearch; // lookup of the next game, waiting for the quotas
 
 	std::vector<ScraperThread*> mScraperThreads;
 	
@@ -84,6 +121,17 @@ private:
 
 	int mTotal;
 	int mExitCode;
+	int mNextThreadId;
+
+	// Adaptive concurrency of the metadata lookups, between 1 and mMaxThreads
+	int mMaxThreads;
+	int mConcurrency;
+	int mFinishedSinceAdjust;
+	int mMinLatency;
+	float mAverageLatency;
+
+	int mRemainingRequests;
+	ScraperRateLimiter mRateLimiter;
 
 	static bool mPaused;
 	static ThreadedScraper* mInstance;
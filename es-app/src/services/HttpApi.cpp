@@ -11,11 +11,29 @@
 #include "FileData.h"
 #include "views/ViewController.h"
 #include "CollectionSystemManager.h"
+#include "PowerSaver.h"
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 #include "utils/md5.h"
 #include "scrapers/Scraper.h"
 #include <unordered_map>
+#include <chrono>
+#include <time.h>
+
+#define GAMES_PER_CHUNK			128
+#define CATALOG_CHECK_DELAY		500		// ms
+#define CATALOG_WAIT_TIMEOUT	5		// s
+
+std::shared_ptr<const HttpApi::Catalog> HttpApi::sCatalog;
+std::mutex HttpApi::sCatalogLock;
+std::condition_variable HttpApi::sCatalogPublished;
+std::atomic<bool> HttpApi::sCatalogRequested(false);
+int HttpApi::sCatalogCheckTime = 0;
+
+unsigned int HttpApi::sPublishedTreeVersion = 0;
+unsigned int HttpApi::sPublishedChangeVersion = 0;
+std::unordered_map<FileData*, std::shared_ptr<const HttpApi::GameRecord>> HttpApi::sPublishedRecords;
+std::unordered_map<SystemData*, HttpApi::PublishedSystem> HttpApi::sPublishedSystems;
 
 void HttpApi::getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, SystemData* sys, bool localpaths)
 {
@@ -84,84 +102,310 @@ void HttpApi::getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>
 	writer.EndObject();
 }
 
-std::string HttpApi::getSystemList()
+std::string HttpApi::getFileDataId(FileData* game)
 {
-	rapidjson::StringBuffer s;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
-
-	writer.StartArray();
+	MD5 md5;
+	md5.update(game->getPath().c_str(), game->getPath().size());
+	md5.finalize();
+	return md5.hexdigest();
+}
 
-	for (auto sys : SystemData::sSystemVector)
-		getSystemDataJson(writer, sys);
+std::shared_ptr<const HttpApi::GameRecord> HttpApi::createGameRecord(FileData* game, const std::string& id)
+{
+	auto record = std::make_shared<GameRecord>();
+	record->file = game;
+	record->metadataVersion = game->getMetadata().getVersion();
+	record->id = id;
+	record->path = game->getPath();
+	record->name = game->getName();
+	record->systemName = game->getSystemName();
+	record->sourceSystemName = game->getSourceFileData()->getSystemName();
+
+	auto& mdds = MetaDataList::getMDD();
+	for (size_t i = 0; i < mdds.size(); i++)
+	{
+		if (mdds[i].id == MetaDataId::Name)
+			continue;
 
-	writer.EndArray();
+		std::string value = game->getMetadata(mdds[i].id);
+		if (!value.empty())
+			record->metadata.push_back(std::make_pair(i, value));
+	}
 
-	return s.GetString();
+	return record;
 }
 
-std::string HttpApi::getFileDataId(FileData* game)
+// Values of the system JSON which don't change the tree or metadata versions
+std::string HttpApi::getSystemStateKey(SystemData* sys)
 {
-	MD5 md5;
-	md5.update(game->getPath().c_str(), game->getPath().size());
-	md5.finalize();
-	return md5.hexdigest();
+	GameCountInfo* info = sys->getGameCountInfo();
+
+	std::string logo;
+
+	auto theme = sys->getTheme();
+	if (theme != nullptr)
+	{
+		const ThemeData::ThemeElement* elem = theme->getElement("system", "logo", "image");
+		if (elem && elem->has("path"))
+			logo = elem->get<std::string>("path");
+	}
+
+	return std::string(sys->isVisible() ? "1" : "0") + "|" + sys->getThemeFolder() + "|" + logo + "|" +
+		std::to_string(info->totalGames) + "|" + std::to_string(info->visibleGames) + "|" + std::to_string(info->favoriteCount) + "|" +
+		std::to_string(info->gamesPlayed) + "|" + std::to_string(info->hiddenCount) + "|" + info->mostPlayed;
 }
 
-FileData* HttpApi::findFileData(SystemData* system, const std::string& id)
+void HttpApi::getSystemGames(SystemData* sys, std::unordered_map<FileData*, std::shared_ptr<const GameRecord>>& records, std::vector<std::shared_ptr<const GameRecord>>& games)
 {
 	std::stack<FolderData*> stack;
-	stack.push(system->getRootFolder());
+	stack.push(sys->getRootFolder());
 
 	while (stack.size())
 	{
-		FolderData* current = stack.top();
+		FolderData* folder = stack.top();
 		stack.pop();
 
-		for (auto it : current->getChildren())
-		{			
-			if (it->getType() == FOLDER)
-				stack.push((FolderData*)it);
-			else if (getFileDataId(it) == id)
-				return it;
+		for (auto child : folder->getChildren())
+		{
+			if (child->getType() == FOLDER)
+			{
+				stack.push((FolderData*)child);
+				continue;
+			}
+
+			if (child->getType() != GAME)
+				continue;
+
+			std::shared_ptr<const GameRecord> record;
+
+			// Games which metadata did not change keep their record : ids (md5 of paths) are not computed again
+			auto it = sPublishedRecords.find(child);
+			if (it != sPublishedRecords.cend() && it->second->metadataVersion == child->getMetadata().getVersion())
+				record = it->second;
+			else
+				record = createGameRecord(child, getFileDataId(child));
+
+			records[child] = record;
+			games.push_back(record);
 		}
 	}
+}
 
-	return nullptr;
+std::shared_ptr<const HttpApi::SystemRecord> HttpApi::createSystemRecord(SystemData* sys, std::vector<std::shared_ptr<const GameRecord>>& games)
+{
+	auto system = std::make_shared<SystemRecord>();
+	system->name = sys->getName();
+
+	rapidjson::StringBuffer s;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+	getSystemDataJson(writer, sys, false);
+	system->json = s.GetString();
+
+	s.Clear();
+	writer.Reset(s);
+	getSystemDataJson(writer, sys, true);
+	system->jsonLocalPaths = s.GetString();
+
+	auto theme = sys->getTheme();
+	if (theme != nullptr)
+	{
+		const ThemeData::ThemeElement* elem = theme->getElement("system", "logo", "image");
+		if (elem && elem->has("path"))
+			system->logo = elem->get<std::string>("path");
+	}
+
+	system->games = std::move(games);
+
+	for (auto& record : system->games)
+		system->gamesById[record->id] = record;
+
+	return system;
+}
+
+// Only the systems whose games or state changed are walked & serialized again : 
+// while a system is scraped, the other systems keep their published snapshot.
+void HttpApi::publishCatalog()
+{
+	unsigned int treeVersion = FolderData::getTreeVersion();
+	unsigned int changeVersion = MetaDataList::getChangeVersion();
+
+	auto current = std::atomic_load(&sCatalog);
+
+	bool gamesChanged = current == nullptr || treeVersion != sPublishedTreeVersion || changeVersion != sPublishedChangeVersion;
+	bool changed = current == nullptr || SystemData::sSystemVector.size() != sPublishedSystems.size();
+
+	std::unordered_map<FileData*, std::shared_ptr<const GameRecord>> records;
+	std::unordered_map<SystemData*, PublishedSystem> systems;
+
+	for (auto sys : SystemData::sSystemVector)
+	{
+		PublishedSystem published;
+		published.stateKey = getSystemStateKey(sys);
+
+		auto prev = sPublishedSystems.find(sys);
+		bool reuse = prev != sPublishedSystems.cend() && prev->second.record->name == sys->getName() && prev->second.stateKey == published.stateKey;
+
+		std::vector<std::shared_ptr<const GameRecord>> games;
+
+		if (gamesChanged || !reuse)
+		{
+			getSystemGames(sys, records, games);
+			reuse = reuse && games == prev->second.record->games;
+		}
+		else
+		{
+			for (auto& record : prev->second.record->games)
+				records[record->file] = record;
+		}
+
+		if (reuse)
+			published.record = prev->second.record;
+		else
+		{
+			published.record = createSystemRecord(sys, games);
+			changed = true;
+		}
+
+		systems[sys] = published;
+	}
+
+	sPublishedRecords = std::move(records);
+	sPublishedTreeVersion = treeVersion;
+	sPublishedChangeVersion = changeVersion;
+
+	if (!changed)
+	{
+		sPublishedSystems = std::move(systems);
+		return;
+	}
+
+	auto catalog = std::make_shared<Catalog>();
+	catalog->version = current == nullptr ? 1 : current->version + 1;
+
+	catalog->systemList = "[";
+
+	for (auto sys : SystemData::sSystemVector)
+	{
+		auto& record = systems[sys].record;
+
+		if (catalog->systemList.size() > 1)
+			catalog->systemList += ",";
+
+		catalog->systemList += record->json;
+		catalog->systems[record->name] = record;
+	}
+
+	catalog->systemList += "]";
+
+	sPublishedSystems = std::move(systems);
+
+	{
+		std::unique_lock<std::mutex> lock(sCatalogLock);
+		std::atomic_store(&sCatalog, std::shared_ptr<const Catalog>(catalog));
+	}
+
+	sCatalogPublished.notify_all();
 }
 
-void HttpApi::getFileDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, FileData* game, bool localpaths)
+void HttpApi::update(int deltaTime)
 {
-	if (game->getType() != GAME)
+	// No copy of the game database until the web api is used
+	if (!sCatalogRequested)
+		return;
+
+	// A first request is waiting for the catalog : no delay
+	sCatalogCheckTime += deltaTime;
+	if (sCatalogCheckTime < CATALOG_CHECK_DELAY && std::atomic_load(&sCatalog) != nullptr)
 		return;
 
-	std::string id = getFileDataId(game);
+	sCatalogCheckTime = 0;
+	publishCatalog();
+}
+
+std::shared_ptr<const HttpApi::Catalog> HttpApi::getCatalog()
+{
+	sCatalogRequested = true;
+
+	auto catalog = std::atomic_load(&sCatalog);
+	if (catalog != nullptr)
+		return catalog;
+
+	// The main loop may be waiting for events in power saver mode
+	PowerSaver::pushRefreshEvent();
+
+	std::unique_lock<std::mutex> lock(sCatalogLock);
+	sCatalogPublished.wait_for(lock, std::chrono::seconds(CATALOG_WAIT_TIMEOUT), [] { return std::atomic_load(&sCatalog) != nullptr; });
+	return std::atomic_load(&sCatalog);
+}
+
+std::shared_ptr<const HttpApi::SystemRecord> HttpApi::Catalog::getSystem(const std::string& name) const
+{
+	auto it = systems.find(name);
+	if (it != systems.cend())
+		return it->second;
+
+	return nullptr;
+}
+
+FileData* HttpApi::findFileData(SystemData* system, const std::string& id)
+{
+	// Records of the catalog are up to date with the live tree after this : their file pointers are valid
+	sCatalogRequested = true;
+	publishCatalog();
+
+	auto catalog = std::atomic_load(&sCatalog);
+	if (catalog == nullptr)
+		return nullptr;
+
+	auto sys = catalog->getSystem(system->getName());
+	if (sys == nullptr)
+		return nullptr;
+
+	auto it = sys->gamesById.find(id);
+	if (it != sys->gamesById.cend())
+		return it->second->file;
+
+	return nullptr;
+}
+
+template<typename Writer>
+void HttpApi::getGameRecordJson(Writer& writer, const GameRecord& game, bool localpaths, const std::set<std::string>* fields)
+{
+	auto hasField = [fields](const std::string& name) { return fields == nullptr || fields->empty() || fields->find(name) != fields->cend(); };
 
 	writer.StartObject();
-	writer.Key("id"); writer.String(id.c_str());
-	writer.Key("path"); writer.String(game->getPath().c_str());
-	writer.Key("name"); writer.String(game->getName().c_str());
+	writer.Key("id"); writer.String(game.id.c_str());
 
-	writer.Key("systemName"); writer.String(game->getSystemName().c_str());
+	if (hasField("path"))
+	{
+		writer.Key("path"); writer.String(game.path.c_str());
+	}
 
-	auto meta = game->getMetadata();
-	for (auto mdd : MetaDataList::getMDD())
+	if (hasField("name"))
 	{
-		if (mdd.id == MetaDataId::Name)
-			continue;
+		writer.Key("name"); writer.String(game.name.c_str());
+	}
 
-		std::string value = game->getMetadata(mdd.id);
-		if (!value.empty())
-		{
-			if (meta.getType(mdd.id) == MD_PATH && localpaths == false)
-				value = "/systems/" + game->getSourceFileData()->getSystemName() + "/games/" + id + "/media/" + mdd.key;
+	if (hasField("systemName"))
+	{
+		writer.Key("systemName"); writer.String(game.systemName.c_str());
+	}
 
-			if (mdd.id == MetaDataId::ScraperId)
-				writer.Key("scraperId");
-			else 
-				writer.Key(mdd.key.c_str());
+	auto& mdds = MetaDataList::getMDD();
+	for (auto& item : game.metadata)
+	{
+		auto& mdd = mdds[item.first];
 
-			writer.String(value.c_str());
-		}
+		const std::string& key = mdd.id == MetaDataId::ScraperId ? "scraperId" : mdd.key;
+		if (!hasField(key))
+			continue;
+
+		writer.Key(key.c_str());
+
+		if (mdd.type == MD_PATH && localpaths == false)
+			writer.String(("/systems/" + game.sourceSystemName + "/games/" + game.id + "/media/" + mdd.key).c_str());
+		else
+			writer.String(item.second.c_str());
 	}
 
 	writer.EndObject();
@@ -264,53 +508,77 @@ bool HttpApi::ImportMedia(FileData* file, const std::string& mediaType, const st
 	return false;
 }
 
-std::string HttpApi::ToJson(FileData* file, bool localpaths)
+std::string HttpApi::ToJson(const GameRecord& game, bool localpaths)
 {
 	rapidjson::StringBuffer s;
 	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
-	getFileDataJson(writer, file, localpaths);
+	getGameRecordJson(writer, game, localpaths);
 	return s.GetString();
 }
 
-std::string HttpApi::ToJson(SystemData* system, bool localpaths)
+std::string HttpApi::ToJson(FileData* file, bool localpaths)
 {
-	rapidjson::StringBuffer s;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
-	getSystemDataJson(writer, system, localpaths);
-	return s.GetString();
+	if (file->getType() != GAME)
+		return "";
+
+	return ToJson(*createGameRecord(file, getFileDataId(file)), localpaths);
 }
 
-std::string HttpApi::getSystemGames(SystemData* system)
+std::string HttpApi::getSystemGamesETag(const Catalog& catalog)
 {
-	rapidjson::StringBuffer s;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+	// Versions restart from 1 with the process : the start time makes tags of two runs different
+	static const std::string startTime = std::to_string((long long)time(NULL));
 
-	writer.StartArray();
+	return "\"" + startTime + "-" + std::to_string(catalog.version) + "\"";
+}
 
-	std::vector<FileData*> files;
+std::function<bool(std::string& chunk)> HttpApi::getSystemGamesWriter(const std::shared_ptr<const SystemRecord>& system, const GamesQuery& query)
+{
+	struct WriterState
+	{
+		std::shared_ptr<const SystemRecord> system;
+		GamesQuery query;
+		size_t start;
+		size_t position;
+		size_t end;
+	};
+
+	auto state = std::make_shared<WriterState>();
+	state->system = system;
+	state->query = query;
+	state->start = std::min(query.offset, system->games.size());
+	state->position = state->start;
+	state->end = query.limit == 0 ? system->games.size() : std::min(state->start + query.limit, system->games.size());
+
+	return [state](std::string& chunk)
+	{
+		chunk.clear();
 
-	std::stack<FolderData*> stack;
-	stack.push(system->getRootFolder());
+		if (state->position == state->start)
+			chunk += "[";
 
-	while (stack.size())
-	{
-		FolderData* current = stack.top();
-		stack.pop();
+		rapidjson::StringBuffer s;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(s);
 
-		for (auto it : current->getChildren())
+		size_t last = std::min(state->position + GAMES_PER_CHUNK, state->end);
+		for (; state->position < last; state->position++)
 		{
-			files.push_back(it);
-			if (it->getType() == FOLDER)
-				stack.push((FolderData*)it);
+			// Each game is a separate root value for the writer : the array itself is written by hand
+			if (state->position != state->start)
+				chunk += ",";
+
+			s.Clear();
+			writer.Reset(s);
+			getGameRecordJson(writer, *state->system->games[state->position], state->query.localpaths, &state->query.fields);
+			chunk.append(s.GetString(), s.GetSize());
 		}
-	}
-
-	for (auto game : files)
-		getFileDataJson(writer, game);
 
-	writer.EndArray();
+		if (state->position < state->end)
+			return true;
 
-	return s.GetString();
+		chunk += "]";
+		return false;
+	};
 }
 
 std::string HttpApi::getRunnningGameInfo()
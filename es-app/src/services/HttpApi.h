@@ -1,10 +1,20 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/pointer.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 class SystemData;
 class FileData;
@@ -12,24 +22,108 @@ class FileData;
 class HttpApi
 {
 public:
+	struct GamesQuery
+	{
+		GamesQuery() : offset(0), limit(0), localpaths(false) { }
+
+		size_t offset;
+		size_t limit;					// 0 = all games
+		std::set<std::string> fields;	// empty = all fields, "id" is always written
+		bool localpaths;
+	};
+
+	// Immutable copy of a game, read by the http threads
+	struct GameRecord
+	{
+		FileData* file;					// identifies the game when the catalog is rebuilt, only dereferenced on the UI thread
+		unsigned int metadataVersion;
+
+		std::string id;
+		std::string path;
+		std::string name;
+		std::string systemName;
+		std::string sourceSystemName;
+
+		std::vector<std::pair<size_t, std::string>> metadata; // index in MetaDataList::getMDD(), value
+	};
+
+	struct SystemRecord
+	{
+		std::string name;
+		std::string json;
+		std::string jsonLocalPaths;
+		std::string logo;
+
+		std::vector<std::shared_ptr<const GameRecord>> games;
+		std::unordered_map<std::string, std::shared_ptr<const GameRecord>> gamesById;
+	};
+
+	// Immutable copy of the game database. The UI thread publishes a new one after changes,
+	// http threads read it without locks & never see the live SystemData/FileData being changed.
+	struct Catalog
+	{
+		unsigned int version;
+		std::string systemList;
+		std::map<std::string, std::shared_ptr<const SystemRecord>> systems;
+
+		std::shared_ptr<const SystemRecord> getSystem(const std::string& name) const;
+	};
+
+	// Called by the http threads : waits for the first catalog if none is published yet, can return nullptr
+	static std::shared_ptr<const Catalog> getCatalog();
+
+	// Called by the UI thread : publishes a new catalog when the game database changed & the web api is used
+	static void update(int deltaTime);
+
 	static std::string getCaps();
-	static std::string getSystemList();
-	static std::string getSystemGames(SystemData* system);
+
+	// Changes each time a game is added, removed or edited : unchanged systems can be answered with 304
+	static std::string getSystemGamesETag(const Catalog& catalog);
+
+	// Returns a function writing the compact JSON game list by chunks. It fills "chunk", and returns false once the list is complete.
+	static std::function<bool(std::string& chunk)> getSystemGamesWriter(const std::shared_ptr<const SystemRecord>& system, const GamesQuery& query);
 
 	static std::string getRunnningGameInfo();
 
-	static std::string ToJson(SystemData* system, bool localpaths = false);
+	static std::string ToJson(const GameRecord& game, bool localpaths = false);
 	static std::string ToJson(FileData* file, bool localpaths = false);
 
+	// UI thread only
 	static FileData*   findFileData(SystemData* system, const std::string& id);
 
 	static bool ImportFromJson(FileData* file, const std::string& json);
 
 	static bool ImportMedia(FileData* file, const std::string& mediaType, const std::string& contentType, const std::string& mediaBytes);
-	
+
 
 private:
+	struct PublishedSystem
+	{
+		std::shared_ptr<const SystemRecord> record;
+		std::string stateKey;
+	};
+
+	static std::shared_ptr<const GameRecord> createGameRecord(FileData* game, const std::string& id);
+	static std::shared_ptr<const SystemRecord> createSystemRecord(SystemData* sys, std::vector<std::shared_ptr<const GameRecord>>& games);
+	static void getSystemGames(SystemData* sys, std::unordered_map<FileData*, std::shared_ptr<const GameRecord>>& records, std::vector<std::shared_ptr<const GameRecord>>& games);
+	static std::string getSystemStateKey(SystemData* sys);
+	static void publishCatalog();
+
+	static std::shared_ptr<const Catalog> sCatalog;
+	static std::mutex sCatalogLock;
+	static std::condition_variable sCatalogPublished;
+	static std::atomic<bool> sCatalogRequested;
+	static int sCatalogCheckTime;
+
+	static unsigned int sPublishedTreeVersion;
+	static unsigned int sPublishedChangeVersion;
+	static std::unordered_map<FileData*, std::shared_ptr<const GameRecord>> sPublishedRecords;
+	static std::unordered_map<SystemData*, PublishedSystem> sPublishedSystems;
+
 	static std::string getFileDataId(FileData* game);
-	static void getFileDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, FileData* game, bool localpaths = false);
+
+	template<typename Writer>
+	static void getGameRecordJson(Writer& writer, const GameRecord& game, bool localpaths = false, const std::set<std::string>* fields = nullptr);
+
 	static void getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, SystemData* sys, bool localpaths = false);
 };
@@ -12,6 +12,8 @@
 #include "FileData.h"
 #include "views/ViewController.h"
 #include <unordered_map>
+#include <future>
+#include <atomic>
 #include "CollectionSystemManager.h"
 #include "guis/GuiMenu.h"
 #include "guis/GuiMsgBox.h"
@@ -136,6 +138,58 @@ static bool isAllowed(const httplib::Request& req, httplib::Response& res)
 	return true;
 }
 
+#define UI_THREAD_TIMEOUT	10	// s
+
+static std::shared_ptr<const HttpApi::Catalog> getCatalog(httplib::Response& res)
+{
+	auto catalog = HttpApi::getCatalog();
+	if (catalog == nullptr)
+	{
+		res.set_content("503 - Game database not available", "text/html");
+		res.status = 503;
+	}
+
+	return catalog;
+}
+
+bool HttpServerThread::runOnUiThread(const std::function<bool()>& func, httplib::Response& res)
+{
+	// Games are only changed by the UI thread : http threads read the published catalog
+	auto result = std::make_shared<std::promise<bool>>();
+	auto future = result->get_future();
+
+	// A change answered with 503 must never be applied : the task is cancelled unless it is already running
+	enum TaskState { TASK_PENDING, TASK_RUNNING, TASK_CANCELLED };
+	auto state = std::make_shared<std::atomic<int>>(TASK_PENDING);
+
+	mWindow->postToUiThread([result, state, func]()
+	{
+		int expected = TASK_PENDING;
+		if (!state->compare_exchange_strong(expected, TASK_RUNNING))
+			return;
+
+		result->set_value(func());
+	});
+
+	if (future.wait_for(std::chrono::seconds(UI_THREAD_TIMEOUT)) != std::future_status::ready)
+	{
+		int expected = TASK_PENDING;
+		if (state->compare_exchange_strong(expected, TASK_CANCELLED))
+		{
+			res.set_content("503 - Busy", "text/html");
+			res.status = 503;
+			return false;
+		}
+	}
+
+	return future.get();
+}
+
+void HttpServerThread::update(int deltaTime)
+{
+	HttpApi::update(deltaTime);
+}
+
 void HttpServerThread::run()
 {
 	mHttpServer = new httplib::Server();
@@ -264,7 +318,9 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		res.set_content(HttpApi::getSystemList(), "application/json");
+		auto catalog = getCatalog(res);
+		if (catalog != nullptr)
+			res.set_content(catalog->systemList, "application/json");
 	});
 
 	mHttpServer->Get("/runningGame", [](const httplib::Request& req, httplib::Response& res)
@@ -311,24 +367,18 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
-		if (system != nullptr)
+		auto catalog = getCatalog(res);
+		if (catalog == nullptr)
+			return;
+
+		auto system = catalog->getSystem(req.matches[1]);
+		if (system != nullptr && !system->logo.empty())
 		{
-			auto theme = system->getTheme();
-			if (theme != nullptr)
+			auto data = ResourceManager::getInstance()->getFileData(system->logo);
+			if (data.ptr)
 			{
-				const ThemeData::ThemeElement* elem = theme->getElement("system", "logo", "image");
-				if (elem && elem->has("path"))
-				{
-					std::string logo = elem->get<std::string>("path");
-					auto data = ResourceManager::getInstance()->getFileData(logo);
-					if (data.ptr)
-					{
-						res.set_content((char*)data.ptr.get(), data.length, getMimeType(logo).c_str());
-						return;
-					}
-				}
+				res.set_content((char*)data.ptr.get(), data.length, getMimeType(system->logo).c_str());
+				return;
 			}
 		}
 
@@ -341,11 +391,53 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
+		auto catalog = getCatalog(res);
+		if (catalog == nullptr)
+			return;
+
+		auto system = catalog->getSystem(req.matches[1]);
 		if (system != nullptr)
 		{
-			res.set_content(HttpApi::getSystemGames(system), "application/json");
+			std::string etag = HttpApi::getSystemGamesETag(*catalog);
+			res.set_header("ETag", etag);
+
+			if (req.has_header("If-None-Match") && req.get_header_value("If-None-Match") == etag)
+			{
+				res.status = 304;
+				return;
+			}
+
+			HttpApi::GamesQuery query;
+			query.localpaths = req.has_param("localpaths") && req.get_param_value("localpaths") == "true";
+
+			if (req.has_param("offset"))
+				query.offset = (size_t)std::max(0, Utils::String::toInteger(req.get_param_value("offset")));
+
+			if (req.has_param("limit"))
+				query.limit = (size_t)std::max(0, Utils::String::toInteger(req.get_param_value("limit")));
+
+			if (req.has_param("fields"))
+				for (auto field : Utils::String::split(req.get_param_value("fields"), ',', true))
+					query.fields.insert(Utils::String::trim(field));
+
+			// Written by chunks : large systems are not built as one big string
+			auto writer = HttpApi::getSystemGamesWriter(system, query);
+
+			res.set_header("Content-Type", "application/json");
+			res.set_chunked_content_provider([writer](size_t offset, httplib::DataSink& sink)
+			{
+				std::string chunk;
+				bool more = writer(chunk);
+
+				if (!chunk.empty())
+					sink.write(chunk.data(), chunk.size());
+
+				if (!more)
+					sink.done();
+
+				return true;
+			});
+
 			return;
 		}
 		
@@ -358,30 +450,29 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
+		auto catalog = getCatalog(res);
+		if (catalog == nullptr)
+			return;
+
+		auto system = catalog->getSystem(req.matches[1]);
 		if (system != nullptr)
 		{
-			std::string gameId = req.matches[2];
-			auto game = HttpApi::findFileData(system, gameId);
-			if (game != nullptr)
+			auto game = system->gamesById.find(req.matches[2]);
+			if (game != system->gamesById.cend())
 			{
 				std::string metadataName = req.matches[3];
 
-				if (game->getMetadata().getType(metadataName) == MD_PATH)
+				auto& mdds = MetaDataList::getMDD();
+				for (auto& item : game->second->metadata)
 				{
-					std::string path = game->getMetadata().get(metadataName);
-					if (!path.empty())
-					{
-						auto data = ResourceManager::getInstance()->getFileData(path);
-						if (data.ptr)
-						{
-							res.set_content((char*)data.ptr.get(), data.length, getMimeType(path).c_str());
-							return;
-						}
-
-						return;
-					}
+					if (mdds[item.first].key != metadataName || mdds[item.first].type != MD_PATH)
+						continue;
+
+					auto data = ResourceManager::getInstance()->getFileData(item.second);
+					if (data.ptr)
+						res.set_content((char*)data.ptr.get(), data.length, getMimeType(item.second).c_str());
+
+					return;
 				}
 			}
 		}
@@ -412,27 +503,31 @@ void HttpServerThread::run()
 		std::string contentType = req.get_header_value("Content-Type");
 		
 		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
-		if (system != nullptr)
+		std::string gameId = req.matches[2];
+		std::string metadataName = req.matches[3];
+		std::string body = req.body;
+
+		bool imported = runOnUiThread([systemName, gameId, metadataName, contentType, body]()
 		{
-			std::string gameId = req.matches[2];
+			SystemData* system = SystemData::getSystem(systemName);
+			if (system == nullptr)
+				return false;
+
 			auto game = HttpApi::findFileData(system, gameId);
-			if (game != nullptr)
-			{
-				std::string metadataName = req.matches[3];
+			if (game == nullptr || game->getMetadata().getType(metadataName) != MD_PATH)
+				return false;
 
-				if (game->getMetadata().getType(metadataName) == MD_PATH)
-				{
-					if (HttpApi::ImportMedia(game, metadataName, contentType, req.body))
-					{
-						if (ViewController::hasInstance())
-							mWindow->postToUiThread([game]() { ViewController::get()->onFileChanged(game, FileChangeType::FILE_METADATA_CHANGED); });
+			if (!HttpApi::ImportMedia(game, metadataName, contentType, body))
+				return false;
 
-						return;
-					}
-				}
-			}
-		}
+			if (ViewController::hasInstance())
+				ViewController::get()->onFileChanged(game, FileChangeType::FILE_METADATA_CHANGED);
+
+			return true;
+		}, res);
+
+		if (imported || res.status == 503)
+			return;
 
 		res.set_content("404 media not found", "text/html");
 		res.status = 404;
@@ -452,22 +547,27 @@ void HttpServerThread::run()
 		}
 
 		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
-		if (system != nullptr)
+		std::string gameId = req.matches[2];
+		std::string body = req.body;
+
+		bool imported = runOnUiThread([systemName, gameId, body]()
 		{
-			std::string gameId = req.matches[2];
+			SystemData* system = SystemData::getSystem(systemName);
+			if (system == nullptr)
+				return false;
+
 			auto game = HttpApi::findFileData(system, gameId);
-			if (game != nullptr)
-			{
-				if (HttpApi::ImportFromJson(game, req.body))
-				{
-					if (ViewController::hasInstance())
-						mWindow->postToUiThread([game]() { ViewController::get()->onFileChanged(game, FileChangeType::FILE_METADATA_CHANGED); });					
+			if (game == nullptr || !HttpApi::ImportFromJson(game, body))
+				return false;
 
-					return;
-				}
-			}
-		}
+			if (ViewController::hasInstance())
+				ViewController::get()->onFileChanged(game, FileChangeType::FILE_METADATA_CHANGED);
+
+			return true;
+		}, res);
+
+		if (imported || res.status == 503)
+			return;
 
 		res.set_content("404 game not found", "text/html");
 		res.status = 404;
@@ -479,16 +579,18 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
+		auto catalog = getCatalog(res);
+		if (catalog == nullptr)
+			return;
+
+		auto system = catalog->getSystem(req.matches[1]);
 		if (system != nullptr)
 		{
-			std::string gameId = req.matches[2];
-			auto game = HttpApi::findFileData(system, gameId);
-			if (game != nullptr)
+			auto game = system->gamesById.find(req.matches[2]);
+			if (game != system->gamesById.cend())
 			{
 				bool localpaths = req.has_param("localpaths") && req.get_param_value("localpaths") == "true";
-				res.set_content(HttpApi::ToJson(game, localpaths), "application/json");
+				res.set_content(HttpApi::ToJson(*game->second, localpaths), "application/json");
 				return;
 			}
 		}
@@ -502,12 +604,15 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
-		std::string systemName = req.matches[1];
-		SystemData* system = SystemData::getSystem(systemName);
+		auto catalog = getCatalog(res);
+		if (catalog == nullptr)
+			return;
+
+		auto system = catalog->getSystem(req.matches[1]);
 		if (system != nullptr)
 		{
 			bool localpaths = req.has_param("localpaths") && req.get_param_value("localpaths") == "true";
-			res.set_content(HttpApi::ToJson(system, localpaths), "application/json");
+			res.set_content(localpaths ? system->jsonLocalPaths : system->json, "application/json");
 			return;
 		}
 
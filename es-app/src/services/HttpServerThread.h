@@ -1,11 +1,13 @@
 #pragma once
 
 #include "Window.h"
+#include <functional>
 #include <thread>
 
 namespace httplib
 {
 	class Server;
+	struct Response;
 }
 
 class HttpServerThread
@@ -16,6 +18,9 @@ public:
 
 	static std::string getMimeType(const std::string &path);
 
+	// Publishes the game database read by the web api, called by the UI thread
+	void update(int deltaTime);
+
 private:
 	Window*			mWindow;
 	bool			mRunning;
@@ -25,6 +30,9 @@ private:
 	httplib::Server* mHttpServer;
 
 	void run();
+
+	// Runs func on the UI thread & waits for its result, sets a 503 status if the UI thread is busy
+	bool runOnUiThread(const std::function<bool()>& func, httplib::Response& res);
 };
 
 
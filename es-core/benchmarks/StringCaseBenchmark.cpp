@@ -0,0 +1,411 @@
+// Checks the SSE2/NEON paths of the Utils::String case helpers against the scalar code they replaced,
+// then times both on the game names of real gamelists.
+//
+// Usage : es-core-benchmark [gamelist.xml | names.txt] ...
+// Text files are read one name per line. Returns 1 on the first mismatch.
+
+#include "utils/StringUtil.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Reference
+{
+	// Scalar implementations as they were before the SSE2/NEON paths, kept apart from StringUtil.cpp so a change there can't hide in both.
+	// Two fixes were carried over : three byte characters are written with '=' instead of '+=',
+	// and startsWithIgnoreCase stops at the end of name2 instead of reading past both strings.
+
+	// The Unicode tables are private to StringUtil.cpp. A single character never fills a 16 byte block,
+	// so the library maps it with its scalar code only.
+	static unsigned int toupperUnicode(unsigned int c)
+	{
+		std::string upper = Utils::String::toUpper(Utils::String::unicode2Chars(c));
+		size_t cursor = 0;
+		return Utils::String::chars2Unicode(upper, cursor);
+	}
+
+	static unsigned int tolowerUnicode(unsigned int c)
+	{
+		std::string lower = Utils::String::toLower(Utils::String::unicode2Chars(c));
+		size_t cursor = 0;
+		return Utils::String::chars2Unicode(lower, cursor);
+	}
+
+	static std::string changeCase(const std::string& _string, bool upper)
+	{
+		std::string text = _string;
+
+		size_t i = 0;
+		while (i < text.length())
+		{
+			char c = text[i];
+			if ((c & 0x80) == 0)
+			{
+				if (upper && c >= 'a' && c <= 'z')
+					text[i] = c - 0x20;
+				else if (!upper && c >= 'A' && c <= 'Z')
+					text[i] = c + 0x20;
+
+				i++;
+				continue;
+			}
+
+			size_t pos = i;
+			wchar_t character = (wchar_t)Utils::String::chars2Unicode(text, i);
+			wchar_t unicode = (wchar_t)(upper ? toupperUnicode(character) : tolowerUnicode(character));
+			if (unicode != character)
+			{
+				size_t charSize = i - pos;
+				if (charSize == 2)
+				{
+					text[pos] = (char)(((unicode >> 6) & 0xFF) | 0xC0);
+					text[pos + 1] = (char)((unicode & 0x3F) | 0x80);
+				}
+				else if (charSize == 3)
+				{
+					text[pos] = (char)(((unicode >> 12) & 0xFF) | 0xE0);
+					text[pos + 1] = (char)(((unicode >> 6) & 0x3F) | 0x80);
+					text[pos + 2] = (char)((unicode & 0x3F) | 0x80);
+				}
+			}
+		}
+
+		return text;
+	}
+
+	static std::string toLower(const std::string& _string) { return changeCase(_string, false); }
+	static std::string toUpper(const std::string& _string) { return changeCase(_string, true); }
+
+	static int makeUp(const std::string& name, size_t& cursor)
+	{
+		char c = name[cursor];
+		if ((c & 0x80) == 0)
+		{
+			cursor++;
+			return (c >= 'a' && c <= 'z') ? c - 0x20 : c;
+		}
+
+		return (int)toupperUnicode(Utils::String::chars2Unicode(name, cursor));
+	}
+
+	static bool startsWithIgnoreCase(const std::string& name1, const std::string& name2)
+	{
+		size_t p1 = 0;
+		size_t p2 = 0;
+
+		while (true)
+		{
+			int u1 = makeUp(name1, p1);
+			int u2 = makeUp(name2, p2);
+
+			if (u2 == 0)
+				return true;
+
+			if (u1 != u2)
+				return false;
+		}
+	}
+
+	static int compareIgnoreCase(const std::string& name1, const std::string& name2)
+	{
+		size_t p1 = 0;
+		size_t p2 = 0;
+
+		while (true)
+		{
+			int u1 = makeUp(name1, p1);
+			int u2 = makeUp(name2, p2);
+
+			if (u1 == 0 && u2 != 0)
+				return -1;
+			else if (u1 != 0 && u2 == 0)
+				return 1;
+			else if (u1 == 0 || u2 == 0)
+				return 0;
+
+			u1 -= u2;
+			if (u1)
+				return u1;
+		}
+	}
+
+	static bool containsIgnoreCase(const std::string& _string, const std::string& _what)
+	{
+		if (_what.empty())
+			return true;
+
+		auto it = std::search(
+			_string.begin(), _string.end(),
+			_what.begin(), _what.end(),
+			[](char ch1, char ch2) { return toupper((unsigned char)ch1) == toupper((unsigned char)ch2); }
+		);
+
+		return (it != _string.end());
+	}
+}
+
+static std::string quote(const std::string& text)
+{
+	std::string ret;
+	for (unsigned char c : text)
+	{
+		if (c >= 0x20 && c < 0x7F)
+			ret += (char)c;
+		else
+			ret += Utils::String::format("\\x%02X", c);
+	}
+
+	return "\"" + ret + "\"";
+}
+
+static bool checkCase(const std::string& text)
+{
+	std::string lower = Utils::String::toLower(text);
+	std::string upper = Utils::String::toUpper(text);
+
+	std::string lowerInPlace = text;
+	Utils::String::toLower(lowerInPlace, lowerInPlace);
+	std::string upperInPlace = text;
+	Utils::String::toUpper(upperInPlace, upperInPlace);
+
+	std::string expectedLower = Reference::toLower(text);
+	std::string expectedUpper = Reference::toUpper(text);
+
+	if (lower != expectedLower || lowerInPlace != expectedLower)
+	{
+		printf("toLower(%s) = %s, expected %s\n", quote(text).c_str(), quote(lower != expectedLower ? lower : lowerInPlace).c_str(), quote(expectedLower).c_str());
+		return false;
+	}
+
+	if (upper != expectedUpper || upperInPlace != expectedUpper)
+	{
+		printf("toUpper(%s) = %s, expected %s\n", quote(text).c_str(), quote(upper != expectedUpper ? upper : upperInPlace).c_str(), quote(expectedUpper).c_str());
+		return false;
+	}
+
+	return true;
+}
+
+static bool checkPair(const std::string& a, const std::string& b)
+{
+	int compare = Utils::String::compareIgnoreCase(a, b);
+	int expectedCompare = Reference::compareIgnoreCase(a, b);
+	if (compare != expectedCompare)
+	{
+		printf("compareIgnoreCase(%s, %s) = %d, expected %d\n", quote(a).c_str(), quote(b).c_str(), compare, expectedCompare);
+		return false;
+	}
+
+	bool startsWith = Utils::String::startsWithIgnoreCase(a, b);
+	if (startsWith != Reference::startsWithIgnoreCase(a, b))
+	{
+		printf("startsWithIgnoreCase(%s, %s) = %d, expected %d\n", quote(a).c_str(), quote(b).c_str(), startsWith, !startsWith);
+		return false;
+	}
+
+	bool contains = Utils::String::containsIgnoreCase(a, b);
+	if (contains != Reference::containsIgnoreCase(a, b))
+	{
+		printf("containsIgnoreCase(%s, %s) = %d, expected %d\n", quote(a).c_str(), quote(b).c_str(), contains, !contains);
+		return false;
+	}
+
+	return true;
+}
+
+// Every byte value at every position of two 16 byte blocks of mixed case ASCII,
+// so each lane and the block boundaries see both the case ranges and their neighbours
+static bool checkByteRange()
+{
+	const std::string pattern = "aBcDeFgHiJkLmNoPqRsTuVwXyZ@[`{0~";
+	const std::string tail = "Zz@`[{ end"; // Keeps multibyte lead bytes inside the string
+
+	for (int value = 0; value < 256; value++)
+	{
+		if (value == 0)
+			continue;
+
+		for (size_t pos = 0; pos < pattern.length(); pos++)
+		{
+			std::string text = pattern + tail;
+			text[pos] = (char)value;
+
+			if (!checkCase(text))
+				return false;
+
+			std::string same = Reference::toUpper(pattern + tail);
+			std::string other = Reference::toLower(pattern + tail);
+			other[pos] = (char)(value ^ 0x20);
+
+			if (!checkPair(text, same) || !checkPair(same, text) || !checkPair(text, other) || !checkPair(text + text, other))
+				return false;
+
+			if (!checkPair(text, Reference::toLower(text.substr(0, pos + 1))) || !checkPair(text, Reference::toUpper(text.substr(pos, 18))))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkUtf8()
+{
+	const std::vector<std::string> names =
+	{
+		"Pok\xC3\xA9mon - \xC3\x89" "dition Rouge (France) (SGB Enhanced)",
+		"\xC3\x89" "COLE DE PILOTAGE \xC3\xA9" "cole de pilotage",
+		"\xEF\xBC\xA6\xEF\xBD\x95\xEF\xBD\x8C\xEF\xBD\x8C Width Title \xEF\xBC\xA1\xEF\xBD\x82\xEF\xBD\x83",
+		"\xCE\x91\xCE\xB2\xCE\xB3 Greek letters in the middle of a long ASCII title",
+		"\xE2\x92\xB6\xE2\x93\x91 circled letters",
+	};
+
+	for (auto& name : names)
+	{
+		if (!checkCase(name))
+			return false;
+
+		for (auto& other : names)
+			if (!checkPair(name, other) || !checkPair(name, Reference::toUpper(name)) || !checkPair(name, Reference::toLower(name.substr(name.length() / 2))))
+				return false;
+	}
+
+	return true;
+}
+
+static void readCorpus(const std::string& path, std::vector<std::string>& names)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		printf("Unable to open %s\n", path.c_str());
+		return;
+	}
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string content = buffer.str();
+
+	if (Utils::String::endsWith(Utils::String::toLower(path), ".xml"))
+	{
+		for (auto name : Utils::String::extractStrings(content, "<name>", "</name>"))
+			names.push_back(Utils::String::decodeXmlString(name));
+
+		return;
+	}
+
+	for (auto line : Utils::String::split(content, '\n', true))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.empty())
+			names.push_back(line);
+	}
+}
+
+static double measure(const std::function<void()>& work)
+{
+	auto start = std::chrono::steady_clock::now();
+	work();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double reference, double current)
+{
+	printf("  %-22s scalar %9.3f ms   current %9.3f ms   x%.2f\n", name, reference, current, current > 0 ? reference / current : 0.0);
+}
+
+static bool benchmarkCorpus(const std::vector<std::string>& names)
+{
+	// Corpus results must match too
+	for (auto& name : names)
+		if (!checkCase(name))
+			return false;
+
+	// Searches use the middle of existing names, as typed in the gamelist filter
+	std::vector<std::string> queries;
+	for (size_t i = 0; i < names.size() && queries.size() < 16; i += std::max<size_t>(1, names.size() / 16))
+		if (names[i].length() > 4)
+			queries.push_back(Utils::String::toLower(names[i].substr(names[i].length() / 3, 4)));
+
+	queries.push_back("zzqx");
+
+	const int rounds = std::max<int>(1, (int)(200000 / std::max<size_t>(1, names.size())));
+	printf("Corpus : %d names, %d rounds\n", (int)names.size(), rounds);
+
+	size_t sink = 0;
+
+	double referenceTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& name : names) sink += Reference::toLower(name).length(); });
+	double currentTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& name : names) sink += Utils::String::toLower(name).length(); });
+	report("toLower", referenceTime, currentTime);
+
+	referenceTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& name : names) sink += Reference::toUpper(name).length(); });
+	currentTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& name : names) sink += Utils::String::toUpper(name).length(); });
+	report("toUpper", referenceTime, currentTime);
+
+	std::vector<std::string> sortedByReference = names;
+	std::vector<std::string> sortedByCurrent = names;
+
+	referenceTime = measure([&] { std::stable_sort(sortedByReference.begin(), sortedByReference.end(), [](const std::string& a, const std::string& b) { return Reference::compareIgnoreCase(a, b) < 0; }); });
+	currentTime = measure([&] { std::stable_sort(sortedByCurrent.begin(), sortedByCurrent.end(), [](const std::string& a, const std::string& b) { return Utils::String::compareIgnoreCase(a, b) < 0; }); });
+	report("compareIgnoreCase sort", referenceTime, currentTime);
+
+	if (sortedByReference != sortedByCurrent)
+	{
+		printf("compareIgnoreCase sorts the corpus differently\n");
+		return false;
+	}
+
+	size_t referenceCount = 0;
+	size_t currentCount = 0;
+
+	referenceTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& query : queries) for (auto& name : names) referenceCount += Reference::containsIgnoreCase(name, query); });
+	currentTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& query : queries) for (auto& name : names) currentCount += Utils::String::containsIgnoreCase(name, query); });
+	report("containsIgnoreCase", referenceTime, currentTime);
+
+	if (referenceCount != currentCount)
+	{
+		printf("containsIgnoreCase finds %d matches, expected %d\n", (int)currentCount, (int)referenceCount);
+		return false;
+	}
+
+	referenceCount = currentCount = 0;
+
+	referenceTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& query : queries) for (auto& name : names) referenceCount += Reference::startsWithIgnoreCase(name, query); });
+	currentTime = measure([&] { for (int r = 0; r < rounds; r++) for (auto& query : queries) for (auto& name : names) currentCount += Utils::String::startsWithIgnoreCase(name, query); });
+	report("startsWithIgnoreCase", referenceTime, currentTime);
+
+	if (referenceCount != currentCount)
+	{
+		printf("startsWithIgnoreCase finds %d matches, expected %d\n", (int)currentCount, (int)referenceCount);
+		return false;
+	}
+
+	return sink != 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (!checkByteRange() || !checkUtf8())
+		return 1;
+
+	printf("Case folding matches the scalar reference\n");
+
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; i++)
+		readCorpus(argv[i], names);
+
+	if (names.empty())
+	{
+		printf("No corpus, pass gamelist.xml files or name lists to time the helpers\n");
+		return 0;
+	}
+
+	return benchmarkCorpus(names) ? 0 : 1;
+}
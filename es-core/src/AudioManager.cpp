@@ -11,6 +11,7 @@
 #include "id3v2lib/include/id3v2lib.h"
 #include "ThemeData.h"
 #include "Paths.h"
+#include <algorithm>
 
 #ifdef WIN32
 #include <time.h>
@@ -25,7 +26,8 @@
 AudioManager* AudioManager::sInstance = NULL;
 std::vector<std::shared_ptr<Sound>> AudioManager::sSoundVector;
 
-AudioManager::AudioManager() : mInitialized(false), mCurrentMusic(nullptr), mMusicVolume(MIX_MAX_VOLUME), mVideoPlaying(false)
+AudioManager::AudioManager() : mInitialized(false), mCurrentMusic(nullptr), mMusicVolume(MIX_MAX_VOLUME), mVideoPlaying(false),
+	mPrefetchThread(nullptr), mPrefetchTerminate(false), mPrefetchedMusic(nullptr), mMusicEnded(false)
 {
 	init();
 }
@@ -84,6 +86,9 @@ void AudioManager::init()
 
 		mMusicVolume = getMaxMusicVolume();
 		Mix_VolumeMusic(mMusicVolume);
+
+		mPrefetchTerminate = false;
+		mPrefetchThread = new std::thread(&AudioManager::prefetchThread, this);
 	}
 }
 
@@ -108,6 +113,22 @@ void AudioManager::deinit()
 	Mix_HookMusicFinished(nullptr);
 	Mix_HaltMusic();
 
+	if (mPrefetchThread != nullptr)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mPrefetchLock);
+			mPrefetchTerminate = true;
+		}
+
+		mPrefetchEvent.notify_all();
+		mPrefetchThread->join();
+		delete mPrefetchThread;
+		mPrefetchThread = nullptr;
+	}
+
+	clearPrefetchedMusic();
+	mMusicEnded = false;
+
 	//completely tear down SDL audio. else SDL hogs audio resources and emulators might fail to start...
 	Mix_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -151,25 +172,43 @@ void AudioManager::stop()
 
 void AudioManager::getMusicIn(const std::string &path, std::vector<std::string>& all_matching_files)
 {
-	if (!Utils::FileSystem::isDirectory(path))
-		return;
-
-	bool anySystem = !Settings::getInstance()->getBool("audio.persystem");
+	time_t lastWriteTime = Utils::FileSystem::getFileModificationDate(path).getTime();
 
-	auto dirContent = Utils::FileSystem::getDirContent(path);
-	for (auto it = dirContent.cbegin(); it != dirContent.cend(); ++it)
+	auto it = mMusicDirectories.find(path);
+	if (it == mMusicDirectories.cend() || it->second.lastWriteTime != lastWriteTime)
 	{
-		if (Utils::FileSystem::isDirectory(*it))
+		if (!Utils::FileSystem::isDirectory(path))
 		{
-			if (*it == "." || *it == "..")
-				continue;
+			if (it != mMusicDirectories.cend())
+				mMusicDirectories.erase(it);
+
+			return;
+		}
+
+		MusicDirectory& directory = mMusicDirectories[path];
+		directory.lastWriteTime = lastWriteTime;
+		directory.files.clear();
+		directory.directories.clear();
 
-			if (anySystem || mSystemName == Utils::FileSystem::getFileName(*it))
-				getMusicIn(*it, all_matching_files);
+		for (auto file : Utils::FileSystem::getDirectoryFiles(path))
+		{
+			if (file.directory)
+				directory.directories.push_back(file.path);
+			else if (Utils::FileSystem::isAudio(file.path))
+				directory.files.push_back(file.path);
 		}
-		else if (Utils::FileSystem::isAudio(*it))
-			all_matching_files.push_back(*it);
+
+		it = mMusicDirectories.find(path);
 	}
+
+	bool anySystem = !Settings::getInstance()->getBool("audio.persystem");
+
+	const MusicDirectory& directory = it->second;
+	all_matching_files.insert(all_matching_files.end(), directory.files.cbegin(), directory.files.cend());
+
+	for (auto subDirectory : directory.directories)
+		if (anySystem || mSystemName == Utils::FileSystem::getFileName(subDirectory))
+			getMusicIn(subDirectory, all_matching_files);
 }
 
 // batocera
@@ -231,21 +270,115 @@ void AudioManager::playRandomMusic(bool continueIfPlaying)
 	if (musics.empty())
 		return;
 
-	int randomIndex = Randomizer::random(musics.size());
-	while (songWasPlayedRecently(musics.at(randomIndex)))
-	{
-		LOG(LogDebug) << "Music \"" << musics.at(randomIndex) << "\" was played recently, trying again";
-		randomIndex = Randomizer::random(musics.size());
-	}
-
 	// continue playing ?
 	if (mCurrentMusic != nullptr && continueIfPlaying)
 		return;
 
-	playMusic(musics.at(randomIndex));
-	playSong(musics.at(randomIndex));
-	addLastPlayed(musics.at(randomIndex), musics.size());
+	std::string song;
+
+	// Use the track preloaded by the prefetch thread if it still belongs to the current playlist
+	{
+		std::unique_lock<std::mutex> lock(mPrefetchLock);
+		if (!mPrefetchedPath.empty() && !songWasPlayedRecently(mPrefetchedPath) && std::find(musics.cbegin(), musics.cend(), mPrefetchedPath) != musics.cend())
+			song = mPrefetchedPath;
+	}
+
+	if (song.empty())
+	{
+		int randomIndex = Randomizer::random(musics.size());
+		while (songWasPlayedRecently(musics.at(randomIndex)))
+		{
+			LOG(LogDebug) << "Music \"" << musics.at(randomIndex) << "\" was played recently, trying again";
+			randomIndex = Randomizer::random(musics.size());
+		}
+
+		song = musics.at(randomIndex);
+	}
+
+	playMusic(song);
+	playSong(song);
+	addLastPlayed(song, musics.size());
 	mPlayingSystemThemeSong = "";
+
+	prefetchMusic(musics);
+}
+
+void AudioManager::prefetchMusic(const std::vector<std::string>& musics)
+{
+	if (mPrefetchThread == nullptr || musics.size() < 2)
+		return;
+
+	int randomIndex = Randomizer::random(musics.size());
+	for (int i = 0; i < 10 && (musics.at(randomIndex) == mCurrentMusicPath || songWasPlayedRecently(musics.at(randomIndex))); i++)
+		randomIndex = Randomizer::random(musics.size());
+
+	std::unique_lock<std::mutex> lock(mPrefetchLock);
+	if (mPrefetchedPath == musics.at(randomIndex))
+		return;
+
+	mPrefetchRequest = musics.at(randomIndex);
+	mPrefetchEvent.notify_one();
+}
+
+void AudioManager::prefetchThread()
+{
+	while (true)
+	{
+		std::string path;
+
+		{
+			std::unique_lock<std::mutex> lock(mPrefetchLock);
+			mPrefetchEvent.wait(lock, [this] { return mPrefetchTerminate || !mPrefetchRequest.empty(); });
+
+			if (mPrefetchTerminate)
+				break;
+
+			path = mPrefetchRequest;
+			mPrefetchRequest = "";
+		}
+
+		// Parse tags now, so playSong only has to read the cache
+		getSongNameFromFile(path);
+
+		Mix_Music* music = Mix_LoadMUS(path.c_str());
+		if (music == nullptr)
+			LOG(LogWarning) << "AudioManager prefetch : " << Mix_GetError() << " for " << path;
+
+		std::unique_lock<std::mutex> lock(mPrefetchLock);
+
+		if (mPrefetchedMusic != nullptr)
+			Mix_FreeMusic(mPrefetchedMusic);
+
+		mPrefetchedMusic = music;
+		mPrefetchedPath = music == nullptr ? "" : path;
+
+		if (mPrefetchTerminate)
+			break;
+	}
+}
+
+Mix_Music* AudioManager::takePrefetchedMusic(const std::string& path)
+{
+	std::unique_lock<std::mutex> lock(mPrefetchLock);
+	if (mPrefetchedMusic == nullptr || mPrefetchedPath != path)
+		return nullptr;
+
+	Mix_Music* music = mPrefetchedMusic;
+	mPrefetchedMusic = nullptr;
+	mPrefetchedPath = "";
+	return music;
+}
+
+void AudioManager::clearPrefetchedMusic()
+{
+	std::unique_lock<std::mutex> lock(mPrefetchLock);
+
+	if (mPrefetchedMusic != nullptr)
+		Mix_FreeMusic(mPrefetchedMusic);
+
+	mPrefetchedMusic = nullptr;
+	mPrefetchedPath = "";
+	mPrefetchRequest = "";
 }
 
 void AudioManager::playMusic(std::string path)
@@ -259,8 +392,11 @@ void AudioManager::playMusic(std::string path)
 	if (!Settings::BackgroundMusic())
 		return;
 
-	// load a new music
-	mCurrentMusic = Mix_LoadMUS(path.c_str());
+	// load a new music, unless it was already loaded by the prefetch thread
+	mCurrentMusic = takePrefetchedMusic(path);
+	if (mCurrentMusic == NULL)
+		mCurrentMusic = Mix_LoadMUS(path.c_str());
+
 	if (mCurrentMusic == NULL)
 	{
 		LOG(LogError) << Mix_GetError() << " for " << path;
@@ -279,13 +415,8 @@ void AudioManager::playMusic(std::string path)
 
 void AudioManager::musicEnd_callback()
 {
-	if (!AudioManager::getInstance()->mPlayingSystemThemeSong.empty())
-	{
-		AudioManager::getInstance()->playMusic(AudioManager::getInstance()->mPlayingSystemThemeSong);
-		return;
-	}
-
-	AudioManager::getInstance()->playRandomMusic(false);
+	// Called from the SDL_mixer audio thread : the next track is started by update(), on the UI thread
+	AudioManager::getInstance()->mMusicEnded = true;
 }
 
 void AudioManager::stopMusic(bool fadeOut)
@@ -294,6 +425,7 @@ void AudioManager::stopMusic(bool fadeOut)
 		return;
 
 	Mix_HookMusicFinished(nullptr);
+	mMusicEnded = false;
 
 	if (fadeOut)
 	{
@@ -326,9 +458,6 @@ void AudioManager::setSongName(const std::string& song)
 
 void AudioManager::playSong(const std::string& song)
 {
-	if (song == mCurrentSong)
-		return;
-
 	if (song.empty())
 	{
 		mSongNameChanged = true;
@@ -336,6 +465,11 @@ void AudioManager::playSong(const std::string& song)
 		return;
 	}
 
+	setSongName(getSongNameFromFile(song));
+}
+
+static std::string readSongName(const std::string& song)
+{
 	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(song));
 	// chiptunes mod song titles parsing
 	if (ext == ".mod" || ext == ".s3m" || ext == ".stm" || ext == ".669" || ext == ".mtm" || ext == ".far" || ext == ".xm" || ext == ".it" )
@@ -374,8 +508,7 @@ void AudioManager::playSong(const std::string& song)
 				break;
 			default:
 				LOG(LogError) << "Error AudioManager unexpected case while loading mofile " << song;
-				setSongName(Utils::FileSystem::getStem(song.c_str()));				
-				return;
+				return Utils::FileSystem::getStem(song.c_str());
 		}
 
 		FILE* file = fopen(song.c_str(), "r");
@@ -392,9 +525,8 @@ void AudioManager::playSong(const std::string& song)
 				std::string name = info.title;
 				if (!name.empty())
 				{
-					setSongName(name);
 					fclose(file);
-					return;
+					return name;
 				}
 			}
 
@@ -407,11 +539,10 @@ void AudioManager::playSong(const std::string& song)
 	// now only mp3 will be parsed for ID3: .ogg, .wav and .flac will display file name
 	if (ext != ".mp3")
 	{
-		setSongName(Utils::FileSystem::getStem(song.c_str()));
-		return;
+		return Utils::FileSystem::getStem(song.c_str());
 	}
 
-	LOG(LogDebug) << "AudioManager::setSongName";
+	LOG(LogDebug) << "AudioManager::readSongName";
 
 	// First let's try with an ID3 v2 tag
 #define MAX_STR_SIZE 255 // Empiric max size of a MP3 title
@@ -439,11 +570,10 @@ void AudioManager::playSong(const std::string& song)
 					}
 				}
 				song_name.erase(std::remove_if(song_name.begin(), song_name.end(), [](unsigned char c) { return !Utils::String::isPrintableChar(c); }), song_name.end());
-				setSongName(song_name);
 				free(title_content->data);
 				free(title_content);
 				free_tag(tag);
-				return;
+				return song_name;
 			}
 		}
 		free_tag(tag);
@@ -476,9 +606,8 @@ void AudioManager::playSong(const std::string& song)
 				std::string songArtist(info.artist, 30);
 				songTitle += " - " + songArtist.substr(0, 30);
 			}
-			setSongName(songTitle);
 			fclose(file);
-			return;
+			return songTitle;
 		}
 
 		fclose(file);
@@ -486,7 +615,24 @@ void AudioManager::playSong(const std::string& song)
 	else
 		LOG(LogError) << "Error AudioManager opening mp3 file " << song;
 
-	setSongName(Utils::FileSystem::getStem(song.c_str()));
+	return Utils::FileSystem::getStem(song.c_str());
+}
+
+std::string AudioManager::getSongNameFromFile(const std::string& song)
+{
+	{
+		std::unique_lock<std::mutex> lock(mSongNamesLock);
+
+		auto it = mSongNames.find(song);
+		if (it != mSongNames.cend())
+			return it->second;
+	}
+
+	std::string name = readSongName(song);
+
+	std::unique_lock<std::mutex> lock(mSongNamesLock);
+	mSongNames[song] = name;
+	return name;
 }
 
 void AudioManager::changePlaylist(const std::shared_ptr<ThemeData>& theme, bool force)
@@ -564,6 +710,16 @@ void AudioManager::update(int deltaTime)
 	if (sInstance == nullptr || !sInstance->mInitialized || !Settings::BackgroundMusic())
 		return;
 
+	if (sInstance->mMusicEnded)
+	{
+		sInstance->mMusicEnded = false;
+
+		if (!sInstance->mPlayingSystemThemeSong.empty())
+			sInstance->playMusic(sInstance->mPlayingSystemThemeSong);
+		else
+			sInstance->playRandomMusic(false);
+	}
+
 	float deltaVol = deltaTime / 8.0f;
 
 //	#define MINVOL 5
@@ -9,6 +9,11 @@
 #include <string> 
 #include <iostream> 
 #include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 #include <math.h>
 
 class Sound;
@@ -36,6 +41,36 @@ private:
 	bool		mInitialized;
 	std::string	mPlayingSystemThemeSong;
 
+	// Music library : directory listings are kept and only rescanned when the directory modification time changes
+	struct MusicDirectory
+	{
+		time_t lastWriteTime;
+		std::vector<std::string> files;
+		std::vector<std::string> directories;
+	};
+
+	std::map<std::string, MusicDirectory> mMusicDirectories;
+
+	// Song names (ID3 / module titles) by path, filled by the prefetch thread
+	std::map<std::string, std::string> mSongNames;
+	std::mutex	mSongNamesLock;
+
+	// Prefetch thread : loads the next track in background so that song changes don't block the UI
+	void prefetchThread();
+	void prefetchMusic(const std::vector<std::string>& musics);
+	Mix_Music* takePrefetchedMusic(const std::string& path);
+	void clearPrefetchedMusic();
+
+	std::thread*			mPrefetchThread;
+	std::mutex				mPrefetchLock;
+	std::condition_variable	mPrefetchEvent;
+	bool					mPrefetchTerminate;
+	std::string				mPrefetchRequest;
+	std::string				mPrefetchedPath;
+	Mix_Music*				mPrefetchedMusic;
+
+	std::atomic<bool>		mMusicEnded;
+
 public:
 	static AudioManager* getInstance();
 	static bool isInitialized();
@@ -73,6 +108,7 @@ public:
 
 private:
 	void playSong(const std::string& song);
+	std::string getSongNameFromFile(const std::string& song);
 	void setSongName(const std::string& song);
 	void addLastPlayed(const std::string& newSong, int totalMusic);
 	bool songWasPlayedRecently(const std::string& song);
@@ -15,11 +15,82 @@
 #endif
 
 #include <mutex>
-static std::mutex mMutex;
+#include <condition_variable>
+#include <algorithm>
 
-CURLM* HttpReq::s_multi_handle = curl_multi_init();
+// Recursive : completion callbacks are called with the lock held, and may start new requests
+static std::recursive_mutex mMutex;
+static std::condition_variable_any mEvent;
+
+#ifdef HTTPREQ_IO_THREAD
+static std::thread* s_ioThread = nullptr;
+static std::thread::id s_ioThreadId;
+static bool s_ioThreadTerminate = false;
+#endif
+
+static std::mutex s_shareLocks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+	s_shareLocks[data].lock();
+}
+
+static void share_unlock(CURL* handle, curl_lock_data data, void* userptr)
+{
+	s_shareLocks[data].unlock();
+}
+
+static CURLM* createMultiHandle()
+{
+	CURLM* multi = curl_multi_init();
+
+#ifdef CURLPIPE_MULTIPLEX
+	// Parallel requests to the same HTTP/2 host share a single connection
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+	return multi;
+}
+
+static CURLSH* createShareHandle()
+{
+	// DNS cache & TLS sessions are shared between all requests. Connections are already pooled by the multi handle.
+	CURLSH* share = curl_share_init();
+	curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+	curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	return share;
+}
+
+CURLM* HttpReq::s_multi_handle = createMultiHandle();
+CURLSH* HttpReq::s_share_handle = createShareHandle();
 
 std::map<CURL*, HttpReq*> HttpReq::s_requests;
+std::vector<CURL*> HttpReq::s_pendingAdd;
+std::vector<CURL*> HttpReq::s_pendingRemove;
+
+#ifdef HTTPREQ_IO_THREAD
+// Stops the I/O thread at exit, before the static state it uses is destroyed
+static struct HttpReqIOThreadGuard
+{
+	~HttpReqIOThreadGuard()
+	{
+		if (s_ioThread == nullptr)
+			return;
+
+		{
+			std::unique_lock<std::recursive_mutex> lock(mMutex);
+			s_ioThreadTerminate = true;
+		}
+
+		curl_multi_wakeup(HttpReq::s_multi_handle);
+		s_ioThread->join();
+		delete s_ioThread;
+		s_ioThread = nullptr;
+	}
+} s_ioThreadGuard;
+#endif
 
 std::string HttpReq::urlEncode(const std::string &s)
 {
@@ -103,10 +174,14 @@ HttpReq::HttpReq(const std::string& url, const std::string& outputFilename)
 HttpReq::HttpReq(const std::string& url, HttpReqOptions* options)
 	: mStatus(REQ_IN_PROGRESS), mHandle(NULL), mFile(NULL)
 {
-	performRequest(url, options);
+	if (options != nullptr)
+		mOnCompleted = options->onCompleted;
+
+	if (!performRequest(url, options) && mOnCompleted)
+		mOnCompleted(this);
 }
 
-void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
+bool HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 {
 	mUrl = url;
 
@@ -124,7 +199,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError("curl_easy_init failed");
-		return;
+		return false;
 	}
 
 	//set the url
@@ -133,7 +208,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	if (options != nullptr && !options->dataToPost.empty())
@@ -168,19 +243,27 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	// Ignore expired SSL certificates
 	curl_easy_setopt(mHandle, CURLOPT_SSL_VERIFYPEER, 0L);
 
+	// Share DNS & TLS sessions, keep connections alive and wait for a multiplexed connection rather than opening a new one
+	curl_easy_setopt(mHandle, CURLOPT_SHARE, s_share_handle);
+	curl_easy_setopt(mHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	curl_easy_setopt(mHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(mHandle, CURLOPT_PIPEWAIT, 1L);
+#endif
+
 	//set curl to handle redirects
 	err = curl_easy_setopt(mHandle, CURLOPT_CONNECTTIMEOUT, 10L);
 	if (err != CURLE_OK)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 		
 	//set curl max redirects
@@ -189,7 +272,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	//set curl restrict redirect protocols
@@ -198,7 +281,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	//tell curl how to write the data
@@ -207,7 +290,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	//give curl a pointer to this HttpReq so we know where to write the data *to* in our write function
@@ -216,7 +299,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	// Set fake user agent
@@ -225,7 +308,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	{
 		mStatus = REQ_IO_ERROR;
 		onError(curl_easy_strerror(err));
-		return;
+		return false;
 	}
 
 	curl_easy_setopt(mHandle, CURLOPT_HEADERFUNCTION, &HttpReq::header_callback);
@@ -260,7 +343,7 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	}
 #endif
 	
-	std::unique_lock<std::mutex> lock(mMutex);
+	std::unique_lock<std::recursive_mutex> lock(mMutex);
 
 	if (!mFilePath.empty())
 	{
@@ -278,25 +361,23 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 		{
 			mStatus = REQ_IO_ERROR;
 			onError("IO Error (disk is Readonly ?)");			
-			return;
+			return false;
 		}
 
 		mPosition = 0;
 		Utils::FileSystem::removeFile(outputFilename);
 	}
 
-	//add the handle to our multi
-	CURLMcode merr = curl_multi_add_handle(s_multi_handle, mHandle);
-	if(merr != CURLM_OK)
-	{
-		closeStream();
+	// the handle is added to our multi by the thread driving the transfers
+	s_requests[mHandle] = this;
+	s_pendingAdd.push_back(mHandle);
 
-		mStatus = REQ_IO_ERROR;
-		onError(curl_multi_strerror(merr));
-		return;
-	}
+#ifdef HTTPREQ_IO_THREAD
+	startIOThread();
+	curl_multi_wakeup(s_multi_handle);
+#endif
 
-	s_requests[mHandle] = this;
+	return true;
 }
 
 void HttpReq::closeStream()
@@ -311,158 +392,284 @@ void HttpReq::closeStream()
 
 HttpReq::~HttpReq()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
+	std::unique_lock<std::recursive_mutex> lock(mMutex);
+
+	if (mHandle)
+	{
+		auto it = s_requests.find(mHandle);
+		if (it != s_requests.cend())
+		{
+			s_requests.erase(it);
+
+			auto pending = std::find(s_pendingAdd.begin(), s_pendingAdd.end(), mHandle);
+			if (pending != s_pendingAdd.end())
+				s_pendingAdd.erase(pending);
+#ifdef HTTPREQ_IO_THREAD
+			else if (std::this_thread::get_id() != s_ioThreadId)
+			{
+				// The multi handle can only be used by the I/O thread : let it remove the transfer & wait
+				s_pendingRemove.push_back(mHandle);
+				curl_multi_wakeup(s_multi_handle);
+
+				mEvent.wait(lock, [this] { return std::find(s_pendingRemove.cbegin(), s_pendingRemove.cend(), mHandle) == s_pendingRemove.cend(); });
+			}
+#endif
+			else
+			{
+				CURLMcode merr = curl_multi_remove_handle(s_multi_handle, mHandle);
+				if (merr != CURLM_OK)
+					LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
+			}
+		}
+	}
 
 	closeStream();
 	
 	if (!mTempStreamPath.empty())
 		Utils::FileSystem::removeFile(mTempStreamPath);
 
-	if(mHandle)
+	if (mHandle)
+		curl_easy_cleanup(mHandle);
+}
+
+#ifdef HTTPREQ_IO_THREAD
+void HttpReq::startIOThread()
+{
+	if (s_ioThread != nullptr)
+		return;
+
+	s_ioThread = new std::thread(&HttpReq::ioThread);
+	s_ioThreadId = s_ioThread->get_id();
+}
+
+void HttpReq::ioThread()
+{
+	while (true)
 	{
-		s_requests.erase(mHandle);
+		bool active;
 
-		CURLMcode merr = curl_multi_remove_handle(s_multi_handle, mHandle);
+		{
+			std::unique_lock<std::recursive_mutex> lock(mMutex);
+			if (s_ioThreadTerminate)
+				break;
 
-		if(merr != CURLM_OK)
-			LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
+			processMulti();
+			active = !s_requests.empty();
+		}
 
-		curl_easy_cleanup(mHandle);
+		// Sleep until there's socket activity, or a request is added/cancelled (curl_multi_wakeup)
+		curl_multi_poll(s_multi_handle, nullptr, 0, active ? 100 : 1000, nullptr);
 	}
 }
+#endif
 
-HttpReq::Status HttpReq::status()
+// Must be called with mMutex held, from the thread driving the transfers
+void HttpReq::processMulti()
 {
-	if (mStatus == REQ_IN_PROGRESS)
+	std::vector<CURL*> toAdd;
+	toAdd.swap(s_pendingAdd);
+
+	bool addFailed = false;
+
+	for (auto handle : toAdd)
 	{
-		std::unique_lock<std::mutex> lock(mMutex);
+		CURLMcode merr = curl_multi_add_handle(s_multi_handle, handle);
+		if (merr == CURLM_OK)
+			continue;
 
-		int handle_count;
-		CURLMcode merr = curl_multi_perform(s_multi_handle, &handle_count);
-		if (merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
-		{
-			closeStream();
+		auto it = s_requests.find(handle);
+		if (it == s_requests.cend())
+			continue;
 
-			mStatus = REQ_IO_ERROR;
-			onError(curl_multi_strerror(merr));
-			return mStatus;
+		HttpReq* req = it->second;
+		s_requests.erase(it);
+
+		req->closeStream();
+		req->mErrorMsg = curl_multi_strerror(merr);
+		req->mStatus = REQ_IO_ERROR;
+		LOG(LogError) << "HttpReq::onError (" << REQ_IO_ERROR << ") : " << req->mErrorMsg;
+
+		if (req->mOnCompleted)
+			req->mOnCompleted(req);
+
+		addFailed = true;
+	}
+
+	// Wake up the threads waiting for these requests
+	if (addFailed)
+		mEvent.notify_all();
+
+	if (!s_pendingRemove.empty())
+	{
+		for (auto handle : s_pendingRemove)
+		{
+			CURLMcode merr = curl_multi_remove_handle(s_multi_handle, handle);
+			if (merr != CURLM_OK)
+				LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
 		}
 
-		int msgs_left;
-		CURLMsg* msg;
-		while ((msg = curl_multi_info_read(s_multi_handle, &msgs_left)) != nullptr)
+		s_pendingRemove.clear();
+		mEvent.notify_all();
+	}
+
+	int handle_count;
+	CURLMcode merr = curl_multi_perform(s_multi_handle, &handle_count);
+	if (merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
+	{
+		LOG(LogError) << "HttpReq curl_multi_perform error : " << curl_multi_strerror(merr);
+		return;
+	}
+
+	bool completed = false;
+
+	int msgs_left;
+	CURLMsg* msg;
+	while ((msg = curl_multi_info_read(s_multi_handle, &msgs_left)) != nullptr)
+	{
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+
+		CURL* handle = msg->easy_handle;
+		CURLcode result = msg->data.result;
+
+		curl_multi_remove_handle(s_multi_handle, handle);
+
+		auto it = s_requests.find(handle);
+		if (it == s_requests.cend())
 		{
-			if (msg->msg == CURLMSG_DONE)
-			{
-				HttpReq* req = s_requests[msg->easy_handle];
-				if (req == NULL)
-				{
-					LOG(LogError) << "Cannot find easy handle!";
-					continue;
-				}
+			LOG(LogError) << "Cannot find easy handle!";
+			continue;
+		}
 
-				req->closeStream();
+		HttpReq* req = it->second;
+		s_requests.erase(it);
 
-				if (req->mStatus == REQ_FILESTREAM_ERROR)
-				{
-					std::string err = "File stream error (disk full ?)";
-					req->onError(err.c_str());
-				}
-				else if (msg->data.result == CURLE_OK)
-				{
-					int http_status_code;
-					curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_status_code);					
+		req->onDone(result);
+		completed = true;
+	}
+
+	if (completed)
+		mEvent.notify_all();
+}
+
+void HttpReq::onDone(CURLcode result)
+{
+	closeStream();
+
+	Status status = REQ_SUCCESS;
+	std::string err;
+
+	if (mStatus == REQ_FILESTREAM_ERROR)
+	{
+		status = REQ_FILESTREAM_ERROR;
+		err = "File stream error (disk full ?)";
+	}
+	else if (result == CURLE_OK)
+	{
+		int http_status_code;
+		curl_easy_getinfo(mHandle, CURLINFO_RESPONSE_CODE, &http_status_code);
 
-					if (http_status_code < 200 || http_status_code > 299)
+		if (http_status_code == 304)
+			status = REQ_304_NOTMODIFIED;
+		else if (http_status_code < 200 || http_status_code > 299)
+		{
+			if (http_status_code >= 400 && http_status_code <= 503)
+			{
+				if (mFilePath.empty())
+				{
+					auto content = getContent();
+					if (!content.empty() && content.find("<body") != std::string::npos)
 					{
-						std::string err;
-
-						if (http_status_code >= 400 && http_status_code <= 503)
-						{
-							if (req->mFilePath.empty())
-							{
-								auto content = req->getContent();
-								if (!content.empty() && content.find("<body") != std::string::npos)
-								{
-									// Parse response HTML & extract body
-									auto body = Utils::String::extractString(content, "<body", "</body>", true);
-									body = Utils::String::replace(body, "\r", "");
-									body = Utils::String::replace(body, "\n", "");
-									body = Utils::String::replace(body, "</p>", "\r\n");
-									body = Utils::String::replace(body, "<br>", "\r\n");
-									body = Utils::String::replace(body, "<hr>", "\r\n");
-									body = Utils::String::removeHtmlTags(body);
-
-									if (!body.empty())
-										err = "HTTP status " + std::to_string(http_status_code) + "\r\n" + body;
-								}
-								else
-									err = content;
-							}
-
-							if (http_status_code > 500)
-								req->mStatus = REQ_IO_ERROR;
-							else
-								req->mStatus = (Status)http_status_code;
-						}						
-						else
-							req->mStatus = REQ_IO_ERROR;
-
-						if (err.empty())
-							err = "HTTP status " + std::to_string(http_status_code);
-
-						req->onError(err.c_str());
+						// Parse response HTML & extract body
+						auto body = Utils::String::extractString(content, "<body", "</body>", true);
+						body = Utils::String::replace(body, "\r", "");
+						body = Utils::String::replace(body, "\n", "");
+						body = Utils::String::replace(body, "</p>", "\r\n");
+						body = Utils::String::replace(body, "<br>", "\r\n");
+						body = Utils::String::replace(body, "<hr>", "\r\n");
+						body = Utils::String::removeHtmlTags(body);
+
+						if (!body.empty())
+							err = "HTTP status " + std::to_string(http_status_code) + "\r\n" + body;
 					}
 					else
-					{
-						if (!req->mFilePath.empty())
-						{
-							bool renamed = Utils::FileSystem::renameFile(req->mTempStreamPath.c_str(), req->mFilePath.c_str());
-#if WIN32
-							if (renamed)
-							{
-								auto wfn = Utils::String::convertToWideString(req->mFilePath);
-								HANDLE hFile = CreateFileW(wfn.c_str(), GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-								if (hFile != INVALID_HANDLE_VALUE)
-								{
-									SYSTEMTIME st;
-									GetSystemTime(&st);              // Gets the current system time
-									FILETIME ft;
-									SystemTimeToFileTime(&st, &ft);  // Converts the current system time to file time format
-
-									SetFileTime(hFile, &ft, &ft, &ft);
-									CloseHandle(hFile);
-								}
-							}
-#endif
-							if (!renamed)
-							{
-								// Strange behaviour on Windows : sometimes std::rename fails if it's done too early after closing stream
-								// Copy file instead & try to delete it
-								if (Utils::FileSystem::copyFile(req->mTempStreamPath, req->mFilePath))
-									renamed = true;
-							}
-
-							if (renamed)
-								req->mStatus = REQ_SUCCESS;
-							else
-							{
-								req->mStatus = REQ_IO_ERROR;
-								req->onError("file rename failed");
-							}
-						}
-						else
-							req->mStatus = REQ_SUCCESS;
-					}
+						err = content;
 				}
+
+				if (http_status_code > 500)
+					status = REQ_IO_ERROR;
 				else
+					status = (Status)http_status_code;
+			}
+			else
+				status = REQ_IO_ERROR;
+
+			if (err.empty())
+				err = "HTTP status " + std::to_string(http_status_code);
+		}
+		else if (!mFilePath.empty())
+		{
+			bool renamed = Utils::FileSystem::renameFile(mTempStreamPath.c_str(), mFilePath.c_str());
+#if WIN32
+			if (renamed)
+			{
+				auto wfn = Utils::String::convertToWideString(mFilePath);
+				HANDLE hFile = CreateFileW(wfn.c_str(), GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+				if (hFile != INVALID_HANDLE_VALUE)
 				{
-					req->mStatus = REQ_IO_ERROR;
-					req->onError(curl_easy_strerror(msg->data.result));
+					SYSTEMTIME st;
+					GetSystemTime(&st);              // Gets the current system time
+					FILETIME ft;
+					SystemTimeToFileTime(&st, &ft);  // Converts the current system time to file time format
+
+					SetFileTime(hFile, &ft, &ft, &ft);
+					CloseHandle(hFile);
 				}
 			}
+#endif
+			if (!renamed)
+			{
+				// Strange behaviour on Windows : sometimes std::rename fails if it's done too early after closing stream
+				// Copy file instead & try to delete it
+				if (Utils::FileSystem::copyFile(mTempStreamPath, mFilePath))
+					renamed = true;
+			}
+
+			if (!renamed)
+			{
+				status = REQ_IO_ERROR;
+				err = "file rename failed";
+			}
 		}
 	}
+	else
+	{
+		status = REQ_IO_ERROR;
+		err = curl_easy_strerror(result);
+	}
+
+	// Error message must be set before the status : other threads only poll the status
+	if (status != REQ_SUCCESS && status != REQ_304_NOTMODIFIED)
+	{
+		mErrorMsg = err;
+		LOG(LogError) << "HttpReq::onError (" << status << ") : " << mErrorMsg;
+	}
+
+	mStatus = status;
+
+	if (mOnCompleted)
+		mOnCompleted(this);
+}
+
+HttpReq::Status HttpReq::status()
+{
+#ifndef HTTPREQ_IO_THREAD
+	if (mStatus == REQ_IN_PROGRESS)
+	{
+		std::unique_lock<std::recursive_mutex> lock(mMutex);
+		processMulti();
+	}
+#endif
 
 	return mStatus;
 }
@@ -513,6 +720,11 @@ std::string HttpReq::getResponseHeader(const std::string& header)
 	auto it = mResponseHeaders.find(header);
 	if (it != mResponseHeaders.cend())
 		return it->second;
+
+	// Header names are case insensitive, and always lower case with HTTP/2
+	for (auto hdr : mResponseHeaders)
+		if (Utils::String::compareIgnoreCase(hdr.first, header) == 0)
+			return hdr.second;
 		
 	return "";
 }
@@ -578,8 +790,13 @@ size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_p
 
 bool HttpReq::wait()
 {
+#ifdef HTTPREQ_IO_THREAD
+	std::unique_lock<std::recursive_mutex> lock(mMutex);
+	mEvent.wait(lock, [this] { return mStatus != REQ_IN_PROGRESS; });
+#else
 	while (status() == HttpReq::REQ_IN_PROGRESS)
 		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+#endif
 
 	return status() == HttpReq::REQ_SUCCESS;
 }
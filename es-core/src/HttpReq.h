@@ -8,8 +8,15 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <functional>
 #include <stdio.h>
 
+// curl_multi_poll & curl_multi_wakeup are required to drive transfers from a dedicated thread
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HTTPREQ_IO_THREAD
+#endif
+
 /* Usage:
  * HttpReq myRequest("www.google.com", "/index.html");
  * //for blocking behavior: while(myRequest.status() == HttpReq::REQ_IN_PROGRESS);
@@ -25,8 +32,13 @@
  *
  * std::string content = myRequest.getContent();
  * //process contents...
+ *
+ * Transfers are driven by a shared I/O thread : status() is non blocking and only returns the current state.
+ * HttpReqOptions::onCompleted is called from the I/O thread once the request is finished, it must not delete the request.
 */
 
+class HttpReq;
+
 class HttpReqOptions
 {
 public:
@@ -39,6 +51,8 @@ public:
 	std::string outputFilename;
 	std::vector<std::string> customHeaders;
 	std::string dataToPost;
+
+	std::function<void(HttpReq*)> onCompleted;
 };
 
 class HttpReq
@@ -56,6 +70,7 @@ public:
 		REQ_FILESTREAM_ERROR = 4,		
 
 		REQ_SUCCESS = 200,
+		REQ_304_NOTMODIFIED = 304,
 		REQ_400_BADREQUEST = 400,
 		REQ_401_FORBIDDEN = 401,
 		REQ_403_BADLOGIN = 403,
@@ -92,8 +107,15 @@ public:
 	bool wait();
 
 private:
-	void performRequest(const std::string& url, HttpReqOptions* options);
+	bool performRequest(const std::string& url, HttpReqOptions* options);
 	void closeStream();
+	void onDone(CURLcode result);
+
+	static void processMulti();
+	static void ioThread();
+	static void startIOThread();
+
+	friend struct HttpReqIOThreadGuard;
 
 	static size_t write_content(void* buff, size_t size, size_t nmemb, void* req_ptr);
 	static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
@@ -105,12 +127,17 @@ private:
 	static std::map<CURL*, HttpReq*> s_requests;
 
 	static CURLM* s_multi_handle;
+	static CURLSH* s_share_handle;
+
+	static std::vector<CURL*> s_pendingAdd;
+	static std::vector<CURL*> s_pendingRemove;
 
 	void onError(const char* msg);
 
 	CURL* mHandle;
 
-	Status mStatus;
+	std::atomic<Status> mStatus;
+	std::function<void(HttpReq*)> mOnCompleted;
 
 	// string steam mode
 	std::stringstream mContent;
@@ -9,6 +9,8 @@
 #include <fstream>
 #include <map>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 #include "renderers/Renderer.h"
 #include "Paths.h"
 
@@ -234,189 +236,370 @@ Vector2f ImageIO::getPictureMinSize(Vector2f imageSize, Vector2f maxSize)
 	return Vector2f(cxDIB, cyDIB);
 }
 
-struct CachedFileInfo
+// Image size index : imagecache.idx, "ESII" <version>, then fixed size records appended as images are measured.
+// Paths are stored as a 64 bits hash, and the file size & modification date of the image validate each record.
+// The in-memory index is split in shards with their own lock, so the texture loader threads don't wait for each other.
+#define IMAGE_INDEX_MAGIC			"ESII"
+#define IMAGE_INDEX_VERSION			1
+#define IMAGE_INDEX_SHARDS			16
+#define IMAGE_INDEX_COMPACT_RECORDS	4096
+
+struct ImageIndexRecord
 {
-	CachedFileInfo(int sz, int sx, int sy)
-	{
-		size = sz;
-		x = sx;
-		y = sy;		
-	};
+	unsigned long long hash;
+	long long size;
+	long long mtime;
+	int x;
+	int y;
+};
 
-	CachedFileInfo()
-	{
-		size = 0;
-		x = 0;
-		y = 0;		
-	};
+struct CachedFileInfo
+{
+	CachedFileInfo() : size(0), mtime(0), x(0), y(0), persistent(false) { }
 
-	int size;
+	long long size;		// -1 : not an image or unreadable
+	long long mtime;
 	int x;
-	int y;	
+	int y;
+	bool persistent;	// written to the index file
 };
 
-static std::map<std::string, CachedFileInfo> sizeCache;
-static bool sizeCacheDirty = false;
+struct ImageIndexShard
+{
+	std::mutex lock;
+	std::unordered_map<unsigned long long, CachedFileInfo> entries;
+	std::vector<ImageIndexRecord> pending; // not appended to the file yet
+};
 
-std::string getImageCacheFilename()
+static ImageIndexShard sIndexShards[IMAGE_INDEX_SHARDS];
+static std::once_flag sIndexLoaded;
+static std::mutex sIndexFileLock;
+static size_t sIndexFileRecords = 0;
+static std::thread* sIndexCompactThread = nullptr;
+
+static std::string getImageCacheFilename()
 {
-	return Paths::getUserEmulationStationPath() + "/imagecache.db";
+	return Paths::getUserEmulationStationPath() + "/imagecache.idx";
 }
 
-void ImageIO::clearImageCache()
+static unsigned long long _getPathHash(const std::string& path)
+{
+	// FNV-1a. Paths under the root path are hashed relative to it, so that a portable install keeps its index when moved
+	const std::string& root = Paths::getRootPath();
+	const char* src = path.c_str();
+
+	unsigned long long hash = 14695981039346656037ULL;
+
+	if (!root.empty() && path.size() > root.size() && path[root.size()] == '/' && path.compare(0, root.size(), root) == 0)
+	{
+		hash = (hash ^ '.') * 1099511628211ULL;
+		src += root.size();
+	}
+
+	for (; *src; src++)
+		hash = (hash ^ (unsigned char)*src) * 1099511628211ULL;
+
+	return hash;
+}
+
+// Served by the file system cache while the views are created
+static bool _getFileStamp(const std::string& path, long long& size, long long& mtime)
+{
+	size = (long long)Utils::FileSystem::getFileSize(path);
+	if (size <= 0)
+		return false;
+
+	mtime = (long long)Utils::FileSystem::getFileModificationDate(path).getTime();
+	return true;
+}
+
+static bool _isCachablePath(const std::string& path)
 {
+	return 
+		path.find("/themes/") == std::string::npos && 
+		path.find("/tmp/") == std::string::npos &&
+		path.find("/emulationstation.tmp/") == std::string::npos &&
+		path.find("/pdftmp/") == std::string::npos && 
+		path.find("/saves/") == std::string::npos;
+}
+
+static ImageIndexRecord _createRecord(unsigned long long hash, const CachedFileInfo& info)
+{
+	ImageIndexRecord record;
+	record.hash = hash;
+	record.size = info.size;
+	record.mtime = info.mtime;
+	record.x = info.x;
+	record.y = info.y;
+	return record;
+}
+
+// Rewrites the file with the live records only. Called with sIndexFileLock held
+static void _writeImageIndex()
+{
+	std::vector<ImageIndexRecord> records;
+
+	for (auto& shard : sIndexShards)
+	{
+		std::unique_lock<std::mutex> lock(shard.lock);
+
+		for (auto& it : shard.entries)
+			if (it.second.persistent)
+				records.push_back(_createRecord(it.first, it.second));
+
+		shard.pending.clear();
+	}
+
 	std::string fname = getImageCacheFilename();
-	Utils::FileSystem::removeFile(fname);
-	sizeCache.clear();
+
+	// Write data first & rename, so that an interrupted write never leaves a partial index
+	std::ofstream f(WINSTRINGW(fname + ".tmp"), std::ios::binary | std::ios::out);
+	if (!f.is_open())
+		return;
+
+	unsigned int version = IMAGE_INDEX_VERSION;
+
+	f.write(IMAGE_INDEX_MAGIC, 4);
+	f.write((const char*)&version, sizeof(version));
+
+	if (records.size() > 0)
+		f.write((const char*)records.data(), records.size() * sizeof(ImageIndexRecord));
+
+	f.close();
+
+	if (Utils::FileSystem::renameFile(fname + ".tmp", fname))
+		sIndexFileRecords = records.size();
+
+	LOG(LogDebug) << "ImageIO : image index compacted, " << records.size() << " images";
 }
 
-void ImageIO::loadImageCache()
+static void _loadImageIndex()
 {
+	// The text cache of the previous versions is not migrated : images are measured again as they are displayed
+	std::string legacyFile = Paths::getUserEmulationStationPath() + "/imagecache.db";
+	if (Utils::FileSystem::exists(legacyFile))
+		Utils::FileSystem::removeFile(legacyFile);
+
 	std::string fname = getImageCacheFilename();
 
-	std::ifstream f(fname.c_str());
-	if (f.fail())
+	std::ifstream f(WINSTRINGW(fname), std::ios::binary | std::ios::in);
+	if (!f.is_open())
 		return;
 
-	sizeCache.clear();
+	f.seekg(0, std::ios::end);
+	size_t length = (size_t)f.tellg();
+	f.seekg(0, std::ios::beg);
 
-	std::string relativeTo = Paths::getRootPath();
+	char magic[4];
+	unsigned int version = 0;
 
-	std::vector<std::string> splits;
+	f.read(magic, 4);
+	f.read((char*)&version, sizeof(version));
 
-	std::string line;
-	while (std::getline(f, line))
+	if (!f || memcmp(magic, IMAGE_INDEX_MAGIC, 4) != 0 || version != IMAGE_INDEX_VERSION)
 	{
-		splits.clear();
+		LOG(LogWarning) << "ImageIO : invalid image index " << fname;
+		f.close();
+		Utils::FileSystem::removeFile(fname);
+		return;
+	}
 
-		const char* src = line.c_str();
+	size_t dataLength = length - 4 - sizeof(version);
+	size_t count = dataLength / sizeof(ImageIndexRecord);
 
-		while (true)
-		{
-			const char* d = strchr(src, '|');
-			size_t len = (d) ? d - src : strlen(src);
+	std::vector<ImageIndexRecord> records(count);
+	if (count > 0)
+		f.read((char*)records.data(), count * sizeof(ImageIndexRecord));
 
-			if (len)
-				splits.push_back(std::string(src, len)); // capture token
+	f.close();
 
-			if (d) src += len + 1; else break;
-		}
+	// Callers wait for the end of the load (call_once), the shards don't need to be locked here.
+	// Records are in the order they were measured : the last one of a path wins.
+	for (auto& record : records)
+	{
+		CachedFileInfo& info = sIndexShards[record.hash % IMAGE_INDEX_SHARDS].entries[record.hash];
+		info.size = record.size;
+		info.mtime = record.mtime;
+		info.x = record.x;
+		info.y = record.y;
+		info.persistent = true;
+	}
 
-		if (splits.size() == 4)
-		{
-			std::string file = Utils::FileSystem::resolveRelativePath(splits[0], relativeTo, true);
+	size_t liveRecords = 0;
+	for (auto& shard : sIndexShards)
+		liveRecords += shard.entries.size();
 
-			CachedFileInfo fi;
-			fi.size = Utils::String::toInteger(splits[1]);
-			fi.x = Utils::String::toInteger(splits[2]);
-			fi.y = Utils::String::toInteger(splits[3]);
+	sIndexFileRecords = count;
 
-			sizeCache[file] = fi;
-		}
+	LOG(LogDebug) << "ImageIO : image index loaded, " << liveRecords << " images";
+
+	// A partial record means an append was interrupted : the next appends would be misaligned
+	bool partialRecord = (dataLength % sizeof(ImageIndexRecord)) != 0;
+
+	if (partialRecord || (count > IMAGE_INDEX_COMPACT_RECORDS && count > liveRecords * 2))
+	{
+		sIndexCompactThread = new std::thread([]
+		{
+			std::unique_lock<std::mutex> lock(sIndexFileLock);
+			_writeImageIndex();
+		});
 	}
+}
 
-	f.close();
+static void _waitImageIndexCompaction()
+{
+	if (sIndexCompactThread == nullptr)
+		return;
+
+	sIndexCompactThread->join();
+	delete sIndexCompactThread;
+	sIndexCompactThread = nullptr;
 }
 
-static bool _isCachablePath(const std::string& path)
+void ImageIO::loadImageCache()
 {
-	return 
-		path.find("/themes/") == std::string::npos && 
-		path.find("/tmp/") == std::string::npos &&
-		path.find("/emulationstation.tmp/") == std::string::npos &&
-		path.find("/pdftmp/") == std::string::npos && 
-		path.find("/saves/") == std::string::npos;
+	std::call_once(sIndexLoaded, _loadImageIndex);
+}
+
+void ImageIO::clearImageCache()
+{
+	loadImageCache();
+	_waitImageIndexCompaction();
+
+	std::unique_lock<std::mutex> fileLock(sIndexFileLock);
+
+	for (auto& shard : sIndexShards)
+	{
+		std::unique_lock<std::mutex> lock(shard.lock);
+		shard.entries.clear();
+		shard.pending.clear();
+	}
+
+	Utils::FileSystem::removeFile(getImageCacheFilename());
+	sIndexFileRecords = 0;
 }
 
 void ImageIO::saveImageCache()
 {
-	if (!sizeCacheDirty)
-		return;
+	loadImageCache();
+	_waitImageIndexCompaction();
 
-	std::string fname = getImageCacheFilename();
-	std::ofstream f(fname.c_str(), std::ios::binary);
-	if (f.fail())
+	std::unique_lock<std::mutex> fileLock(sIndexFileLock);
+
+	std::vector<ImageIndexRecord> records;
+	size_t liveRecords = 0;
+
+	for (auto& shard : sIndexShards)
+	{
+		std::unique_lock<std::mutex> lock(shard.lock);
+		records.insert(records.end(), shard.pending.cbegin(), shard.pending.cend());
+		shard.pending.clear();
+		liveRecords += shard.entries.size();
+	}
+
+	if (records.size() == 0)
 		return;
 
-	std::string relativeTo = Paths::getRootPath();
+	std::string fname = getImageCacheFilename();
 
-	for (auto it : sizeCache)
+	size_t totalRecords = sIndexFileRecords + records.size();
+	if (!Utils::FileSystem::exists(fname) || (totalRecords > IMAGE_INDEX_COMPACT_RECORDS && totalRecords > liveRecords * 2))
 	{
-		if (it.second.size < 0)
-			continue;
-
-		if (!_isCachablePath(it.first))
-			continue;
-
-		std::string path = Utils::FileSystem::createRelativePath(it.first, relativeTo, true); 
-
-		f << path;
-		f << "|";
-		f << std::to_string(it.second.size);
-		f << "|";
-		f << std::to_string(it.second.x);
-		f << "|";
-		f << std::to_string(it.second.y);
-		f << "\n";
+		_writeImageIndex();
+		return;
 	}
 
+	std::ofstream f(WINSTRINGW(fname), std::ios::binary | std::ios::out | std::ios::app);
+	if (!f.is_open())
+		return;
+
+	f.write((const char*)records.data(), records.size() * sizeof(ImageIndexRecord));
 	f.close();
-}
 
-static std::mutex sizeCacheLock;
+	sIndexFileRecords = totalRecords;
+}
 
 void ImageIO::removeImageCache(const std::string& fn)
 {
-	std::unique_lock<std::mutex> lock(sizeCacheLock);
+	loadImageCache();
+
+	// The record may stay in the file : it won't match the size or date of the new image
+	unsigned long long hash = _getPathHash(fn);
+	auto& shard = sIndexShards[hash % IMAGE_INDEX_SHARDS];
 
-	auto it = sizeCache.find(fn);
-	if (it != sizeCache.cend())
-		sizeCache.erase(fn);
+	std::unique_lock<std::mutex> lock(shard.lock);
+	shard.entries.erase(hash);
 }
 
 void ImageIO::updateImageCache(const std::string& fn, int sz, int x, int y)
 {
-	std::unique_lock<std::mutex> lock(sizeCacheLock);
+	loadImageCache();
 
-	auto it = sizeCache.find(fn);
-	if (it != sizeCache.cend())
-	{
-		if (x != it->second.x || y != it->second.y || sz != it->second.size)
-		{
-			auto& item = it->second;
+	CachedFileInfo info;
+	info.size = sz;
+	info.x = x;
+	info.y = y;
 
-			item.x = x;
-			item.y = y;
-			item.size = sz;
+	// Only the images measured successfully & outside of the temporary folders are written to the index
+	if (sz > 0 && x > 0 && _isCachablePath(fn) && _getFileStamp(fn, info.size, info.mtime))
+		info.persistent = true;
 
-			if (sz > 0 && x > 0 && _isCachablePath(fn))
-				sizeCacheDirty = true;
-		}
-	}
-	else
-	{
-		sizeCache[fn] = CachedFileInfo(sz, x, y);
+	unsigned long long hash = _getPathHash(fn);
+	auto& shard = sIndexShards[hash % IMAGE_INDEX_SHARDS];
 
-		if (sz > 0 && x > 0 && _isCachablePath(fn))
-			sizeCacheDirty = true;
+	std::unique_lock<std::mutex> lock(shard.lock);
+
+	auto it = shard.entries.find(hash);
+	if (it != shard.entries.cend())
+	{
+		auto& item = it->second;
+		if (item.x == info.x && item.y == info.y && item.size == info.size && item.mtime == info.mtime && item.persistent == info.persistent)
+			return;
 	}
+
+	shard.entries[hash] = info;
+
+	if (info.persistent)
+		shard.pending.push_back(_createRecord(hash, info));
 }
 
 
 bool ImageIO::loadImageSize(const std::string& fn, unsigned int *x, unsigned int *y)
 {
+	loadImageCache();
+
 	{
-		std::unique_lock<std::mutex> lock(sizeCacheLock);
+		unsigned long long hash = _getPathHash(fn);
+		auto& shard = sIndexShards[hash % IMAGE_INDEX_SHARDS];
+
+		CachedFileInfo info;
+		bool found = false;
 
-		auto it = sizeCache.find(fn);
-		if (it != sizeCache.cend())
 		{
-			if (it->second.size < 0)
+			std::unique_lock<std::mutex> lock(shard.lock);
+
+			auto it = shard.entries.find(hash);
+			if (it != shard.entries.cend())
+			{
+				info = it->second;
+				found = true;
+			}
+		}
+
+		if (found)
+		{
+			if (info.size < 0)
 				return false;
 
-			*x = it->second.x;
-			*y = it->second.y;
-			return true;
+			long long size, mtime;
+			if (!info.persistent || (_getFileStamp(fn, size, mtime) && size == info.size && mtime == info.mtime))
+			{
+				*x = info.x;
+				*y = info.y;
+				return true;
+			}
+
+			// The image was replaced since it was measured
 		}
 	}
 
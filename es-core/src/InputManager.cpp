@@ -199,6 +199,24 @@ InputConfig* InputManager::getInputConfigByDevice(int device)
 	return mInputConfigs[device];
 }
 
+InputConfig* InputManager::getInputConfigByGUID(int deviceId, const std::string& deviceGUID)
+{
+	if (deviceId < 0)
+		return getInputConfigByDevice(deviceId);
+
+	std::unique_lock<std::mutex> lock(mJoysticksLock);
+
+	auto it = mInputConfigs.find(deviceId);
+	if (it != mInputConfigs.cend() && it->second != nullptr && it->second->getDeviceGUIDString() == deviceGUID)
+		return it->second;
+
+	for (auto config : mInputConfigs)
+		if (config.second != nullptr && config.second->getDeviceGUIDString() == deviceGUID)
+			return config.second;
+
+	return nullptr;
+}
+
 void InputManager::clearJoysticks()
 {
 	mJoysticksLock.lock();
@@ -69,6 +69,9 @@ public:
 
 	void sendMouseClick(Window* window, int button);
 
+	// Finds the config of a device known from a previous run : joystick ids change, their GUID does not
+	InputConfig* getInputConfigByGUID(int deviceId, const std::string& deviceGUID);
+
 private:
 	InputManager();
 
@@ -0,0 +1,179 @@
+#include "InputRecorder.h"
+#include "InputManager.h"
+#include "Log.h"
+#include "Window.h"
+#include "utils/Randomizer.h"
+#include "utils/StringUtil.h"
+
+#include <sstream>
+
+#define JOURNAL_MAGIC		"ESINPUT"
+#define JOURNAL_VERSION		1
+#define JOURNAL_TIME_STEP	16		// ms
+#define REPLAY_SETTLE_TIME	1000	// ms
+
+bool InputRecorder::sRecording = false;
+bool InputRecorder::sReplaying = false;
+bool InputRecorder::sDispatching = false;
+
+std::string InputRecorder::sPath;
+std::ofstream InputRecorder::sStream;
+
+unsigned int InputRecorder::sTime = 0;
+int InputRecorder::sTimeStep = JOURNAL_TIME_STEP;
+
+std::vector<InputRecorder::Event> InputRecorder::sEvents;
+size_t InputRecorder::sNextEvent = 0;
+size_t InputRecorder::sMisplacedEvents = 0;
+
+bool InputRecorder::startRecording(const std::string& path)
+{
+	stop();
+
+#if defined(_WIN32)
+	sStream.open(Utils::String::convertToWideString(path));
+#else
+	sStream.open(path);
+#endif
+	if (!sStream.is_open())
+	{
+		LOG(LogError) << "InputRecorder : unable to create " << path;
+		return false;
+	}
+
+	sPath = path;
+	sTime = 0;
+	sRecording = true;
+
+	sStream << JOURNAL_MAGIC << " " << JOURNAL_VERSION << " " << Randomizer::getSeed() << " " << sTimeStep << "\n";
+
+	LOG(LogInfo) << "InputRecorder : recording inputs to " << path;
+	return true;
+}
+
+bool InputRecorder::startReplay(const std::string& path)
+{
+	stop();
+
+#if defined(_WIN32)
+	std::ifstream stream(Utils::String::convertToWideString(path));
+#else
+	std::ifstream stream(path);
+#endif
+	if (!stream.is_open())
+	{
+		LOG(LogError) << "InputRecorder : unable to open " << path;
+		return false;
+	}
+
+	std::string magic;
+	int version = 0;
+	unsigned int seed = 0;
+	int timeStep = 0;
+
+	if (!(stream >> magic >> version >> seed >> timeStep) || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION || timeStep <= 0)
+	{
+		LOG(LogError) << "InputRecorder : " << path << " is not a valid input journal";
+		return false;
+	}
+
+	sEvents.clear();
+
+	Event event;
+	int type = 0;
+
+	while (stream >> event.time >> event.device >> event.guid >> type >> event.input.id >> event.input.value)
+	{
+		event.input.device = event.device;
+		event.input.type = (InputType)type;
+		event.input.configured = false;
+		sEvents.push_back(event);
+	}
+
+	// Same random choices as during the recording
+	Randomizer::setSeed(seed);
+
+	sPath = path;
+	sTime = 0;
+	sTimeStep = timeStep;
+	sNextEvent = 0;
+	sMisplacedEvents = 0;
+	sReplaying = true;
+
+	LOG(LogInfo) << "InputRecorder : replaying " << sEvents.size() << " inputs from " << path;
+	return true;
+}
+
+void InputRecorder::stop()
+{
+	if (sReplaying)
+	{
+		if (sMisplacedEvents > 0)
+			LOG(LogWarning) << "InputRecorder : " << sMisplacedEvents << " inputs were not replayed on the frame they were recorded on";
+		else if (sNextEvent == sEvents.size())
+			LOG(LogInfo) << "InputRecorder : every input was replayed on the frame it was recorded on";
+	}
+
+	if (sStream.is_open())
+		sStream.close();
+
+	sRecording = false;
+	sReplaying = false;
+	sEvents.clear();
+	sNextEvent = 0;
+}
+
+bool InputRecorder::isReplayFinished()
+{
+	if (!sReplaying || sNextEvent < sEvents.size())
+		return false;
+
+	unsigned int lastTime = sEvents.empty() ? 0 : sEvents.back().time;
+	return sTime >= lastTime + REPLAY_SETTLE_TIME;
+}
+
+void InputRecorder::update(Window* window, int deltaTime)
+{
+	// Inputs are recorded with the time of the frame before its update : they are replayed against the same time
+	if (sReplaying)
+		dispatchEvents(window);
+
+	sTime += deltaTime;
+}
+
+void InputRecorder::dispatchEvents(Window* window)
+{
+	sDispatching = true;
+
+	while (sNextEvent < sEvents.size() && sEvents[sNextEvent].time <= sTime)
+	{
+		Event& event = sEvents[sNextEvent++];
+
+		// Round trip check : with the same time step, every input comes back on the frame it was recorded on
+		if (event.time != sTime)
+			sMisplacedEvents++;
+
+		InputConfig* config = InputManager::getInstance()->getInputConfigByGUID(event.device, event.guid);
+		if (config == nullptr)
+		{
+			LOG(LogWarning) << "InputRecorder : no device with GUID " << event.guid << ", input skipped";
+			continue;
+		}
+
+		window->input(config, event.input);
+	}
+
+	sDispatching = false;
+}
+
+void InputRecorder::record(InputConfig* config, const Input& input)
+{
+	if (!sRecording || sDispatching || config == nullptr)
+		return;
+
+	std::string guid = config->getDeviceGUIDString();
+	if (guid.empty())
+		guid = "-";
+
+	sStream << sTime << " " << config->getDeviceId() << " " << guid << " " << (int)input.type << " " << input.id << " " << input.value << "\n";
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef ES_CORE_INPUT_RECORDER_H
+#define ES_CORE_INPUT_RECORDER_H
+
+#include "InputConfig.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class Window;
+
+// Journals the inputs received by the window, with the time of the virtual clock driving Window::update and the
+// random seed, so a navigation session can be replayed identically (to compare frame times between two builds).
+// The clock advances by the fixed time step while recording and replaying, so an input is replayed on the frame it was recorded on.
+// Journal format is text : a "ESINPUT <version> <seed> <time step>" header, then one "<time> <device> <guid> <type> <id> <value>" line per input.
+class InputRecorder
+{
+public:
+	static bool startRecording(const std::string& path);
+	static bool startReplay(const std::string& path);
+	static void stop();
+
+	static bool isRecording() { return sRecording; }
+	static bool isReplaying() { return sReplaying; }
+
+	// Replay is finished once every input is sent, and the UI had one second to settle
+	static bool isReplayFinished();
+
+	// Fixed time step used while recording and replaying, in ms
+	static int  getTimeStep() { return sTimeStep; }
+
+	// Advances the virtual clock, and sends the inputs that are due when replaying
+	static void update(Window* window, int deltaTime);
+
+	static void record(InputConfig* config, const Input& input);
+
+	static const std::string& getPath() { return sPath; }
+
+private:
+	struct Event
+	{
+		unsigned int time;
+		int device;
+		std::string guid;
+		Input input;
+	};
+
+	static bool sRecording;
+	static bool sReplaying;
+	static bool sDispatching;
+
+	static std::string sPath;
+	static std::ofstream sStream;
+
+	static unsigned int sTime;
+	static int sTimeStep;
+
+	static void dispatchEvents(Window* window);
+
+	static std::vector<Event> sEvents;
+	static size_t sNextEvent;
+	static size_t sMisplacedEvents;
+};
+
+#endif // ES_CORE_INPUT_RECORDER_H
@@ -89,6 +89,9 @@ std::vector<const char*> settings_dont_save {
 	{ "ScreenOffsetY" },
 	{ "ScreenRotate" },
 	{ "MonitorID" },
+	{ "Headless" },
+	{ "HeadlessFrameDump" },
+	{ "BenchmarkFrames" },
 };
 
 Settings::Settings() : mLoaded(false)
@@ -118,6 +121,9 @@ void Settings::setDefaults()
 	mBoolMap["ShowParentFolder"] = true;
 	mBoolMap["IgnoreLeadingArticles"] = Settings::_IgnoreLeadingArticles;
 	mBoolMap["DrawFramerate"] = false;
+	mBoolMap["Headless"] = false;
+	mStringMap["HeadlessFrameDump"] = "";
+	mIntMap["BenchmarkFrames"] = 0;
 	mBoolMap["ScrollLoadMedias"] = false;	
 	mBoolMap["ShowExit"] = true;
 	mBoolMap["ExitOnRebootRequired"] = false;
@@ -187,6 +193,9 @@ void Settings::setDefaults()
 	mIntMap["ScreenSaverTime"] = Settings::_ScreenSaverTime;
 	mIntMap["ScraperResizeWidth"] = 640;
 	mIntMap["ScraperResizeHeight"] = 0;
+	mIntMap["ScraperCacheDays"] = 30;
+	mIntMap["ScraperCacheMaxSize"] = 100;
+	mStringMap["CheevosServer"] = "https://retroachievements.org";
 
 #if defined(_WIN32) || defined(TINKERBOARD) || defined(X86) || defined(X86_64) || defined(ODROIDN2) || defined(ODROIDC2) || defined(ODROIDXU4) || defined(RPI4)
 	// Boards > 1Gb RAM
@@ -301,6 +310,7 @@ void Settings::setDefaults()
 	mBoolMap["PreloadMedias"] = Settings::_PreloadMedias;
 	mBoolMap["OptimizeVRAM"] = true;
 	mBoolMap["OptimizeVideo"] = true;
+	mBoolMap["VideoHalfResolution"] = false;
 
 	mBoolMap["ShowFilenames"] = false;
 
@@ -6,6 +6,7 @@
 #include "resources/Font.h"
 #include "resources/TextureResource.h"
 #include "InputManager.h"
+#include "InputRecorder.h"
 #include "Log.h"
 #include "Scripting.h"
 #include <algorithm>
@@ -22,11 +23,12 @@
 #include "components/BatteryIndicatorComponent.h"
 #include "guis/GuiMsgBox.h"
 #include "components/VolumeInfoComponent.h"
+#include "components/VideoVlcComponent.h"
 #include "Splash.h"
 #include "PowerSaver.h"
 
 Window::Window() : mNormalizeNextUpdate(false), mFrameTimeElapsed(0), mFrameCountElapsed(0), mAverageDeltaTime(10),
-  mAllowSleep(true), mSleeping(false), mTimeSinceLastInput(0), mScreenSaver(NULL), mRenderScreenSaver(false), mClockElapsed(0), mMouseCapture(nullptr)
+  mAllowSleep(true), mSleeping(false), mTimeSinceLastInput(0), mScreenSaver(NULL), mRenderScreenSaver(false), mClockElapsed(0), mMouseCapture(nullptr), mFrameTimerStart(0)
 {			
 	mTransitionOffset = 0;
 
@@ -116,7 +118,8 @@ bool Window::init(bool initRenderer, bool initInputManager)
 	if (initInputManager)
 		InputManager::getInstance()->init();
 
-	ResourceManager::getInstance()->reloadAll();
+	// Only what was on screen is reloaded now, the rest is reloaded over the next frames
+	ResourceManager::getInstance()->reloadVisible();
 
 	//keep a reference to the default fonts, so they don't keep getting destroyed/recreated
 	if(mDefaultFonts.empty())
@@ -199,6 +202,8 @@ void Window::input(InputConfig* config, Input input)
 {
 	if (config == nullptr)
 		return;
+
+	InputRecorder::record(config, input);
 	
 	if (config->getDeviceIndex() >= 0 && Settings::getInstance()->getBool("FirstJoystickOnly"))
 	{
@@ -426,6 +431,7 @@ void Window::update(int deltaTime)
 	}
 
 	processPostedFunctions();
+	ResourceManager::getInstance()->processPendingReloads(4);
 	processSongTitleNotifications();
 	processNotificationMessages();
 
@@ -460,6 +466,16 @@ void Window::update(int deltaTime)
 
 			ss << "\nFont VRAM: " << fontVramUsageMb << " Tex VRAM: " << textureVramUsageMb << " Tex Max: " << textureTotalUsageMb;
 
+			// draw calls
+			Renderer::Statistics stats = Renderer::getStatistics();
+			if (stats.drawRequests > 0)
+				ss << "\nDraws: " << stats.drawRequests << " Batched: " << stats.batchedDraws << " Draw calls: " << stats.drawCalls << " State changes: " << stats.stateChanges;
+
+			// video frames
+			VideoVlcComponent::FrameStatistics videoStats = VideoVlcComponent::getFrameStatistics();
+			if (videoStats.uploaded > 0)
+				ss << "\nVideo frames uploaded: " << videoStats.uploaded << " Dropped: " << videoStats.dropped;
+
 			mFrameDataText = std::unique_ptr<TextCache>(mDefaultFonts.at(0)->buildTextCache(ss.str(), Vector2f(50.f, 50.f), 0xFFFF40FF, 0.0f, ALIGN_LEFT, 1.2f));			
 		}
 
@@ -591,6 +607,8 @@ void Window::renderSindenBorders()
 
 void Window::render()
 {
+	ResourceManager::getInstance()->newFrame();
+
 	Transform4x4f transform = Transform4x4f::Identity();
 
 	mRenderedHelpPrompts = false;
@@ -749,6 +767,18 @@ void Window::render()
 
 		Renderer::setScreenMargin(margin.x(), margin.y());
 	}
+
+	if (mFrameTimerStart != 0)
+	{
+		LOG(LogInfo) << mFrameTimerName << " : first frame rendered in " << (SDL_GetTicks() - mFrameTimerStart) << "ms, " << ResourceManager::getInstance()->getPendingReloadCount() << " resources left to reload";
+		mFrameTimerStart = 0;
+	}
+}
+
+void Window::startFrameTimer(const std::string& name)
+{
+	mFrameTimerName = name;
+	mFrameTimerStart = SDL_GetTicks();
 }
 
 void Window::normalizeNextUpdate()
@@ -65,6 +65,9 @@ public:
 
 	void normalizeNextUpdate();
 
+	// Logs the time elapsed until the next frame is rendered
+	void startFrameTimer(const std::string& name);
+
 	inline bool isSleeping() const { return mSleeping; }
 	bool getAllowSleep();
 	void setAllowSleep(bool sleep);
@@ -179,6 +182,9 @@ private:
 	GuiComponent* mMouseCapture;
 	Vector2i	  mLastMousePoint;
 	int			  mLastShowCursor;
+
+	unsigned int  mFrameTimerStart;
+	std::string	  mFrameTimerName;
 };
 
 #endif // ES_CORE_WINDOW_H
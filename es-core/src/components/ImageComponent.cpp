@@ -521,6 +521,11 @@ void ImageComponent::render(const Transform4x4f& parentTrans)
 		resize();
 		updateColors();
 	}
+	else if (mTexture != nullptr && mSize == Vector2f::Zero() && mTexture->getSourceImageSize() != Vector2f::Zero())
+	{
+		// Textures loaded asynchronously without a known size (document pages) are laid out once decoded
+		resize();
+	}
 
 	Transform4x4f trans = parentTrans * getTransform();
 	
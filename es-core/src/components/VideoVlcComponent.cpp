@@ -18,34 +18,278 @@
 #endif
 
 #include "ImageIO.h"
+#include "Paths.h"
+#include "utils/FileSystemUtil.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #define MATHPI          3.141592653589793238462643383279502884L
 
+// Average frame time over which the UI is considered too slow to show every video frame (ms)
+#define SLOW_FRAME_TIME		20.0f
+
 libvlc_instance_t* VideoVlcComponent::mVLC = NULL;
 
+#define PLAYER_POOL_SIZE	3
+
+// Tracks of a video file, cached in videocache.db so videos already seen don't need to be parsed again
+struct VideoVlcInfo
+{
+	VideoVlcInfo() : fileSize(0), width(0), height(0), hasAudio(false) { }
+
+	unsigned long long fileSize;
+	int width;
+	int height;
+	bool hasAudio;
+};
+
+// Pending parse of a video file by the probing thread, cancelled when the component doesn't want it anymore
+struct VideoVlcProbe
+{
+	VideoVlcProbe(const std::string& _path) : path(_path), cancelled(false), done(false) { }
+
+	std::string path;
+	VideoVlcInfo info;
+
+	std::atomic<bool> cancelled;
+	std::atomic<bool> done;
+};
+
+static std::map<std::string, VideoVlcInfo> sVideoInfoCache;
+static std::mutex sVideoInfoCacheLock;
+static bool sVideoInfoCacheLoaded = false;
+static bool sVideoInfoCacheDirty = false;
+
+static std::thread* sProbeThread = nullptr;
+static std::mutex sProbeLock;
+static std::condition_variable sProbeEvent;
+static std::deque<std::shared_ptr<VideoVlcProbe>> sProbeQueue;
+static bool sProbeExit = false;
+
+static std::vector<libvlc_media_player_t*> sPlayerPool;
+
+static std::string getVideoInfoCacheFilename()
+{
+	return Paths::getUserEmulationStationPath() + "/videocache.db";
+}
+
+// Must be called with sVideoInfoCacheLock
+static void loadVideoInfoCache()
+{
+	if (sVideoInfoCacheLoaded)
+		return;
+
+	sVideoInfoCacheLoaded = true;
+
+	std::ifstream f(getVideoInfoCacheFilename().c_str());
+	if (f.fail())
+		return;
+
+	std::string relativeTo = Paths::getRootPath();
+
+	std::string line;
+	while (std::getline(f, line))
+	{
+		auto splits = Utils::String::split(line, '|');
+		if (splits.size() != 5)
+			continue;
+
+		VideoVlcInfo info;
+		info.fileSize = (unsigned long long) atoll(splits[1].c_str());
+		info.width = Utils::String::toInteger(splits[2]);
+		info.height = Utils::String::toInteger(splits[3]);
+		info.hasAudio = splits[4] == "1";
+
+		sVideoInfoCache[Utils::FileSystem::resolveRelativePath(splits[0], relativeTo, true)] = info;
+	}
+}
+
+static void saveVideoInfoCache()
+{
+	std::unique_lock<std::mutex> lock(sVideoInfoCacheLock);
+
+	if (!sVideoInfoCacheDirty)
+		return;
+
+	std::ofstream f(getVideoInfoCacheFilename().c_str(), std::ios::binary);
+	if (f.fail())
+		return;
+
+	std::string relativeTo = Paths::getRootPath();
+
+	for (auto it : sVideoInfoCache)
+	{
+		if (it.first.find("/themes/") != std::string::npos || it.first.find("/tmp/") != std::string::npos)
+			continue;
+
+		f << Utils::FileSystem::createRelativePath(it.first, relativeTo, true);
+		f << "|" << std::to_string(it.second.fileSize);
+		f << "|" << std::to_string(it.second.width);
+		f << "|" << std::to_string(it.second.height);
+		f << "|" << (it.second.hasAudio ? "1" : "0");
+		f << "\n";
+	}
+
+	f.close();
+	sVideoInfoCacheDirty = false;
+}
+
+static bool getCachedVideoInfo(const std::string& path, VideoVlcInfo& info)
+{
+	std::unique_lock<std::mutex> lock(sVideoInfoCacheLock);
+	loadVideoInfoCache();
+
+	auto it = sVideoInfoCache.find(path);
+	if (it == sVideoInfoCache.cend())
+		return false;
+
+	// The file was replaced since it was parsed
+	if (it->second.fileSize != Utils::FileSystem::getFileSize(path))
+		return false;
+
+	info = it->second;
+	return true;
+}
+
+static void probeVideo(libvlc_instance_t* vlc, VideoVlcProbe* probe)
+{
+#ifdef WIN32
+	std::string path(Utils::String::replace(probe->path, "/", "\\"));
+#else
+	std::string path(probe->path);
+#endif
+
+	libvlc_media_t* media = libvlc_media_new_path(vlc, path.c_str());
+	if (media == nullptr)
+		return;
+
+	// Get the media metadata so we can find the aspect ratio
+	libvlc_media_parse(media);
+
+	libvlc_media_track_t** tracks;
+	unsigned track_count = libvlc_media_tracks_get(media, &tracks);
+	for (unsigned track = 0; track < track_count; ++track)
+	{
+		if (tracks[track]->i_type == libvlc_track_audio)
+			probe->info.hasAudio = true;
+		else if (tracks[track]->i_type == libvlc_track_video)
+		{
+			probe->info.width = tracks[track]->video->i_width;
+			probe->info.height = tracks[track]->video->i_height;
+
+			if (probe->info.hasAudio)
+				break;
+		}
+	}
+
+	libvlc_media_tracks_release(tracks, track_count);
+	libvlc_media_release(media);
+
+	probe->info.fileSize = Utils::FileSystem::getFileSize(probe->path);
+
+	if (probe->info.width > 0 || probe->info.hasAudio)
+	{
+		std::unique_lock<std::mutex> lock(sVideoInfoCacheLock);
+		sVideoInfoCache[probe->path] = probe->info;
+		sVideoInfoCacheDirty = true;
+	}
+}
+
+static void probeThread(libvlc_instance_t* vlc)
+{
+	while (true)
+	{
+		std::shared_ptr<VideoVlcProbe> probe;
+
+		{
+			std::unique_lock<std::mutex> lock(sProbeLock);
+			sProbeEvent.wait(lock, [] { return sProbeExit || !sProbeQueue.empty(); });
+
+			if (sProbeExit)
+				break;
+
+			probe = sProbeQueue.front();
+			sProbeQueue.pop_front();
+		}
+
+		// The cursor moved on before the video could be parsed
+		if (probe->cancelled)
+			continue;
+
+		probeVideo(vlc, probe.get());
+		probe->done = true;
+	}
+}
+
+static std::shared_ptr<VideoVlcProbe> queueProbe(libvlc_instance_t* vlc, const std::string& path)
+{
+	auto probe = std::make_shared<VideoVlcProbe>(path);
+
+	std::unique_lock<std::mutex> lock(sProbeLock);
+
+	if (sProbeThread == nullptr)
+	{
+		sProbeExit = false;
+		sProbeThread = new std::thread(probeThread, vlc);
+	}
+
+	sProbeQueue.push_back(probe);
+	sProbeEvent.notify_one();
+
+	return probe;
+}
+
+// Media players are kept & reused : creating one for each video costs a lot when scrolling through a gamelist
+static libvlc_media_player_t* acquirePlayer(libvlc_instance_t* vlc)
+{
+	if (!sPlayerPool.empty())
+	{
+		auto player = sPlayerPool.back();
+		sPlayerPool.pop_back();
+		return player;
+	}
+
+	return libvlc_media_player_new(vlc);
+}
+
+static void releasePlayer(libvlc_media_player_t* player)
+{
+	libvlc_media_player_set_media(player, NULL);
+
+	if (sPlayerPool.size() < PLAYER_POOL_SIZE)
+		sPlayerPool.push_back(player);
+	else
+		libvlc_media_player_release(player);
+}
+
+static std::atomic<unsigned int> sUploadedFrames(0);
+static std::atomic<unsigned int> sDroppedFrames(0);
+
 // VLC prepares to render a video frame.
 static void *lock(void *data, void **p_pixels) 
 {
 	struct VideoContext *c = (struct VideoContext *)data;
 	
-	int frame = (c->surfaceId ^ 1);
-	
-	c->mutexes[frame].lock();
-	c->hasFrame[frame] = false;
-	*p_pixels = c->surfaces[frame];
+	*p_pixels = c->surfaces[c->writeIndex];
 	return NULL; // Picture identifier, not needed here.
 }
 
-// VLC just rendered a video frame.
+// VLC just rendered a video frame : publish it, and decode the next one in the frame that was waiting
 static void unlock(void *data, void* /*id*/, void *const* /*p_pixels*/) 
 {
 	struct VideoContext *c = (struct VideoContext *)data;
 
-	int frame = (c->surfaceId ^ 1);	
+	int previous = c->ready.exchange(c->writeIndex | VIDEO_FRAME_FRESH);
+	if (previous & VIDEO_FRAME_FRESH)
+		sDroppedFrames++;
 
-	c->surfaceId = frame;
-	c->hasFrame[frame] = true;
-	c->mutexes[frame].unlock();
+	c->writeIndex = previous & VIDEO_FRAME_INDEX;
 }
 
 // VLC wants to display a video frame.
@@ -62,10 +306,12 @@ static void display(void* data, void* id)
 VideoVlcComponent::VideoVlcComponent(Window* window) :
 	VideoComponent(window),
 	mMediaPlayer(nullptr), 
+	mMediaPlayerPooled(false),
 	mMedia(nullptr)
 {
 	mSaturation = 1.0f;
 	mElapsed = 0;
+	mAverageFrameTime = 0;
 	mColorShift = 0xFFFFFFFF;
 	mLinearSmooth = false;
 
@@ -242,8 +488,7 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	// Build a texture for the video frame
 	if (initFromPixels)
 	{		
-		int frame = mContext.surfaceId;
-		if (mContext.hasFrame[frame])
+		if (mContext.ready & VIDEO_FRAME_FRESH)
 		{
 			if (mTexture == nullptr)
 			{
@@ -254,16 +499,24 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 				Renderer::setMatrix(trans);
 			}
 
+			bool upload = true;
+
 #ifdef _RPI_
 			// Rpi : A lot of videos are encoded in 60fps on screenscraper
 			// Try to limit transfert to opengl textures to 30fps to save CPU
-			if (!Settings::getInstance()->getBool("OptimizeVideo") || mElapsed >= 40) // 40ms = 25fps, 33.33 = 30 fps
+			if (Settings::getInstance()->getBool("OptimizeVideo") && mElapsed < 40) // 40ms = 25fps, 33.33 = 30 fps
+				upload = false;
 #endif
+
+			// The UI is too slow to show every frame : upload one frame out of two, the newest one is kept in the meantime
+			if (mAverageFrameTime > SLOW_FRAME_TIME && mElapsed < mAverageFrameTime * 2)
+				upload = false;
+
+			if (upload)
 			{
-				mContext.mutexes[frame].lock();
-				mTexture->updateFromExternalPixels(mContext.surfaces[frame], mVideoWidth, mVideoHeight);
-				mContext.hasFrame[frame] = false;
-				mContext.mutexes[frame].unlock();
+				mContext.readIndex = mContext.ready.exchange(mContext.readIndex) & VIDEO_FRAME_INDEX;
+				mTexture->updateFromExternalPixels(mContext.surfaces[mContext.readIndex], mVideoWidth, mVideoHeight);
+				sUploadedFrames++;
 
 				mElapsed = 0;
 			}
@@ -403,10 +656,12 @@ void VideoVlcComponent::setupContext()
 		return;
 	
 	// Create an RGBA surface to render the video into
-	mContext.surfaces[0] = new unsigned char[mVideoWidth * mVideoHeight * 4];
-	mContext.surfaces[1] = new unsigned char[mVideoWidth * mVideoHeight * 4];
-	mContext.hasFrame[0] = false;	
-	mContext.hasFrame[1] = false;
+	for (int i = 0; i < 3; i++)
+		mContext.surfaces[i] = new unsigned char[mVideoWidth * mVideoHeight * 4];
+
+	mContext.writeIndex = 0;
+	mContext.readIndex = 1;
+	mContext.ready = 2;
 	mContext.component = this;
 	mContext.valid = true;	
 	resize();	
@@ -423,12 +678,13 @@ void VideoVlcComponent::freeContext()
 		mTexture = nullptr;
 	}
 
-	delete[] mContext.surfaces[0];
-	delete[] mContext.surfaces[1];
-	mContext.surfaces[0] = nullptr;
-	mContext.surfaces[1] = nullptr;	
-	mContext.hasFrame[0] = false;
-	mContext.hasFrame[1] = false;
+	for (int i = 0; i < 3; i++)
+	{
+		delete[] mContext.surfaces[i];
+		mContext.surfaces[i] = nullptr;
+	}
+
+	mContext.ready = 2;
 	mContext.component = NULL;
 	mContext.valid = false;			
 }
@@ -516,6 +772,35 @@ void VideoVlcComponent::init()
 	mVLC = libvlc_new(cmdline.size(), theArgs);
 
 	delete[] theArgs;
+
+	// Pre-warm the pool, so the first videos don't pay for the player creation
+	if (mVLC != nullptr)
+		for (int i = 0; i < PLAYER_POOL_SIZE - 1; i++)
+			sPlayerPool.push_back(libvlc_media_player_new(mVLC));
+}
+
+void VideoVlcComponent::deinit()
+{
+	if (sProbeThread != nullptr)
+	{
+		{
+			std::unique_lock<std::mutex> lock(sProbeLock);
+			sProbeExit = true;
+			sProbeQueue.clear();
+			sProbeEvent.notify_one();
+		}
+
+		sProbeThread->join();
+		delete sProbeThread;
+		sProbeThread = nullptr;
+	}
+
+	for (auto player : sPlayerPool)
+		libvlc_media_player_release(player);
+
+	sPlayerPool.clear();
+
+	saveVideoInfoCache();
 }
 
 void VideoVlcComponent::handleLooping()
@@ -587,119 +872,127 @@ void VideoVlcComponent::startVideo()
 	mVideoWidth = 0;
 	mVideoHeight = 0;
 
+	// Make sure we have a video path
+	if (mVLC && (mVideoPath.size() > 0))
+	{
+		// Set the video that we are going to be playing so we don't attempt to restart it
+		mPlayingVideoPath = mVideoPath;
+
+		VideoVlcInfo info;
+		if (getCachedVideoInfo(mVideoPath, info))
+			playVideo(info);
+		else
+		{
+			// Parsing the media blocks : it is done by the probing thread, the video starts in update() once its tracks are known
+			mProbe = queueProbe(mVLC, mVideoPath);
+		}
+	}
+}
+
+void VideoVlcComponent::playVideo(const VideoVlcInfo& info)
+{
 #ifdef WIN32
 	std::string path(Utils::String::replace(mVideoPath, "/", "\\"));
 #else
 	std::string path(mVideoPath);
 #endif
-	// Make sure we have a video path
-	if (mVLC && (path.size() > 0))
-	{
-		// Set the video that we are going to be playing so we don't attempt to restart it
-		mPlayingVideoPath = mVideoPath;
 
-		// Open the media
-		mMedia = libvlc_media_new_path(mVLC, path.c_str());
-		if (mMedia)
-		{			
-			// use : vlc long-help
-			// WIN32 ? libvlc_media_add_option(mMedia, ":avcodec-hw=dxva2");
-			// RPI/OMX ? libvlc_media_add_option(mMedia, ":codec=mediacodec,iomx,all"); .
+	// Open the media
+	mMedia = libvlc_media_new_path(mVLC, path.c_str());
+	if (mMedia)
+	{			
+		// use : vlc long-help
+		// WIN32 ? libvlc_media_add_option(mMedia, ":avcodec-hw=dxva2");
+		// RPI/OMX ? libvlc_media_add_option(mMedia, ":codec=mediacodec,iomx,all"); .
 
-			std::string options = SystemConf::getInstance()->get("vlc.options");
-			if (!options.empty())
-			{
-				std::vector<std::string> tokens = Utils::String::split(options, ' ');
-				for (auto token : tokens)
-					libvlc_media_add_option(mMedia, token.c_str());
-			}
+		std::string options = SystemConf::getInstance()->get("vlc.options");
+		if (!options.empty())
+		{
+			std::vector<std::string> tokens = Utils::String::split(options, ' ');
+			for (auto token : tokens)
+				libvlc_media_add_option(mMedia, token.c_str());
+		}
 			
-			// If we have a playlist : most videos have a fader, skip it 1 second
-			if (mPlaylist != nullptr && mConfig.startDelay == 0 && !mConfig.showSnapshotDelay && !mConfig.showSnapshotNoVideo)
-				libvlc_media_add_option(mMedia, ":start-time=0.7");			
-
-			bool hasAudioTrack = false;
-
-			unsigned track_count;
-			// Get the media metadata so we can find the aspect ratio
-			libvlc_media_parse(mMedia);
-			libvlc_media_track_t** tracks;
-			track_count = libvlc_media_tracks_get(mMedia, &tracks);
-			for (unsigned track = 0; track < track_count; ++track)
-			{
-				if (tracks[track]->i_type == libvlc_track_audio)
-					hasAudioTrack = true;
-				else if (tracks[track]->i_type == libvlc_track_video)
-				{
-					mVideoWidth = tracks[track]->video->i_width;
-					mVideoHeight = tracks[track]->video->i_height;		
+		// If we have a playlist : most videos have a fader, skip it 1 second
+		if (mPlaylist != nullptr && mConfig.startDelay == 0 && !mConfig.showSnapshotDelay && !mConfig.showSnapshotNoVideo)
+			libvlc_media_add_option(mMedia, ":start-time=0.7");			
 
-					if (hasAudioTrack)
-						break;
-				}
-			}
-			libvlc_media_tracks_release(tracks, track_count);
+		bool hasAudioTrack = info.hasAudio;
+		mVideoWidth = info.width;
+		mVideoHeight = info.height;
 
-			if (mVideoWidth == 0 && mVideoHeight == 0 && Utils::FileSystem::isAudio(path))
+		if (mVideoWidth == 0 && mVideoHeight == 0 && Utils::FileSystem::isAudio(path))
+		{
+			if (getPlayAudio() && !mScreensaverMode && Settings::getInstance()->getBool("VideoAudio"))
 			{
-				if (getPlayAudio() && !mScreensaverMode && Settings::getInstance()->getBool("VideoAudio"))
-				{
-					// Make fake dimension to play audio files
-					mVideoWidth = 1;
-					mVideoHeight = 1;
-				}
+				// Make fake dimension to play audio files
+				mVideoWidth = 1;
+				mVideoHeight = 1;
 			}
+		}
 
-			// Make sure we found a valid video track
-			if ((mVideoWidth > 0) && (mVideoHeight > 0))
-			{			
-				if (mVideoWidth > 1 && Settings::getInstance()->getBool("OptimizeVideo"))
-				{
-					// Avoid videos bigger than resolution
-					Vector2f maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
+		// Make sure we found a valid video track
+		if ((mVideoWidth > 0) && (mVideoHeight > 0))
+		{			
+			if (mVideoWidth > 1 && Settings::getInstance()->getBool("OptimizeVideo"))
+			{
+				// Avoid videos bigger than resolution
+				Vector2f maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
 										
 #ifdef _RPI_
-					// Temporary -> RPI -> Try to limit videos to 400x300 for performance benchmark
-					if (!Renderer::isSmallScreen())
-						maxSize = Vector2f(400, 300);
+				// Temporary -> RPI -> Try to limit videos to 400x300 for performance benchmark
+				if (!Renderer::isSmallScreen())
+					maxSize = Vector2f(400, 300);
 #endif
 
-					if (!mTargetSize.empty() && (mTargetSize.x() < maxSize.x() || mTargetSize.y() < maxSize.y()))
-						maxSize = mTargetSize;
+				if (!mTargetSize.empty() && (mTargetSize.x() < maxSize.x() || mTargetSize.y() < maxSize.y()))
+					maxSize = mTargetSize;
 
-					
+				
 
-					// If video is bigger than display, ask VLC for a smaller image
-					auto sz = ImageIO::adjustPictureSize(Vector2i(mVideoWidth, mVideoHeight), Vector2i(maxSize.x(), maxSize.y()), mTargetIsMin);
-					if (sz.x() < mVideoWidth || sz.y() < mVideoHeight)
-					{
-						mVideoWidth = sz.x();
-						mVideoHeight = sz.y();
-					}
+				// If video is bigger than display, ask VLC for a smaller image
+				auto sz = ImageIO::adjustPictureSize(Vector2i(mVideoWidth, mVideoHeight), Vector2i(maxSize.x(), maxSize.y()), mTargetIsMin);
+				if (sz.x() < mVideoWidth || sz.y() < mVideoHeight)
+				{
+					mVideoWidth = sz.x();
+					mVideoHeight = sz.y();
 				}
+			}
+
+			// Shown at half its size or less : let VLC scale it down, there are 4 times less pixels to convert & upload
+			if (mVideoWidth > 1 && Settings::getInstance()->getBool("VideoHalfResolution") && mTargetSize.x() > 0 && mTargetSize.y() > 0 && 
+				mTargetSize.x() * 2 <= mVideoWidth && mTargetSize.y() * 2 <= mVideoHeight)
+			{
+				mVideoWidth /= 2;
+				mVideoHeight /= 2;
+			}
 
-				PowerSaver::pause();
-				setupContext();
+			PowerSaver::pause();
+			setupContext();
 
-				// Setup the media player
-				mMediaPlayer = libvlc_media_player_new_from_media(mMedia);
+			// Setup the media player. Audio only players have no video callbacks, they are not kept in the pool
+			mMediaPlayerPooled = (mVideoWidth > 1);
+			mMediaPlayer = mMediaPlayerPooled ? acquirePlayer(mVLC) : libvlc_media_player_new(mVLC);
+			libvlc_media_player_set_media(mMediaPlayer, mMedia);
 			
-				if (hasAudioTrack)
+			if (hasAudioTrack)
+			{
+				if (!getPlayAudio() || (!mScreensaverMode && !Settings::getInstance()->getBool("VideoAudio")) || (Settings::getInstance()->getBool("ScreenSaverVideoMute") && mScreensaverMode))
+					libvlc_audio_set_mute(mMediaPlayer, 1);
+				else
 				{
-					if (!getPlayAudio() || (!mScreensaverMode && !Settings::getInstance()->getBool("VideoAudio")) || (Settings::getInstance()->getBool("ScreenSaverVideoMute") && mScreensaverMode))
-						libvlc_audio_set_mute(mMediaPlayer, 1);
-					else
-						AudioManager::setVideoPlaying(true);
+					libvlc_audio_set_mute(mMediaPlayer, 0);
+					AudioManager::setVideoPlaying(true);
 				}
+			}
 
-				libvlc_media_player_play(mMediaPlayer);
-
-				if (mVideoWidth > 1)
-				{
-					libvlc_video_set_callbacks(mMediaPlayer, lock, unlock, display, (void*)&mContext);
-					libvlc_video_set_format(mMediaPlayer, "RGBA", (int)mVideoWidth, (int)mVideoHeight, (int)mVideoWidth * 4);
-				}
+			if (mVideoWidth > 1)
+			{
+				libvlc_video_set_callbacks(mMediaPlayer, lock, unlock, display, (void*)&mContext);
+				libvlc_video_set_format(mMediaPlayer, "RGBA", (int)mVideoWidth, (int)mVideoHeight, (int)mVideoWidth * 4);
 			}
+
+			libvlc_media_player_play(mMediaPlayer);
 		}
 	}
 }
@@ -710,11 +1003,23 @@ void VideoVlcComponent::stopVideo()
 	mIsWaitingForVideoToStart = false;
 	mStartDelayed = false;
 
+	// The video is not wanted anymore, don't parse it if it is still queued
+	if (mProbe != nullptr)
+	{
+		mProbe->cancelled = true;
+		mProbe = nullptr;
+	}
+
 	// Release the media player so it stops calling back to us
 	if (mMediaPlayer)
 	{
 		libvlc_media_player_stop(mMediaPlayer);
-		libvlc_media_player_release(mMediaPlayer);
+
+		if (mMediaPlayerPooled)
+			releasePlayer(mMediaPlayer);
+		else
+			libvlc_media_player_release(mMediaPlayer);
+
 		mMediaPlayer = NULL;
 	}
 
@@ -786,6 +1091,17 @@ void VideoVlcComponent::applyTheme(const std::shared_ptr<ThemeData>& theme, cons
 void VideoVlcComponent::update(int deltaTime)
 {
 	mElapsed += deltaTime;
+	mAverageFrameTime = mAverageFrameTime * 0.9f + deltaTime * 0.1f;
+
+	// Tracks of the video are known, start it if it is still wanted
+	if (mProbe != nullptr && mProbe->done)
+	{
+		VideoVlcInfo info = mProbe->info;
+		mProbe = nullptr;
+
+		if (mIsWaitingForVideoToStart && !mIsPlaying && mPlayingVideoPath == mVideoPath)
+			playVideo(info);
+	}
 
 	if (mConfig.showSnapshotNoVideo || mConfig.showSnapshotDelay)
 		mStaticImage.update(deltaTime);
@@ -883,6 +1199,14 @@ bool VideoVlcComponent::isPaused()
 	return !mIsPlaying && !mIsWaitingForVideoToStart && !mStartDelayed && mMediaPlayer != NULL;
 }
 
+VideoVlcComponent::FrameStatistics VideoVlcComponent::getFrameStatistics()
+{
+	FrameStatistics stats;
+	stats.uploaded = sUploadedFrames;
+	stats.dropped = sDroppedFrames;
+	return stats;
+}
+
 void VideoVlcComponent::setSaturation(float saturation)
 {
 	mSaturation = saturation;
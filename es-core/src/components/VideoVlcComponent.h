@@ -4,29 +4,38 @@
 
 #include "VideoComponent.h"
 #include "ThemeData.h"
-#include <mutex>
+#include <atomic>
 
 struct libvlc_instance_t;
 struct libvlc_media_t;
 struct libvlc_media_player_t;
 
+struct VideoVlcInfo;
+struct VideoVlcProbe;
+
+#define VIDEO_FRAME_INDEX	3
+#define VIDEO_FRAME_FRESH	4
+
+// Triple buffer : VLC decodes into surfaces[writeIndex], the render thread uploads surfaces[readIndex], and the last
+// complete frame waits in 'ready'. Indexes are swapped atomically, so the decoder & the render thread never wait for each other.
 struct VideoContext 
 {
 	VideoContext()
 	{
 		surfaces[0] = nullptr;
 		surfaces[1] = nullptr;
+		surfaces[2] = nullptr;
 		component = nullptr;
 		valid = false;
-		hasFrame[0] = false;
-		hasFrame[1] = false;
-		surfaceId = 0;
+		writeIndex = 0;
+		readIndex = 1;
+		ready = 2;
 	}
 
-	int					surfaceId;
-	unsigned char*		surfaces[2];	
-	std::mutex			mutexes[2];
-	bool				hasFrame[2];
+	unsigned char*		surfaces[3];
+	int					writeIndex;		// decoder thread only
+	int					readIndex;		// render thread only
+	std::atomic<int>	ready;			// index of the last complete frame, | VIDEO_FRAME_FRESH until it is uploaded
 
 	VideoComponent*		component;
 	bool				valid;	
@@ -57,6 +66,8 @@ class VideoVlcComponent : public VideoComponent
 
 public:
 	static void init();
+	// Stops the probing thread, releases the pooled players & saves the video information cache
+	static void deinit();
 
 	VideoVlcComponent(Window* window);
 	virtual ~VideoVlcComponent();
@@ -92,12 +103,21 @@ public:
 
 	void setSaturation(float saturation);
 
+	struct FrameStatistics
+	{
+		unsigned int uploaded;	// frames sent to a texture
+		unsigned int dropped;	// decoded frames replaced by the next one before being uploaded
+	};
+
+	static FrameStatistics getFrameStatistics();
+
 private:
 	// Calculates the correct mSize from our resizing information (set by setResize/setMaxSize).
 	// Used internally whenever the resizing parameters or texture change.
 	void resize();
-	// Start the video Immediately
+	// Start the video Immediately : tracks are probed by a thread if they are not in the cache, the video is played once known
 	virtual void startVideo();
+	void playVideo(const VideoVlcInfo& info);
 	// Stop the video
 	virtual void stopVideo();
 
@@ -117,6 +137,8 @@ private:
 	static libvlc_instance_t*		mVLC;
 	libvlc_media_t*					mMedia;
 	libvlc_media_player_t*			mMediaPlayer;
+	bool							mMediaPlayerPooled;
+	std::shared_ptr<VideoVlcProbe>	mProbe;
 	VideoContext					mContext;
 	std::shared_ptr<TextureResource> mTexture;
 
@@ -128,6 +150,7 @@ private:
 
 	unsigned int					mColorShift;
 	int								mElapsed;
+	float							mAverageFrameTime;
 
 	int								mCurrentLoop;
 	int								mLoops;
@@ -3,6 +3,7 @@
 #include "Renderer_GL21.h"
 #include "Renderer_GLES10.h"
 #include "Renderer_GLES20.h"
+#include "Renderer_Headless.h"
 
 #include "math/Transform4x4f.h"
 #include "math/Vector2i.h"
@@ -132,6 +133,10 @@ namespace Renderer
 	{
 		LOG(LogInfo) << "Creating window...";
 
+		// Without GPU nor display : use SDL dummy video driver, unless another one is explicitly requested
+		if (isHeadless())
+			SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
 		if(SDL_Init(SDL_INIT_VIDEO) != 0)
 		{
 			LOG(LogError) << "Error initializing SDL!\n	" << SDL_GetError();
@@ -741,6 +746,10 @@ namespace Renderer
 
 	static IRenderer* createRenderer()
 	{
+		// Set from the command line only, so a benchmark never changes the renderer saved in settings
+		if (Settings::getInstance()->getBool("Headless"))
+			return new HeadlessRenderer();
+
 		IRenderer* instance = getRendererFromName(Settings::getInstance()->getString("Renderer"));
 		if (instance == nullptr)
 		{
@@ -888,4 +897,14 @@ namespace Renderer
 		return Instance()->getTotalMemUsage();
 	}
 
+	Statistics getStatistics()
+	{
+		return Instance()->getStatistics();
+	}
+
+	bool isHeadless()
+	{
+		return Instance()->isHeadless();
+	}
+
 } // Renderer::
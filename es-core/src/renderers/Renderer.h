@@ -83,6 +83,20 @@ namespace Renderer
 
 	}; // Vertex
 
+	// Counters of the last rendered frame, for profiling
+	struct Statistics
+	{
+		Statistics() : drawRequests(0), batchedDraws(0), drawCalls(0), stateChanges(0), vertices(0), textureUploads(0) { }
+
+		unsigned int drawRequests;	// draw functions called by components
+		unsigned int batchedDraws;	// requests merged into a batch instead of being drawn on their own
+		unsigned int drawCalls;		// draw calls sent to the driver
+		unsigned int stateChanges;	// texture, shader & blend mode changes
+		unsigned int vertices;		// vertices received from components
+		unsigned int textureUploads;	// textures created or updated with pixel data
+
+	}; // Statistics
+
 	class IRenderer
 	{
 	public:
@@ -119,6 +133,9 @@ namespace Renderer
 		virtual void         swapBuffers() = 0;
 
 		virtual size_t		 getTotalMemUsage() { return (size_t) -1; };
+		virtual Statistics	 getStatistics() { return Statistics(); };
+
+		virtual bool		 isHeadless() { return false; };
 	};
 	
 	std::vector<std::string> getRendererNames();
@@ -170,6 +187,8 @@ namespace Renderer
 	void         swapBuffers       ();
 
 	size_t		 getTotalMemUsage  ();
+	Statistics	 getStatistics     ();
+	bool		 isHeadless        ();
 
 	std::string  getDriverName();
 	std::vector<std::pair<std::string, std::string>> getDriverInformation();
@@ -14,6 +14,8 @@
 namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
+	static Statistics		frameStatistics;
+	static Statistics		lastFrameStatistics;
 	static unsigned int boundTexture = 0;
 
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
@@ -124,6 +126,9 @@ namespace Renderer
 
 	unsigned int OpenGL21Renderer::createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		if (_data != nullptr)
+			frameStatistics.textureUploads++;
+
 		const GLenum type = convertTextureType(_type);
 		unsigned int texture;
 
@@ -163,6 +168,8 @@ namespace Renderer
 
 	void OpenGL21Renderer::updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		frameStatistics.textureUploads++;
+
 		glBindTexture(GL_TEXTURE_2D, _texture);
 
 		if (_x == -1 && _y == -1)
@@ -183,6 +190,7 @@ namespace Renderer
 			return;
 
 		boundTexture = _texture;
+		frameStatistics.stateChanges++;
 
 		glBindTexture(GL_TEXTURE_2D, _texture);
 
@@ -206,6 +214,10 @@ namespace Renderer
 
 		glDrawArrays(GL_LINES, 0, _numVertices);
 
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
+
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
@@ -227,6 +239,10 @@ namespace Renderer
 		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &_vertices[0].tex);
 		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices);
+
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
 		
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -303,6 +319,9 @@ namespace Renderer
 
 		SDL_GL_SwapWindow(getSDLWindow());
 
+		lastFrameStatistics = frameStatistics;
+		frameStatistics = Statistics();
+
 #ifdef WIN32		
 		Sleep(0);
 #endif
@@ -328,6 +347,10 @@ namespace Renderer
 
 		glDrawArrays(GL_TRIANGLE_FAN, 0, _numVertices);
 
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
+
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
@@ -368,6 +391,11 @@ namespace Renderer
 		glDisable(GL_STENCIL_TEST);
 	}
 
+	Statistics OpenGL21Renderer::getStatistics()
+	{
+		return lastFrameStatistics;
+	}
+
 } // Renderer::
 
 #endif // USE_OPENGL_21
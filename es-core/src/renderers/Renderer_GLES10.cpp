@@ -19,6 +19,8 @@
 namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
+	static Statistics		frameStatistics;
+	static Statistics		lastFrameStatistics;
 
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
 	{
@@ -124,6 +126,9 @@ namespace Renderer
 
 	unsigned int GLES10Renderer::createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		if (_data != nullptr)
+			frameStatistics.textureUploads++;
+
 		const GLenum type = convertTextureType(_type);
 		unsigned int texture;
 
@@ -162,6 +167,8 @@ namespace Renderer
 
 	void GLES10Renderer::updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		frameStatistics.textureUploads++;
+
 		bindTexture(_texture);
 
 		if (_x == -1 && _y == -1)
@@ -178,6 +185,8 @@ namespace Renderer
 
 	void GLES10Renderer::bindTexture(const unsigned int _texture)
 	{
+		frameStatistics.stateChanges++;
+
 		glBindTexture(GL_TEXTURE_2D, _texture);
 
 		if(_texture == 0) glDisable(GL_TEXTURE_2D);
@@ -200,6 +209,10 @@ namespace Renderer
 
 		glDrawArrays(GL_LINES, 0, _numVertices);
 
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
+
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
@@ -223,6 +236,10 @@ namespace Renderer
 
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices);
 
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
+
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
@@ -291,6 +308,10 @@ namespace Renderer
 	void GLES10Renderer::swapBuffers()
 	{
 		SDL_GL_SwapWindow(getSDLWindow());
+
+		lastFrameStatistics = frameStatistics;
+		frameStatistics = Statistics();
+
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	} // swapBuffers
@@ -310,6 +331,10 @@ namespace Renderer
 
 		glDrawArrays(GL_TRIANGLE_FAN, 0, _numVertices);
 
+		frameStatistics.drawRequests++;
+		frameStatistics.drawCalls++;
+		frameStatistics.vertices += _numVertices;
+
 		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
@@ -347,6 +372,12 @@ namespace Renderer
 	{
 		glDisable(GL_STENCIL_TEST);
 	}
+
+	Statistics GLES10Renderer::getStatistics()
+	{
+		return lastFrameStatistics;
+	}
+
 } // Renderer::
 
 #endif // USE_OPENGLES_10
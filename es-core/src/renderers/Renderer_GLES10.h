@@ -44,6 +44,8 @@ namespace Renderer
 
 		void         setSwapInterval() override;
 		void         swapBuffers() override;
+
+		Statistics	 getStatistics() override;
 	};
 };
 
@@ -8,6 +8,7 @@
 #include "Log.h"
 #include "Settings.h"
 
+#include <algorithm>
 #include <vector>
 #include <set>
 
@@ -45,14 +46,17 @@ namespace Renderer
 
 //////////////////////////////////////////////////////////////////////////
 
+	static Statistics		frameStatistics;
+	static Statistics		lastFrameStatistics;
+
 	static ShaderProgram* currentProgram = nullptr;
 	
-	static void useProgram(ShaderProgram* program)
+	static void useProgram(ShaderProgram* program, Transform4x4f& matrix = mvpMatrix)
 	{
 		if (program == currentProgram)
 		{
 			if (currentProgram != nullptr)
-				currentProgram->setMatrix(mvpMatrix);
+				currentProgram->setMatrix(matrix);
 
 			return;
 		}
@@ -65,7 +69,8 @@ namespace Renderer
 		if (currentProgram != nullptr)
 		{
 			currentProgram->select();
-			currentProgram->setMatrix(mvpMatrix);
+			currentProgram->setMatrix(matrix);
+			frameStatistics.stateChanges++;
 		}
 	}
 
@@ -228,13 +233,44 @@ namespace Renderer
 
 //////////////////////////////////////////////////////////////////////////
 
+	// Vertices are streamed into a persistent buffer used as a ring : each upload goes after the previous one,
+	// and the storage is orphaned when the end is reached so the driver never waits for pending draws.
+	#define VERTEX_BUFFER_SIZE	16384
+
+	static unsigned int		vertexBufferOffset = 0;
+	static unsigned int		lastUploadFirst = 0;
+	static unsigned int		lastUploadCount = 0;
+
 	static void setupVertexBuffer()
 	{
 		GL_CHECK_ERROR(glGenBuffers(1, &vertexBuffer));
 		GL_CHECK_ERROR(glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer));
+		GL_CHECK_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * VERTEX_BUFFER_SIZE, nullptr, GL_STREAM_DRAW));
+
+		vertexBufferOffset = 0;
+		lastUploadCount = 0;
 
 	} // setupVertexBuffer
 
+	// Returns the index of the first uploaded vertex in the buffer
+	static unsigned int uploadVertices(const Vertex* _vertices, const unsigned int _numVertices)
+	{
+		if (vertexBufferOffset + _numVertices > VERTEX_BUFFER_SIZE)
+		{
+			GL_CHECK_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * std::max(_numVertices, (unsigned int)VERTEX_BUFFER_SIZE), nullptr, GL_STREAM_DRAW));
+			vertexBufferOffset = 0;
+		}
+
+		GL_CHECK_ERROR(glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertexBufferOffset, sizeof(Vertex) * _numVertices, _vertices));
+
+		lastUploadFirst = vertexBufferOffset;
+		lastUploadCount = _numVertices;
+
+		vertexBufferOffset += _numVertices;
+		return lastUploadFirst;
+
+	} // uploadVertices
+
 //////////////////////////////////////////////////////////////////////////
 
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
@@ -273,6 +309,147 @@ namespace Renderer
 
 	} // convertTextureType
 
+//////////////////////////////////////////////////////////////////////////
+
+	// Blending is only enabled for factors other than ONE : ONE is never cached, so it marks an unknown blend func
+	static int				blendEnabled = -1;
+	static Blend::Factor	blendSrcFactor = Blend::ONE;
+	static Blend::Factor	blendDstFactor = Blend::ONE;
+
+	// A new context starts with blending disabled and ONE/ZERO : the next setBlendMode must set both again
+	static void resetBlendMode()
+	{
+		blendEnabled = -1;
+		blendSrcFactor = Blend::ONE;
+		blendDstFactor = Blend::ONE;
+	}
+
+	static void setBlendMode(const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		const bool enable = _srcBlendFactor != Blend::ONE && _dstBlendFactor != Blend::ONE;
+
+		if (blendEnabled != (enable ? 1 : 0))
+		{
+			if (enable)
+				GL_CHECK_ERROR(glEnable(GL_BLEND));
+			else
+				GL_CHECK_ERROR(glDisable(GL_BLEND));
+
+			blendEnabled = enable ? 1 : 0;
+			frameStatistics.stateChanges++;
+		}
+
+		if (enable && (blendSrcFactor != _srcBlendFactor || blendDstFactor != _dstBlendFactor))
+		{
+			GL_CHECK_ERROR(glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor)));
+
+			blendSrcFactor = _srcBlendFactor;
+			blendDstFactor = _dstBlendFactor;
+			frameStatistics.stateChanges++;
+		}
+
+	} // setBlendMode
+
+//////////////////////////////////////////////////////////////////////////
+
+	// Triangle strips sharing the same texture, shader, saturation & blend mode are merged into one draw call.
+	// Strips are joined with degenerate triangles, and their vertices are transformed on the CPU so the
+	// world matrix set by each component does not break the batch : the batch is drawn with the projection only.
+	#define BATCH_MAX_VERTICES	VERTEX_BUFFER_SIZE
+
+	struct DrawBatch
+	{
+		std::vector<Vertex> vertices;
+
+		unsigned int	texture;
+		ShaderProgram*	program;
+		float			saturation;
+		Blend::Factor	srcBlendFactor;
+		Blend::Factor	dstBlendFactor;
+	};
+
+	static DrawBatch		drawBatch;
+	static bool				batchingEnabled = true;
+	static bool				worldViewIs2D = true;
+
+	static void flushBatch()
+	{
+		if (drawBatch.vertices.empty())
+			return;
+
+		const unsigned int first = uploadVertices(drawBatch.vertices.data(), drawBatch.vertices.size());
+
+		useProgram(drawBatch.program, projectionMatrix);
+
+		if (drawBatch.program == &shaderProgramColorTexture)
+			drawBatch.program->setSaturation(drawBatch.saturation);
+
+		setBlendMode(drawBatch.srcBlendFactor, drawBatch.dstBlendFactor);
+		GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, first, drawBatch.vertices.size()));
+
+		frameStatistics.drawCalls++;
+		drawBatch.vertices.clear();
+
+		// The buffer content no longer matches the last unbatched draw
+		lastUploadCount = 0;
+
+	} // flushBatch
+
+	static void addToBatch(const Vertex* _vertices, const unsigned int _numVertices, ShaderProgram* _program, const float _saturation, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		bool sameState = 
+			drawBatch.texture == boundTexture && 
+			drawBatch.program == _program && 
+			drawBatch.saturation == _saturation && 
+			drawBatch.srcBlendFactor == _srcBlendFactor && 
+			drawBatch.dstBlendFactor == _dstBlendFactor;
+
+		if (!drawBatch.vertices.empty() && (!sameState || drawBatch.vertices.size() + _numVertices + 3 > BATCH_MAX_VERTICES))
+			flushBatch();
+
+		drawBatch.texture = boundTexture;
+		drawBatch.program = _program;
+		drawBatch.saturation = _saturation;
+		drawBatch.srcBlendFactor = _srcBlendFactor;
+		drawBatch.dstBlendFactor = _dstBlendFactor;
+
+		const Vector4f& r0 = worldViewMatrix.r0();
+		const Vector4f& r1 = worldViewMatrix.r1();
+		const Vector4f& r3 = worldViewMatrix.r3();
+
+		std::vector<Vertex>& batch = drawBatch.vertices;
+		size_t start = batch.size();
+
+		if (start > 0)
+		{
+			// Repeat the last vertex of the previous strip & the first of this one : the joining triangles have no area.
+			// An extra vertex keeps the winding of the new strip if the previous one has an odd length
+			batch.push_back(batch.back());
+			if (start % 2 != 0)
+				batch.push_back(batch.back());
+
+			start = batch.size() + 1;
+		}
+
+		batch.resize(start + _numVertices);
+
+		for (unsigned int i = 0; i < _numVertices; i++)
+		{
+			Vertex& vertex = batch[start + i];
+			vertex = _vertices[i];
+
+			const float x = _vertices[i].pos.x();
+			const float y = _vertices[i].pos.y();
+			vertex.pos = Vector2f(r0.x() * x + r1.x() * y + r3.x(), r0.y() * x + r1.y() * y + r3.y());
+		}
+
+		if (start > 0)
+			batch[start - 1] = batch[start];
+
+		frameStatistics.batchedDraws++;
+
+	} // addToBatch
+
 //////////////////////////////////////////////////////////////////////////
 
 	#ifndef GL_GPU_MEM_INFO_CURRENT_AVAILABLE_MEM_NVX
@@ -430,6 +607,8 @@ namespace Renderer
 		setupDefaultShaders();
 		setupVertexBuffer();
 
+		resetBlendMode();
+
 		GL_CHECK_ERROR(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
 
 #if OPENGL_EXTENSIONS
@@ -447,6 +626,7 @@ namespace Renderer
 
 	void GLES20Renderer::resetCache()
 	{
+		flushBatch();
 		bindTexture(0);
 
 		for (auto customShader : customShaders)
@@ -469,6 +649,11 @@ namespace Renderer
 
 	unsigned int GLES20Renderer::createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		flushBatch();
+
+		if (_data != nullptr)
+			frameStatistics.textureUploads++;
+
 		const GLenum type = convertTextureType(_type);
 
 		unsigned int texture = -1;
@@ -549,6 +734,8 @@ namespace Renderer
 
 	void GLES20Renderer::destroyTexture(const unsigned int _texture)
 	{
+		flushBatch();
+
 		auto it = _textures.find(_texture);
 		if (it != _textures.cend())
 		{
@@ -569,6 +756,10 @@ namespace Renderer
 
 	void GLES20Renderer::updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
 	{
+		flushBatch();
+
+		frameStatistics.textureUploads++;
+
 		const GLenum type = convertTextureType(_type);
 
 		bindTexture(_texture);
@@ -620,7 +811,10 @@ namespace Renderer
 		if (boundTexture == _texture)
 			return;
 
+		flushBatch();
+
 		boundTexture = _texture;
+		frameStatistics.stateChanges++;
 
 		if(_texture == 0)
 		{
@@ -639,24 +833,21 @@ namespace Renderer
 
 	void GLES20Renderer::drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
+		flushBatch();
+
+		frameStatistics.drawRequests++;
+		frameStatistics.vertices += _numVertices;
+
 		// Pass buffer data
-		GL_CHECK_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _numVertices, _vertices, GL_DYNAMIC_DRAW));
+		const unsigned int first = uploadVertices(_vertices, _numVertices);
 
 		useProgram(&shaderProgramColorNoTexture);
 
 		// Do rendering
-		if (_srcBlendFactor != Blend::ONE && _dstBlendFactor != Blend::ONE)
-		{
-			GL_CHECK_ERROR(glEnable(GL_BLEND));
-			GL_CHECK_ERROR(glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor)));
-			GL_CHECK_ERROR(glDrawArrays(GL_LINES, 0, _numVertices));
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
-		}
-		else
-		{
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
-			GL_CHECK_ERROR(glDrawArrays(GL_LINES, 0, _numVertices));
-		}
+		setBlendMode(_srcBlendFactor, _dstBlendFactor);
+		GL_CHECK_ERROR(glDrawArrays(GL_LINES, first, _numVertices));
+
+		frameStatistics.drawCalls++;
 
 	} // drawLines
 
@@ -664,62 +855,89 @@ namespace Renderer
 
 	void GLES20Renderer::drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor, bool verticesChanged)
 	{
-		if (verticesChanged)
-			GL_CHECK_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _numVertices, _vertices, GL_DYNAMIC_DRAW));
+		if (_numVertices == 0)
+			return;
+
+		frameStatistics.drawRequests++;
+		frameStatistics.vertices += _numVertices;
 
 		// Setup shader
+		ShaderProgram* shader = &shaderProgramColorNoTexture;
+		float saturation = 1.0f;
+		bool customShader = false;
+
+		auto it = _textures.cend();
+
 		if (boundTexture != 0)
 		{
-			auto it = _textures.find(boundTexture);
+			it = _textures.find(boundTexture);
 			if (it != _textures.cend() && it->second != nullptr && it->second->type == GL_ALPHA)
-				useProgram(&shaderProgramAlpha);
+				shader = &shaderProgramAlpha;
 			else
 			{
-				ShaderProgram* shader = &shaderProgramColorTexture;
+				shader = &shaderProgramColorTexture;
+				saturation = _vertices->saturation;
 
 				if (_vertices->customShader != nullptr)
 				{
-					ShaderProgram* customShader = getShaderProgram(_vertices->customShader);
-					if (customShader != nullptr)
-						shader = customShader;
+					ShaderProgram* program = getShaderProgram(_vertices->customShader);
+					if (program != nullptr)
+					{
+						shader = program;
+						customShader = true;
+					}
 				}
-
-				useProgram(shader);
-
-				// Update Shader Uniforms
-
-				shader->setSaturation(_vertices->saturation);
-				
-				if (shader->supportsTextureSize() && it != _textures.cend() && it->second != nullptr)
-					shader->setTextureSize(it->second->size);
-				
-				if (_numVertices > 0)
-					shader->setOutputSize(_vertices[_numVertices-1].pos);
 			}
 		}
-		else
-			useProgram(&shaderProgramColorNoTexture);
 
-		// Do rendering
-		if (_srcBlendFactor != Blend::ONE && _dstBlendFactor != Blend::ONE)
+		// Custom shaders get the texture & output sizes as uniforms : they are drawn on their own
+		if (batchingEnabled && worldViewIs2D && !customShader)
 		{
-			GL_CHECK_ERROR(glEnable(GL_BLEND));
-			GL_CHECK_ERROR(glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor)));
-			GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices));
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
+			addToBatch(_vertices, _numVertices, shader, saturation, _srcBlendFactor, _dstBlendFactor);
+			return;
 		}
-		else
+
+		flushBatch();
+
+		unsigned int first = lastUploadFirst;
+		if (verticesChanged || lastUploadCount != _numVertices)
+			first = uploadVertices(_vertices, _numVertices);
+
+		useProgram(shader);
+
+		// Update Shader Uniforms
+		if (shader != &shaderProgramColorNoTexture && shader != &shaderProgramAlpha)
 		{
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
-			GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices));
+			shader->setSaturation(saturation);
+
+			if (shader->supportsTextureSize() && it != _textures.cend() && it->second != nullptr)
+				shader->setTextureSize(it->second->size);
+
+			shader->setOutputSize(_vertices[_numVertices - 1].pos);
 		}
+
+		// Do rendering
+		setBlendMode(_srcBlendFactor, _dstBlendFactor);
+		GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, first, _numVertices));
+
+		frameStatistics.drawCalls++;
+
 	} // drawTriangleStrips
 
 //////////////////////////////////////////////////////////////////////////
 
 	void GLES20Renderer::setProjection(const Transform4x4f& _projection)
 	{
+		// Batched vertices are already in world coordinates, the pending ones must be drawn with the previous projection
+		flushBatch();
+
 		projectionMatrix = _projection;
+
+		// Transforming vertices on the CPU drops their z : only valid when the projection ignores it, like orthographic ones do
+		batchingEnabled = 
+			projectionMatrix.r2().x() == 0 && projectionMatrix.r2().y() == 0 &&
+			projectionMatrix.r0().w() == 0 && projectionMatrix.r1().w() == 0 && projectionMatrix.r2().w() == 0;
+
 		mvpMatrix = projectionMatrix * worldViewMatrix;
 	} // setProjection
 
@@ -730,12 +948,16 @@ namespace Renderer
 		worldViewMatrix = _matrix;
 		worldViewMatrix.round();
 		mvpMatrix = projectionMatrix * worldViewMatrix;
+
+		worldViewIs2D = worldViewMatrix.r0().z() == 0 && worldViewMatrix.r1().z() == 0 && worldViewMatrix.r3().z() == 0;
 	} // setMatrix
 
 //////////////////////////////////////////////////////////////////////////
 
 	void GLES20Renderer::setViewport(const Rect& _viewport)
 	{
+		flushBatch();
+
 		// glViewport starts at the bottom left of the window
 		GL_CHECK_ERROR(glViewport( _viewport.x, getWindowHeight() - _viewport.y - _viewport.h, _viewport.w, _viewport.h));
 
@@ -745,6 +967,8 @@ namespace Renderer
 
 	void GLES20Renderer::setScissor(const Rect& _scissor)
 	{
+		flushBatch();
+
 		if((_scissor.x == 0) && (_scissor.y == 0) && (_scissor.w == 0) && (_scissor.h == 0))
 		{
 			GL_CHECK_ERROR(glDisable(GL_SCISSOR_TEST));
@@ -783,6 +1007,11 @@ namespace Renderer
 
 	void GLES20Renderer::swapBuffers()
 	{
+		flushBatch();
+
+		lastFrameStatistics = frameStatistics;
+		frameStatistics = Statistics();
+
 		useProgram(nullptr);
 		SDL_GL_SwapWindow(getSDLWindow());
 		GL_CHECK_ERROR(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
@@ -792,8 +1021,13 @@ namespace Renderer
 	
 	void GLES20Renderer::drawTriangleFan(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{		
+		flushBatch();
+
+		frameStatistics.drawRequests++;
+		frameStatistics.vertices += _numVertices;
+
 		// Pass buffer data
-		GL_CHECK_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _numVertices, _vertices, GL_DYNAMIC_DRAW));
+		const unsigned int first = uploadVertices(_vertices, _numVertices);
 
 		// Setup shader
 		if (boundTexture != 0)
@@ -811,22 +1045,16 @@ namespace Renderer
 			useProgram(&shaderProgramColorNoTexture);
 
 		// Do rendering
-		if (_srcBlendFactor != Blend::ONE && _dstBlendFactor != Blend::ONE)
-		{
-			GL_CHECK_ERROR(glEnable(GL_BLEND));
-			GL_CHECK_ERROR(glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor)));
-			GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_FAN, 0, _numVertices));
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
-		}
-		else
-		{
-			GL_CHECK_ERROR(glDisable(GL_BLEND));
-			GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_FAN, 0, _numVertices));			
-		}
+		setBlendMode(_srcBlendFactor, _dstBlendFactor);
+		GL_CHECK_ERROR(glDrawArrays(GL_TRIANGLE_FAN, first, _numVertices));
+
+		frameStatistics.drawCalls++;
 	}
 
 	void GLES20Renderer::setStencil(const Vertex* _vertices, const unsigned int _numVertices)
 	{
+		flushBatch();
+
 		useProgram(&shaderProgramColorNoTexture);
 
 		glEnable(GL_STENCIL_TEST);
@@ -840,11 +1068,12 @@ namespace Renderer
 		glStencilFunc(GL_ALWAYS, 1, ~0);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(Blend::SRC_ALPHA), convertBlendFactor(Blend::ONE_MINUS_SRC_ALPHA));
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _numVertices, _vertices, GL_DYNAMIC_DRAW);
-		glDrawArrays(GL_TRIANGLE_FAN, 0, _numVertices);
-		glDisable(GL_BLEND);
+		setBlendMode(Blend::SRC_ALPHA, Blend::ONE_MINUS_SRC_ALPHA);
+
+		const unsigned int first = uploadVertices(_vertices, _numVertices);
+		glDrawArrays(GL_TRIANGLE_FAN, first, _numVertices);
+
+		frameStatistics.drawCalls++;
 
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 		glDepthMask(GL_TRUE);
@@ -855,9 +1084,15 @@ namespace Renderer
 
 	void GLES20Renderer::disableStencil()
 	{
+		flushBatch();
 		glDisable(GL_STENCIL_TEST);
 	}
 
+	Statistics GLES20Renderer::getStatistics()
+	{
+		return lastFrameStatistics;
+	}
+
 	size_t GLES20Renderer::getTotalMemUsage()
 	{
 		size_t total = 0;
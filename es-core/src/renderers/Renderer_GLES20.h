@@ -45,6 +45,7 @@ namespace Renderer
 		void         swapBuffers() override;
 
 		size_t		getTotalMemUsage() override;
+		Statistics	getStatistics() override;
 	};
 }
 
@@ -0,0 +1,532 @@
+#include "renderers/Renderer_Headless.h"
+
+#include "math/Misc.h"
+#include "utils/FileSystemUtil.h"
+#include "Log.h"
+#include "Settings.h"
+
+#include <FreeImage.h>
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace Renderer
+{
+	HeadlessRenderer::HeadlessRenderer() :
+		mRasterize(false), mFrameNumber(0), mWidth(0), mHeight(0), mStencilEnabled(false),
+		mNextTextureId(1), mBoundTexture(0)
+	{
+		mProjectionMatrix = Transform4x4f::Identity();
+		mWorldViewMatrix = Transform4x4f::Identity();
+		mMvpMatrix = Transform4x4f::Identity();
+	}
+
+	HeadlessRenderer::~HeadlessRenderer()
+	{
+		deleteTextures();
+	}
+
+	std::string HeadlessRenderer::getDriverName()
+	{
+		return "HEADLESS";
+	}
+
+	std::vector<std::pair<std::string, std::string>> HeadlessRenderer::getDriverInformation()
+	{
+		std::vector<std::pair<std::string, std::string>> info;
+		info.push_back(std::pair<std::string, std::string>("GRAPHICS API", getDriverName()));
+		info.push_back(std::pair<std::string, std::string>("RASTERIZER", mRasterize ? "SOFTWARE" : "NONE"));
+		return info;
+	}
+
+	unsigned int HeadlessRenderer::getWindowFlags()
+	{
+		return SDL_WINDOW_HIDDEN;
+	}
+
+	void HeadlessRenderer::setupWindow()
+	{
+
+	}
+
+	void HeadlessRenderer::createContext()
+	{
+		mWidth = getWindowWidth();
+		mHeight = getWindowHeight();
+
+		mDumpPath = Settings::getInstance()->getString("HeadlessFrameDump");
+		mRasterize = !mDumpPath.empty();
+
+		if (mRasterize)
+		{
+			if (!Utils::FileSystem::isDirectory(mDumpPath))
+				Utils::FileSystem::createDirectory(mDumpPath);
+
+			mFrameBuffer.assign((size_t)mWidth * mHeight, 0xFF000000);
+			mStencilBuffer.assign((size_t)mWidth * mHeight, 0);
+		}
+
+		mViewport = Rect(0, 0, mWidth, mHeight);
+		mScissor = Rect(0, 0, 0, 0);
+
+		LOG(LogInfo) << "Headless renderer : " << mWidth << "x" << mHeight << (mRasterize ? ", frames dumped to " + mDumpPath : "");
+	}
+
+	void HeadlessRenderer::destroyContext()
+	{
+		resetCache();
+		deleteTextures();
+
+		mFrameBuffer.clear();
+		mStencilBuffer.clear();
+	}
+
+	void HeadlessRenderer::deleteTextures()
+	{
+		// Texture ids don't survive the context, as with the GL renderers
+		for (auto& texture : mTextures)
+			delete texture.second;
+
+		mTextures.clear();
+		mBoundTexture = 0;
+	}
+
+	void HeadlessRenderer::resetCache()
+	{
+		bindTexture(0);
+	}
+
+	unsigned int HeadlessRenderer::createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data)
+	{
+		TextureInfo* info = new TextureInfo();
+		info->width = _width;
+		info->height = _height;
+		info->repeat = _repeat;
+
+		unsigned int texture = mNextTextureId++;
+		mTextures[texture] = info;
+
+		if (_data != nullptr)
+			updateTexture(texture, _type, 0, 0, _width, _height, _data);
+
+		return texture;
+	}
+
+	void HeadlessRenderer::destroyTexture(const unsigned int _texture)
+	{
+		auto it = mTextures.find(_texture);
+		if (it == mTextures.cend())
+			return;
+
+		delete it->second;
+		mTextures.erase(it);
+
+		if (mBoundTexture == _texture)
+			mBoundTexture = 0;
+	}
+
+	void HeadlessRenderer::updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
+	{
+		mFrameStatistics.textureUploads++;
+
+		// Pixels are only needed to render dumped frames
+		auto it = mTextures.find(_texture);
+		if (!mRasterize || _data == nullptr || it == mTextures.cend() || _x >= it->second->width)
+			return;
+
+		TextureInfo* info = it->second;
+		const unsigned int count = std::min(_width, info->width - _x);
+		if (info->pixels.empty())
+			info->pixels.assign((size_t)info->width * info->height, 0);
+
+		for (unsigned int y = 0; y < _height && _y + y < info->height; y++)
+		{
+			unsigned int* dst = &info->pixels[(size_t)(_y + y) * info->width + _x];
+
+			if (_type == Texture::ALPHA)
+			{
+				// Alpha textures are white + alpha, as in the GL renderers
+				const unsigned char* src = (const unsigned char*)_data + (size_t)y * _width;
+				for (unsigned int x = 0; x < count; x++)
+					dst[x] = 0x00FFFFFF | ((unsigned int)src[x] << 24);
+			}
+			else
+				memcpy(dst, (const unsigned int*)_data + (size_t)y * _width, count * sizeof(unsigned int));
+		}
+	}
+
+	void HeadlessRenderer::bindTexture(const unsigned int _texture)
+	{
+		if (mBoundTexture == _texture)
+			return;
+
+		mBoundTexture = _texture;
+		mFrameStatistics.stateChanges++;
+	}
+
+	void HeadlessRenderer::countDraw(const unsigned int _numVertices)
+	{
+		mFrameStatistics.drawRequests++;
+		mFrameStatistics.drawCalls++;
+		mFrameStatistics.vertices += _numVertices;
+	}
+
+	void HeadlessRenderer::drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		countDraw(_numVertices);
+
+		if (!mRasterize)
+			return;
+
+		for (unsigned int i = 0; i + 1 < _numVertices; i += 2)
+			rasterizeLine(toScreen(_vertices[i]), toScreen(_vertices[i + 1]), _srcBlendFactor, _dstBlendFactor);
+	}
+
+	void HeadlessRenderer::drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor, bool verticesChanged)
+	{
+		countDraw(_numVertices);
+
+		if (!mRasterize || _numVertices < 3)
+			return;
+
+		std::vector<ScreenVertex> screen;
+		screen.reserve(_numVertices);
+		for (unsigned int i = 0; i < _numVertices; i++)
+			screen.push_back(toScreen(_vertices[i]));
+
+		for (unsigned int i = 0; i + 2 < _numVertices; i++)
+			rasterizeTriangle(screen[i], screen[i + 1], screen[i + 2], _srcBlendFactor, _dstBlendFactor, _vertices->saturation, DRAW_COLOR);
+	}
+
+	void HeadlessRenderer::drawTriangleFan(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		countDraw(_numVertices);
+
+		if (!mRasterize || _numVertices < 3)
+			return;
+
+		ScreenVertex center = toScreen(_vertices[0]);
+		ScreenVertex previous = toScreen(_vertices[1]);
+
+		for (unsigned int i = 2; i < _numVertices; i++)
+		{
+			ScreenVertex current = toScreen(_vertices[i]);
+			rasterizeTriangle(center, previous, current, _srcBlendFactor, _dstBlendFactor, _vertices->saturation, DRAW_COLOR);
+			previous = current;
+		}
+	}
+
+	void HeadlessRenderer::setProjection(const Transform4x4f& _projection)
+	{
+		mProjectionMatrix = _projection;
+		mMvpMatrix = mProjectionMatrix * mWorldViewMatrix;
+	}
+
+	void HeadlessRenderer::setMatrix(const Transform4x4f& _matrix)
+	{
+		mWorldViewMatrix = _matrix;
+		mWorldViewMatrix.round();
+		mMvpMatrix = mProjectionMatrix * mWorldViewMatrix;
+	}
+
+	void HeadlessRenderer::setViewport(const Rect& _viewport)
+	{
+		mViewport = _viewport;
+	}
+
+	void HeadlessRenderer::setScissor(const Rect& _scissor)
+	{
+		mScissor = _scissor;
+		mFrameStatistics.stateChanges++;
+	}
+
+	void HeadlessRenderer::setStencil(const Vertex* _vertices, const unsigned int _numVertices)
+	{
+		mFrameStatistics.drawCalls++;
+		mStencilEnabled = true;
+
+		if (!mRasterize || _numVertices < 3)
+			return;
+
+		std::fill(mStencilBuffer.begin(), mStencilBuffer.end(), 0);
+
+		ScreenVertex center = toScreen(_vertices[0]);
+		ScreenVertex previous = toScreen(_vertices[1]);
+
+		for (unsigned int i = 2; i < _numVertices; i++)
+		{
+			ScreenVertex current = toScreen(_vertices[i]);
+			rasterizeTriangle(center, previous, current, Blend::SRC_ALPHA, Blend::ONE_MINUS_SRC_ALPHA, 1.0f, DRAW_STENCIL);
+			previous = current;
+		}
+	}
+
+	void HeadlessRenderer::disableStencil()
+	{
+		mStencilEnabled = false;
+	}
+
+	void HeadlessRenderer::setSwapInterval()
+	{
+
+	}
+
+	void HeadlessRenderer::swapBuffers()
+	{
+		mLastFrameStatistics = mFrameStatistics;
+		mFrameStatistics = Statistics();
+
+		if (!mRasterize)
+			return;
+
+		dumpFrame();
+		std::fill(mFrameBuffer.begin(), mFrameBuffer.end(), 0xFF000000);
+	}
+
+	size_t HeadlessRenderer::getTotalMemUsage()
+	{
+		size_t total = 0;
+
+		for (auto tex : mTextures)
+			total += (size_t)tex.second->width * tex.second->height * 4;
+
+		return total;
+	}
+
+	Statistics HeadlessRenderer::getStatistics()
+	{
+		return mLastFrameStatistics;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Software rasterizer
+
+	HeadlessRenderer::ScreenVertex HeadlessRenderer::toScreen(const Vertex& _vertex)
+	{
+		// Same transforms as the vertex shaders, then normalized device coordinates to window pixels (top-left origin)
+		Vector3f clip = mMvpMatrix * Vector3f(_vertex.pos.x(), _vertex.pos.y(), 0);
+
+		ScreenVertex ret;
+		ret.x = mViewport.x + (clip.x() + 1.0f) * 0.5f * mViewport.w;
+		ret.y = mViewport.y + (1.0f - clip.y()) * 0.5f * mViewport.h;
+		ret.u = _vertex.tex.x();
+		ret.v = _vertex.tex.y();
+
+		// Vertex colors are stored as RGBA bytes
+		for (int i = 0; i < 4; i++)
+			ret.color[i] = ((_vertex.col >> (i * 8)) & 0xFF) / 255.0f;
+
+		return ret;
+	}
+
+	void HeadlessRenderer::sampleTexture(float _u, float _v, float* _color)
+	{
+		auto it = mTextures.find(mBoundTexture);
+		if (it == mTextures.cend() || it->second->pixels.empty())
+		{
+			_color[0] = _color[1] = _color[2] = _color[3] = 1.0f;
+			return;
+		}
+
+		// Nearest sampling is enough for reference frames
+		TextureInfo* info = it->second;
+
+		int x = (int)(_u * info->width);
+		int y = (int)(_v * info->height);
+
+		if (info->repeat)
+		{
+			x = ((x % (int)info->width) + info->width) % info->width;
+			y = ((y % (int)info->height) + info->height) % info->height;
+		}
+		else
+		{
+			x = std::max(0, std::min(x, (int)info->width - 1));
+			y = std::max(0, std::min(y, (int)info->height - 1));
+		}
+
+		unsigned int texel = info->pixels[(size_t)y * info->width + x];
+		for (int i = 0; i < 4; i++)
+			_color[i] = ((texel >> (i * 8)) & 0xFF) / 255.0f;
+	}
+
+	static float getBlendFactor(const Blend::Factor _factor, const float* _src, const float* _dst, int _channel)
+	{
+		switch (_factor)
+		{
+		case Blend::ZERO:                return 0.0f;
+		case Blend::ONE:                 return 1.0f;
+		case Blend::SRC_COLOR:           return _src[_channel];
+		case Blend::ONE_MINUS_SRC_COLOR: return 1.0f - _src[_channel];
+		case Blend::SRC_ALPHA:           return _src[3];
+		case Blend::ONE_MINUS_SRC_ALPHA: return 1.0f - _src[3];
+		case Blend::DST_COLOR:           return _dst[_channel];
+		case Blend::ONE_MINUS_DST_COLOR: return 1.0f - _dst[_channel];
+		case Blend::DST_ALPHA:           return _dst[3];
+		case Blend::ONE_MINUS_DST_ALPHA: return 1.0f - _dst[3];
+		}
+
+		return 1.0f;
+	}
+
+	void HeadlessRenderer::writePixel(int _x, int _y, const float* _color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		unsigned int& pixel = mFrameBuffer[(size_t)_y * mWidth + _x];
+
+		float result[4];
+
+		// Same rule as the GL renderers : blending is disabled when one of the factors is ONE
+		if (_srcBlendFactor != Blend::ONE && _dstBlendFactor != Blend::ONE)
+		{
+			float dst[4];
+			for (int i = 0; i < 4; i++)
+				dst[i] = ((pixel >> (i * 8)) & 0xFF) / 255.0f;
+
+			for (int i = 0; i < 4; i++)
+				result[i] = _color[i] * getBlendFactor(_srcBlendFactor, _color, dst, i) + dst[i] * getBlendFactor(_dstBlendFactor, _color, dst, i);
+		}
+		else
+			memcpy(result, _color, sizeof(result));
+
+		unsigned int value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (unsigned int)(Math::clamp(result[i], 0.0f, 1.0f) * 255.0f + 0.5f) << (i * 8);
+
+		pixel = value;
+	}
+
+	void HeadlessRenderer::rasterizeTriangle(const ScreenVertex& _v0, const ScreenVertex& _v1, const ScreenVertex& _v2, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor, float _saturation, DrawMode _mode)
+	{
+		const float area = (_v1.x - _v0.x) * (_v2.y - _v0.y) - (_v1.y - _v0.y) * (_v2.x - _v0.x);
+		if (area == 0)
+			return;
+
+		int minX = (int)std::floor(std::min(_v0.x, std::min(_v1.x, _v2.x)));
+		int minY = (int)std::floor(std::min(_v0.y, std::min(_v1.y, _v2.y)));
+		int maxX = (int)std::ceil(std::max(_v0.x, std::max(_v1.x, _v2.x)));
+		int maxY = (int)std::ceil(std::max(_v0.y, std::max(_v1.y, _v2.y)));
+
+		// Clip to the framebuffer, then to the scissor box (an empty box disables the scissor test)
+		minX = std::max(minX, 0);
+		minY = std::max(minY, 0);
+		maxX = std::min(maxX, mWidth - 1);
+		maxY = std::min(maxY, mHeight - 1);
+
+		if (mScissor.w != 0 || mScissor.h != 0)
+		{
+			minX = std::max(minX, mScissor.x);
+			minY = std::max(minY, mScissor.y);
+			maxX = std::min(maxX, mScissor.x + mScissor.w - 1);
+			maxY = std::min(maxY, mScissor.y + mScissor.h - 1);
+		}
+
+		const bool textured = _mode == DRAW_COLOR && mBoundTexture != 0;
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			const float py = y + 0.5f;
+
+			for (int x = minX; x <= maxX; x++)
+			{
+				const float px = x + 0.5f;
+
+				float w0 = ((_v1.x - px) * (_v2.y - py) - (_v1.y - py) * (_v2.x - px)) / area;
+				float w1 = ((_v2.x - px) * (_v0.y - py) - (_v2.y - py) * (_v0.x - px)) / area;
+				float w2 = 1.0f - w0 - w1;
+
+				if (w0 < 0 || w1 < 0 || w2 < 0)
+					continue;
+
+				const size_t index = (size_t)y * mWidth + x;
+
+				if (_mode == DRAW_STENCIL)
+				{
+					mStencilBuffer[index] = 1;
+					continue;
+				}
+
+				if (mStencilEnabled && mStencilBuffer[index] == 0)
+					continue;
+
+				float color[4];
+				for (int i = 0; i < 4; i++)
+					color[i] = _v0.color[i] * w0 + _v1.color[i] * w1 + _v2.color[i] * w2;
+
+				if (textured)
+				{
+					float texel[4];
+					sampleTexture(_v0.u * w0 + _v1.u * w1 + _v2.u * w2, _v0.v * w0 + _v1.v * w1 + _v2.v * w2, texel);
+
+					if (_saturation != 1.0f)
+					{
+						float gray = texel[0] * 0.3086f + texel[1] * 0.6094f + texel[2] * 0.0820f;
+						for (int i = 0; i < 3; i++)
+							texel[i] = gray + (texel[i] - gray) * _saturation;
+					}
+
+					for (int i = 0; i < 4; i++)
+						color[i] *= texel[i];
+				}
+
+				writePixel(x, y, color, _srcBlendFactor, _dstBlendFactor);
+			}
+		}
+	}
+
+	void HeadlessRenderer::rasterizeLine(const ScreenVertex& _v0, const ScreenVertex& _v1, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		const float dx = _v1.x - _v0.x;
+		const float dy = _v1.y - _v0.y;
+		const int steps = std::max(1, (int)std::ceil(std::max(std::abs(dx), std::abs(dy))));
+
+		for (int i = 0; i <= steps; i++)
+		{
+			int x = (int)(_v0.x + dx * i / steps);
+			int y = (int)(_v0.y + dy * i / steps);
+
+			if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+				continue;
+
+			if ((mScissor.w != 0 || mScissor.h != 0) && !mScissor.contains(x, y))
+				continue;
+
+			if (mStencilEnabled && mStencilBuffer[(size_t)y * mWidth + x] == 0)
+				continue;
+
+			writePixel(x, y, _v0.color, _srcBlendFactor, _dstBlendFactor);
+		}
+	}
+
+	void HeadlessRenderer::dumpFrame()
+	{
+		FIBITMAP* bitmap = FreeImage_Allocate(mWidth, mHeight, 32);
+		if (bitmap == nullptr)
+			return;
+
+		// FreeImage scanlines are bottom-up, and pixels are BGRA on little endian machines
+		for (int y = 0; y < mHeight; y++)
+		{
+			BYTE* line = FreeImage_GetScanLine(bitmap, mHeight - 1 - y);
+			const unsigned int* src = &mFrameBuffer[(size_t)y * mWidth];
+
+			for (int x = 0; x < mWidth; x++)
+			{
+				line[x * 4 + FI_RGBA_RED] = src[x] & 0xFF;
+				line[x * 4 + FI_RGBA_GREEN] = (src[x] >> 8) & 0xFF;
+				line[x * 4 + FI_RGBA_BLUE] = (src[x] >> 16) & 0xFF;
+				line[x * 4 + FI_RGBA_ALPHA] = 0xFF;
+			}
+		}
+
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "/frame%05u.png", mFrameNumber++);
+
+		std::string path = mDumpPath + fileName;
+		if (!FreeImage_Save(FIF_PNG, bitmap, path.c_str()))
+			LOG(LogError) << "Headless renderer : unable to save " << path;
+
+		FreeImage_Unload(bitmap);
+	}
+
+} // Renderer::
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef ES_CORE_RENDERER_HEADLESS_H
+#define ES_CORE_RENDERER_HEADLESS_H
+
+#define RENDERER_HEADLESS
+
+#include "Renderer.h"
+#include "math/Transform4x4f.h"
+
+#include <map>
+
+namespace Renderer
+{
+	// Renderer without GPU, for benchmarks on machines without display.
+	// Draws are only counted, unless frames are dumped to PNG : a software rasterizer then renders them.
+	class HeadlessRenderer : public IRenderer
+	{
+	public:
+		HeadlessRenderer();
+		~HeadlessRenderer();
+
+		std::string getDriverName() override;
+		std::vector<std::pair<std::string, std::string>> getDriverInformation() override;
+
+		unsigned int getWindowFlags() override;
+		void         setupWindow() override;
+
+		void         createContext() override;
+		void         destroyContext() override;
+
+		void		 resetCache() override;
+
+		unsigned int createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data) override;
+		void         destroyTexture(const unsigned int _texture) override;
+		void         updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data) override;
+		void         bindTexture(const unsigned int _texture) override;
+
+		void         drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA) override;
+		void         drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA, bool verticesChanged = true) override;
+		void		 drawTriangleFan(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA) override;
+
+		void         setProjection(const Transform4x4f& _projection) override;
+		void         setMatrix(const Transform4x4f& _matrix) override;
+		void         setViewport(const Rect& _viewport) override;
+		void         setScissor(const Rect& _scissor) override;
+
+		void         setStencil(const Vertex* _vertices, const unsigned int _numVertices) override;
+		void		 disableStencil() override;
+
+		void         setSwapInterval() override;
+		void         swapBuffers() override;
+
+		size_t		 getTotalMemUsage() override;
+		Statistics	 getStatistics() override;
+
+		bool		 isHeadless() override { return true; }
+
+	private:
+		struct TextureInfo
+		{
+			unsigned int width;
+			unsigned int height;
+			bool repeat;
+			std::vector<unsigned int> pixels;
+		};
+
+		struct ScreenVertex
+		{
+			float x;
+			float y;
+			float u;
+			float v;
+			float color[4];
+		};
+
+		enum DrawMode
+		{
+			DRAW_COLOR,
+			DRAW_STENCIL
+		};
+
+		void		 countDraw(const unsigned int _numVertices);
+		void		 deleteTextures();
+
+		ScreenVertex toScreen(const Vertex& _vertex);
+		void		 rasterizeTriangle(const ScreenVertex& _v0, const ScreenVertex& _v1, const ScreenVertex& _v2, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor, float _saturation, DrawMode _mode);
+		void		 rasterizeLine(const ScreenVertex& _v0, const ScreenVertex& _v1, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor);
+		void		 writePixel(int _x, int _y, const float* _color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor);
+		void		 sampleTexture(float _u, float _v, float* _color);
+
+		void		 dumpFrame();
+
+		bool		 mRasterize;
+		std::string	 mDumpPath;
+		unsigned int mFrameNumber;
+
+		int			 mWidth;
+		int			 mHeight;
+		std::vector<unsigned int>	mFrameBuffer;
+		std::vector<unsigned char>	mStencilBuffer;
+		bool		 mStencilEnabled;
+
+		Transform4x4f mProjectionMatrix;
+		Transform4x4f mWorldViewMatrix;
+		Transform4x4f mMvpMatrix;
+
+		Rect		 mViewport;
+		Rect		 mScissor;
+
+		std::map<unsigned int, TextureInfo*> mTextures;
+		unsigned int mNextTextureId;
+		unsigned int mBoundTexture;
+
+		Statistics	 mFrameStatistics;
+		Statistics	 mLastFrameStatistics;
+	};
+}
+
+#endif // ES_CORE_RENDERER_HEADLESS_H
@@ -3,6 +3,7 @@
 #include "renderers/Renderer.h"
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
+#include "utils/md5.h"
 #include "Log.h"
 #include "math/Misc.h"
 #include "LocaleES.h"
@@ -11,7 +12,9 @@
 #include "TextureResource.h"
 #include "Settings.h"
 #include "ImageIO.h"
+#include "Paths.h"
 #include <algorithm>
+#include <fstream>
 #include "math/Transform4x4f.h"
 
 #ifdef WIN32
@@ -25,6 +28,10 @@ int Font::getSize() const { return mSize; }
 std::map< std::pair<std::string, int>, std::weak_ptr<Font> > Font::sFontMap;
 static std::map<unsigned int, std::string> substituableChars;
 
+#define GLYPH_CACHE_MAGIC		"ESGC"
+#define GLYPH_CACHE_VERSION		1
+#define GLYPH_CACHE_MAX_SIZE	(64 * 1024 * 1024)
+
 Font::FontFace::FontFace(ResourceData&& d, int size) : data(d)
 {
 	int err = FT_New_Memory_Face(sLibrary, data.ptr.get(), (FT_Long)data.length, 0, &face);
@@ -103,6 +110,7 @@ Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
 
 	mLoaded = true;
 	mMaxGlyphHeight = 0;
+	mSavedGlyphCount = 0;
 
 	if(!sLibrary)
 		initLibrary();
@@ -110,6 +118,8 @@ Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
 	for (unsigned int i = 0; i < 255; i++)
 		mGlyphCacheArray[i] = NULL;
 
+	loadGlyphCache();
+
 	// always initialize ASCII characters
 	for(unsigned int i = 32; i < 128; i++)
 		getGlyph(i);
@@ -144,6 +154,8 @@ bool Font::unload()
 {
 	if (mLoaded)
 	{		
+		saveGlyphCache();
+
 		for (auto tex : mTextures)
 			tex->deinitTexture();
 
@@ -219,12 +231,27 @@ void Font::FontTexture::initTexture()
 {
 	if (textureId == 0)
 	{
-		textureId = Renderer::createTexture(Renderer::Texture::ALPHA, true, false, textureSize.x(), textureSize.y(), nullptr);
+		textureId = Renderer::createTexture(Renderer::Texture::ALPHA, true, false, textureSize.x(), textureSize.y(), pixels.empty() ? nullptr : pixels.data());
 		if (textureId == 0)
 			LOG(LogError) << "FontTexture::initTexture() failed to create texture " << textureSize.x() << "x" << textureSize.y();
 	}
 }
 
+void Font::FontTexture::writeGlyph(const Vector2i& cursor, const Vector2i& size, const unsigned char* bitmap)
+{
+	if (size.x() <= 0 || size.y() <= 0)
+		return;
+
+	if (pixels.empty())
+		pixels.resize(textureSize.x() * textureSize.y(), 0);
+
+	for (int y = 0; y < size.y(); y++)
+		memcpy(&pixels[(cursor.y() + y) * textureSize.x() + cursor.x()], bitmap + y * size.x(), size.x());
+
+	if (textureId != 0)
+		Renderer::updateTexture(textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), size.x(), size.y(), (void*)bitmap);
+}
+
 void Font::FontTexture::deinitTexture()
 {
 	if(textureId != 0)
@@ -292,9 +319,15 @@ std::vector<std::string> getFallbackFontPaths()
 	return paths;
 }
 
-FT_Face Font::getFaceForChar(unsigned int id)
+static const std::vector<std::string>& getFallbackFonts()
 {
 	static const std::vector<std::string> fallbackFonts = getFallbackFontPaths();
+	return fallbackFonts;
+}
+
+FT_Face Font::getFaceForChar(unsigned int id)
+{
+	const std::vector<std::string>& fallbackFonts = getFallbackFonts();
 
 	// look through our current font + fallback fonts to see if any have the glyph we're looking for
 	for(unsigned int i = 0; i < fallbackFonts.size() + 1; i++)
@@ -342,6 +375,10 @@ Font::Glyph* Font::getGlyph(unsigned int id)
 			return it->second;
 	}
 
+	// Deferred reload : the glyph textures must exist before adding a new glyph
+	if (!mLoaded)
+		reload();
+
 	// nope, need to make a glyph
 	FT_Face face = getFaceForChar(id);
 	if(!face)
@@ -382,13 +419,15 @@ Font::Glyph* Font::getGlyph(unsigned int id)
 	pGlyph->cursor = cursor;
 	pGlyph->glyphSize = glyphSize;
 
-	// upload glyph bitmap to texture
-	if (glyphSize.x() > 0 && glyphSize.y() > 0)
-		Renderer::updateTexture(tex->textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), g->bitmap.buffer);
+	// copy glyph bitmap to the atlas & upload it to texture
+	tex->writeGlyph(cursor, glyphSize, g->bitmap.buffer);
 
 	// update max glyph height
 	if(glyphSize.y() > mMaxGlyphHeight)
+	{
 		mMaxGlyphHeight = glyphSize.y();
+		clearLayoutCaches();
+	}
 
 	mGlyphMap[id] = pGlyph;
 
@@ -399,30 +438,242 @@ Font::Glyph* Font::getGlyph(unsigned int id)
 	return pGlyph;
 }
 
-// completely recreate the texture data for all textures based on mGlyphs information
+// completely recreate the textures from the atlases kept in memory : glyphs are not rendered again by FreeType
 void Font::rebuildTextures()
 {
-	// recreate OpenGL textures
 	for(auto tex : mTextures)
 		tex->initTexture();
+}
+
+static std::string getFontFileStamp(const std::string& path)
+{
+	// Builtin fonts may be served from a pack : the length is the only thing to compare then
+	std::string file = ResourceManager::getInstance()->getResourcePath(path);
+
+	time_t modTime = 0;
+	if (file.size() < 2 || file[0] != ':' || file[1] != '/')
+		modTime = Utils::FileSystem::getFileModificationDate(file).getTime();
+
+	return path + "|" + std::to_string((long long)modTime) + "-" + std::to_string(Utils::FileSystem::getFileSize(file));
+}
+
+std::string Font::getGlyphCachePath()
+{
+	std::string key = getFontFileStamp(mPath) + "|" + std::to_string(mSize);
+
+	// Glyphs missing from the font are rendered from the fallback fonts
+	for (auto& fallback : getFallbackFonts())
+		key += "|" + getFontFileStamp(fallback);
+
+	return getGlyphCacheFolder() + "/" + md5(key) + ".glyphs";
+}
+
+std::string Font::getGlyphCacheFolder()
+{
+	return Utils::FileSystem::getGenericPath(Paths::getUserEmulationStationPath() + "/cache/fonts");
+}
+
+void Font::purgeGlyphCache()
+{
+	// Fonts of previous themes, or saved at other sizes, leave their atlases behind
+	std::string folder = getGlyphCacheFolder();
+	if (!Utils::FileSystem::isDirectory(folder))
+		return;
 
-	// reupload the texture data
-	for(auto it = mGlyphMap.cbegin(); it != mGlyphMap.cend(); it++)
+	int removed = Utils::FileSystem::removeOldestFiles(folder, GLYPH_CACHE_MAX_SIZE);
+	if (removed > 0)
+		LOG(LogInfo) << "Font : " << removed << " glyph caches removed";
+}
+
+void Font::loadGlyphCache()
+{
+	std::string fileName = getGlyphCachePath();
+	if (!Utils::FileSystem::exists(fileName))
+		return;
+
+#if defined(_WIN32)
+	std::ifstream stream(Utils::String::convertToWideString(fileName), std::ios::binary);
+#else
+	std::ifstream stream(fileName, std::ios::binary);
+#endif
+
+	char magic[4];
+	int version = 0;
+	int maxGlyphHeight = 0;
+	unsigned int textureCount = 0;
+
+	if (!stream.read(magic, 4) || memcmp(magic, GLYPH_CACHE_MAGIC, 4) != 0 ||
+		!stream.read((char*)&version, sizeof(version)) || version != GLYPH_CACHE_VERSION ||
+		!stream.read((char*)&maxGlyphHeight, sizeof(maxGlyphHeight)) ||
+		!stream.read((char*)&textureCount, sizeof(textureCount)) || textureCount > 64)
+		return;
+
+	std::vector<FontTexture*> textures;
+	std::vector<Glyph*> glyphs;
+	std::vector<unsigned int> ids;
+
+	bool ok = true;
+
+	for (unsigned int i = 0; ok && i < textureCount; i++)
 	{
-		FT_Face face = getFaceForChar(it->first);
-		FT_GlyphSlot glyphSlot = face->glyph;
+		int data[6];
+		if (!stream.read((char*)data, sizeof(data)) || data[0] <= 0 || data[1] <= 0 || data[0] > 2048 || data[1] > 2048)
+		{
+			ok = false;
+			break;
+		}
 
-		// load the glyph bitmap through FT
-		FT_Load_Char(face, it->first, FT_LOAD_RENDER);
+		FontTexture* tex = new FontTexture();
+		tex->textureSize = Vector2i(data[0], data[1]);
+		tex->writePos = Vector2i(data[2], data[3]);
+		tex->rowHeight = data[4];
+		textures.push_back(tex);
 
-		Glyph* glyph = it->second;
-		
-		// upload to texture
-		Renderer::updateTexture(glyph->texture->textureId, Renderer::Texture::ALPHA,
-			glyph->cursor.x(), glyph->cursor.y(),
-			glyph->glyphSize.x(), glyph->glyphSize.y(),
-			glyphSlot->bitmap.buffer);
+		if (data[5] != 0)
+		{
+			tex->pixels.resize(data[0] * data[1]);
+			ok = (bool)stream.read((char*)tex->pixels.data(), tex->pixels.size());
+		}
+	}
+
+	unsigned int glyphCount = 0;
+	if (ok)
+		ok = stream.read((char*)&glyphCount, sizeof(glyphCount)) && glyphCount < 0x10000;
+
+	for (unsigned int i = 0; ok && i < glyphCount; i++)
+	{
+		unsigned int id = 0;
+		unsigned int texture = 0;
+		int size[4];
+		float metrics[4];
+
+		if (!stream.read((char*)&id, sizeof(id)) || !stream.read((char*)&texture, sizeof(texture)) ||
+			!stream.read((char*)size, sizeof(size)) || !stream.read((char*)metrics, sizeof(metrics)) || texture >= textures.size())
+		{
+			ok = false;
+			break;
+		}
+
+		FontTexture* tex = textures[texture];
+
+		Glyph* pGlyph = new Glyph();
+		pGlyph->texture = tex;
+		pGlyph->cursor = Vector2i(size[0], size[1]);
+		pGlyph->glyphSize = Vector2i(size[2], size[3]);
+		pGlyph->texPos = Vector2f((float)size[0] / (float)tex->textureSize.x(), (float)size[1] / (float)tex->textureSize.y());
+		pGlyph->texSize = Vector2f((float)size[2] / (float)tex->textureSize.x(), (float)size[3] / (float)tex->textureSize.y());
+		pGlyph->advance = Vector2f(metrics[0], metrics[1]);
+		pGlyph->bearing = Vector2f(metrics[2], metrics[3]);
+
+		glyphs.push_back(pGlyph);
+		ids.push_back(id);
+	}
+
+	if (!ok)
+	{
+		LOG(LogWarning) << "Font glyph cache " << fileName << " is invalid, ignored";
+
+		for (auto glyph : glyphs)
+			delete glyph;
+
+		for (auto tex : textures)
+			delete tex;
+
+		return;
 	}
+
+	for (auto tex : textures)
+	{
+		tex->initTexture();
+		mTextures.push_back(tex);
+	}
+
+	for (size_t i = 0; i < glyphs.size(); i++)
+	{
+		mGlyphMap[ids[i]] = glyphs[i];
+		if (ids[i] < 255)
+			mGlyphCacheArray[ids[i]] = glyphs[i];
+	}
+
+	mMaxGlyphHeight = maxGlyphHeight;
+	mSavedGlyphCount = mGlyphMap.size();
+}
+
+void Font::saveGlyphCache()
+{
+	// Nothing new since the cache was loaded or last saved
+	if (mGlyphMap.size() <= mSavedGlyphCount)
+		return;
+
+	std::string fileName = getGlyphCachePath();
+
+	std::string folder = Utils::FileSystem::getParent(fileName);
+	if (!Utils::FileSystem::isDirectory(folder))
+		Utils::FileSystem::createDirectory(folder);
+
+	// Written to a temporary file first : the same font may be saved by another instance
+	std::string tmpFile = fileName + ".tmp" + std::to_string((size_t)this);
+
+	{
+#if defined(_WIN32)
+		std::ofstream stream(Utils::String::convertToWideString(tmpFile), std::ios::binary);
+#else
+		std::ofstream stream(tmpFile, std::ios::binary);
+#endif
+		if (!stream.is_open())
+			return;
+
+		int version = GLYPH_CACHE_VERSION;
+		unsigned int textureCount = (unsigned int)mTextures.size();
+
+		stream.write(GLYPH_CACHE_MAGIC, 4);
+		stream.write((const char*)&version, sizeof(version));
+		stream.write((const char*)&mMaxGlyphHeight, sizeof(mMaxGlyphHeight));
+		stream.write((const char*)&textureCount, sizeof(textureCount));
+
+		std::map<FontTexture*, unsigned int> textureIndexes;
+
+		for (auto tex : mTextures)
+		{
+			int data[6] = { tex->textureSize.x(), tex->textureSize.y(), tex->writePos.x(), tex->writePos.y(), tex->rowHeight, tex->pixels.empty() ? 0 : 1 };
+			stream.write((const char*)data, sizeof(data));
+
+			if (!tex->pixels.empty())
+				stream.write((const char*)tex->pixels.data(), tex->pixels.size());
+
+			unsigned int index = (unsigned int)textureIndexes.size();
+			textureIndexes[tex] = index;
+		}
+
+		unsigned int glyphCount = (unsigned int)mGlyphMap.size();
+		stream.write((const char*)&glyphCount, sizeof(glyphCount));
+
+		for (auto it : mGlyphMap)
+		{
+			Glyph* glyph = it.second;
+
+			unsigned int texture = textureIndexes[glyph->texture];
+			int size[4] = { glyph->cursor.x(), glyph->cursor.y(), glyph->glyphSize.x(), glyph->glyphSize.y() };
+			float metrics[4] = { glyph->advance.x(), glyph->advance.y(), glyph->bearing.x(), glyph->bearing.y() };
+
+			stream.write((const char*)&it.first, sizeof(it.first));
+			stream.write((const char*)&texture, sizeof(texture));
+			stream.write((const char*)size, sizeof(size));
+			stream.write((const char*)metrics, sizeof(metrics));
+		}
+
+		if (stream.fail())
+		{
+			stream.close();
+			Utils::FileSystem::removeFile(tmpFile);
+			return;
+		}
+	}
+
+	if (!Utils::FileSystem::renameFile(tmpFile, fileName))
+		Utils::FileSystem::removeFile(tmpFile);
+	else
+		mSavedGlyphCount = mGlyphMap.size();
 }
 
 void Font::renderSingleGlow(TextCache* cache, const Transform4x4f& parentTrans, float x, float y, bool verticesChanged)
@@ -493,6 +744,11 @@ void Font::renderTextCache(TextCache* cache, bool verticesChanged)
 		return;
 	}
 
+	touch();
+
+	if (!mLoaded)
+		reload();
+
 	int tex = -1;
 
 	for(auto& vertex : cache->vertexLists)
@@ -538,6 +794,11 @@ void Font::renderGradientTextCache(TextCache* cache, unsigned int colorTop, unsi
 		return;
 	}
 
+	touch();
+
+	if (!mLoaded)
+		reload();
+
 	for (auto it = cache->vertexLists.cbegin(); it != cache->vertexLists.cend(); it++)
 	{
 		if (*it->textureIdPtr == 0)
@@ -648,8 +909,36 @@ std::string tryFastBidi(const std::string& text)
     return ret;
 }
 
-Vector2f Font::sizeText(std::string text, float lineSpacing)
+static std::string getLayoutKey(const std::string& text, std::initializer_list<float> values)
+{
+	std::string key;
+	key.reserve(text.size() + 1 + values.size() * sizeof(float));
+	key = text;
+	key += '\0';
+
+	for (auto value : values)
+		key.append((const char*)&value, sizeof(value));
+
+	return key;
+}
+
+void Font::clearLayoutCaches()
+{
+	mSizeCache.clear();
+	mWrapCache.clear();
+	mTextCacheLayouts.clear();
+}
+
+Vector2f Font::sizeText(const std::string& text, float lineSpacing)
 {
+	std::string key = getLayoutKey(text, { lineSpacing });
+
+	Vector2f size;
+	if (mSizeCache.get(key, size))
+		return size;
+
+	int maxGlyphHeight = mMaxGlyphHeight;
+
 	float lineWidth = 0.0f;
 	float highestWidth = 0.0f;
 
@@ -685,7 +974,13 @@ Vector2f Font::sizeText(std::string text, float lineSpacing)
 	if(lineWidth > highestWidth)
 		highestWidth = lineWidth;
 
-	return Vector2f(highestWidth, y);
+	size = Vector2f(highestWidth, y);
+
+	// A taller glyph was loaded while measuring : line height is no more the one used above
+	if (maxGlyphHeight == mMaxGlyphHeight)
+		mSizeCache.put(key, size);
+
+	return size;
 }
 
 float Font::getHeight(float lineSpacing) const
@@ -709,9 +1004,15 @@ static inline bool isWhiteSpace(unsigned int c)
 
 // Thanks eagle0wl'PR @ Retropie EmulationStation https://github.com/RetroPie/EmulationStation/pull/269/files
 // Breaks up a normal string with newlines to make it fit xLen
-std::string Font::wrapText(std::string text, float maxWidth)
+std::string Font::wrapText(const std::string& _text, float maxWidth)
 {
+	std::string key = getLayoutKey(_text, { maxWidth });
+
 	std::string out;
+	if (mWrapCache.get(key, out))
+		return out;
+
+	std::string text = _text;
 
 	int lastCursor = 0;
 
@@ -755,13 +1056,13 @@ std::string Font::wrapText(std::string text, float maxWidth)
 		}
 	}
 
+	mWrapCache.put(key, out);
 	return out;
 }
 
-Vector2f Font::sizeWrappedText(std::string text, float xLen, float lineSpacing)
+Vector2f Font::sizeWrappedText(const std::string& text, float xLen, float lineSpacing)
 {
-	text = wrapText(text, xLen);
-	return sizeText(text, lineSpacing);
+	return sizeText(wrapText(text, xLen), lineSpacing);
 }
 
 Vector2f Font::getWrappedTextCursorOffset(std::string text, float xLen, size_t stop, float lineSpacing)
@@ -831,6 +1132,24 @@ float Font::getNewlineStartOffset(const std::string& text, const unsigned int& c
 
 TextCache* Font::buildTextCache(const std::string& _text, Vector2f offset, unsigned int color, float xLen, Alignment alignment, float lineSpacing)
 {
+	std::string key = getLayoutKey(_text, { offset.x(), offset.y(), xLen, (float)alignment, lineSpacing, EsLocale::isRTL() ? 1.0f : 0.0f });
+
+	std::shared_ptr<TextCache> layout;
+	if (mTextCacheLayouts.get(key, layout))
+	{
+		// The cached layout is shared : callers get their own copy, as they can change colors
+		TextCache* cache = new TextCache(*layout);
+
+		const unsigned int convertedColor = Renderer::convertColor(color);
+		for (auto& vertList : cache->vertexLists)
+			for (auto& vertex : vertList.verts)
+				vertex.col = convertedColor;
+
+		return cache;
+	}
+
+	int maxGlyphHeight = mMaxGlyphHeight;
+
 	float x = offset[0] + (xLen != 0 ? getNewlineStartOffset(_text, 0, xLen, alignment) : 0);
 	
 	float yTop = getGlyph('S')->bearing.y();
@@ -1036,6 +1355,9 @@ TextCache* Font::buildTextCache(const std::string& _text, Vector2f offset, unsig
 
 	clearFaceCache();
 
+	if (maxGlyphHeight == mMaxGlyphHeight)
+		mTextCacheLayouts.put(key, std::make_shared<TextCache>(*cache));
+
 	return cache;
 }
 
@@ -1150,4 +1472,9 @@ void Font::OnThemeChanged()
 			}
 		}
 	}
+
+	// Substitution images are part of the cached layouts
+	for (auto it : sFontMap)
+		if (!it.second.expired())
+			it.second.lock()->clearLayoutCaches();
 }
@@ -9,6 +9,8 @@
 #include "ThemeData.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 class TextCache;
@@ -47,9 +49,12 @@ public:
 	static std::shared_ptr<Font> get(int size, const std::string& path = getDefaultPath());
 	static void OnThemeChanged();
 
+	// Keeps the glyph caches on disk under their size limit, removing the oldest ones
+	static void purgeGlyphCache();
+
 	virtual ~Font();
 
-	Vector2f sizeText(std::string text, float lineSpacing = 1.5f); // Returns the expected size of a string when rendered.  Extra spacing is applied to the Y axis.
+	Vector2f sizeText(const std::string& text, float lineSpacing = 1.5f); // Returns the expected size of a string when rendered.  Extra spacing is applied to the Y axis.
 	TextCache* buildTextCache(const std::string& text, float offsetX, float offsetY, unsigned int color);
 	TextCache* buildTextCache(const std::string& text, Vector2f offset, unsigned int color, float xLen, Alignment alignment = ALIGN_LEFT, float lineSpacing = 1.5f);
 	
@@ -58,8 +63,8 @@ public:
 
 	void renderGradientTextCache(TextCache* cache, unsigned int colorTop, unsigned int colorBottom, bool horz = false);
 	
-	std::string wrapText(std::string text, float xLen); // Inserts newlines into text to make it wrap properly.
-	Vector2f sizeWrappedText(std::string text, float xLen, float lineSpacing = 1.5f); // Returns the expected size of a string after wrapping is applied.
+	std::string wrapText(const std::string& text, float xLen); // Inserts newlines into text to make it wrap properly.
+	Vector2f sizeWrappedText(const std::string& text, float xLen, float lineSpacing = 1.5f); // Returns the expected size of a string after wrapping is applied.
 	Vector2f getWrappedTextCursorOffset(std::string text, float xLen, size_t cursor, float lineSpacing = 1.5f); // Returns the position of of the cursor after moving "cursor" characters.
 
 	float getHeight(float lineSpacing = 1.5f) const;
@@ -95,6 +100,9 @@ private:
 		Vector2i writePos;
 		int rowHeight;
 
+		// Copy of the atlas, so the texture is uploaded again without FreeType after a game launch
+		std::vector<unsigned char> pixels;
+
 		FontTexture();
 		~FontTexture();
 		bool findEmpty(const Vector2i& size, Vector2i& cursor_out);
@@ -102,6 +110,8 @@ private:
 		// you must call initTexture() after creating a FontTexture to get a textureId
 		void initTexture(); // initializes the OpenGL texture according to this FontTexture's settings, updating textureId
 		void deinitTexture(); // deinitializes the OpenGL texture if any exists, is automatically called in the destructor
+
+		void writeGlyph(const Vector2i& cursor, const Vector2i& size, const unsigned char* bitmap); // copies a glyph bitmap to the atlas & to the texture
 	};
 
 	struct FontFace
@@ -138,10 +148,68 @@ private:
 	};
 
 	Glyph* mGlyphCacheArray[255]; // used to cache 255 first chars
-	std::map<unsigned int, Glyph*> mGlyphMap;
+	std::unordered_map<unsigned int, Glyph*> mGlyphMap;
 
 	Glyph* getGlyph(unsigned int id);
 
+	// Atlases & glyph metrics are saved on disk, keyed on font file, file version & size,
+	// so fonts with thousands of glyphs (CJK gamelists) don't run FreeType again on next start
+	static std::string getGlyphCacheFolder();
+	std::string getGlyphCachePath();
+	void loadGlyphCache();
+	void saveGlyphCache();
+
+	size_t mSavedGlyphCount;
+
+	// Bounded LRU of text layouts, so lists & description panels don't measure and lay out the same strings again.
+	// Cleared when the line height changes (a taller glyph is loaded) or when the substitution images change.
+	template<typename T, size_t CAPACITY> class LayoutCache
+	{
+	public:
+		bool get(const std::string& key, T& value)
+		{
+			auto it = mLookup.find(key);
+			if (it == mLookup.cend())
+				return false;
+
+			// Move to front
+			mItems.splice(mItems.begin(), mItems, it->second);
+			value = it->second->second;
+			return true;
+		}
+
+		void put(const std::string& key, const T& value)
+		{
+			if (mLookup.find(key) != mLookup.cend())
+				return;
+
+			mItems.push_front(std::make_pair(key, value));
+			mLookup[key] = mItems.begin();
+
+			if (mItems.size() > CAPACITY)
+			{
+				mLookup.erase(mItems.back().first);
+				mItems.pop_back();
+			}
+		}
+
+		void clear()
+		{
+			mLookup.clear();
+			mItems.clear();
+		}
+
+	private:
+		std::list<std::pair<std::string, T>> mItems;
+		std::unordered_map<std::string, typename std::list<std::pair<std::string, T>>::iterator> mLookup;
+	};
+
+	LayoutCache<Vector2f, 1024> mSizeCache;
+	LayoutCache<std::string, 256> mWrapCache;
+	LayoutCache<std::shared_ptr<TextCache>, 256> mTextCacheLayouts;
+
+	void clearLayoutCaches();
+
 	int mMaxGlyphHeight;
 	
 	int mSize;
@@ -1,4 +1,5 @@
 #include "ResourceManager.h"
+#include "ResourcePack.h"
 
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
@@ -7,13 +8,21 @@
 #include "Log.h"
 #include "Settings.h"
 #include "Paths.h"
+#include <SDL_timer.h>
+
+#define RESOURCE_PACK_EXTENSION ".pak"
+
+// Resources drawn during the last frames before unloadAll() are needed by the first frame after reload
+#define VISIBLE_FRAMES 2
+
+unsigned int IReloadable::sFrameNumber = 0;
 
 auto array_deleter = [](unsigned char* p) { delete[] p; };
 auto nop_deleter = [](unsigned char* /*p*/) { };
 
 std::shared_ptr<ResourceManager> ResourceManager::sInstance = nullptr;
 
-ResourceManager::ResourceManager()
+ResourceManager::ResourceManager() : mUnloadFrame(0)
 {
 }
 
@@ -33,14 +42,14 @@ std::vector<std::string> ResourceManager::getResourcePaths() const
 	if (!Paths::getUserThemesPath().empty())
 	{
 		std::string themePath = Paths::getUserThemesPath() + "/" + Settings::getInstance()->getString("ThemeSet") + "/resources";
-		if (Utils::FileSystem::isDirectory(themePath))
+		if (Utils::FileSystem::isDirectory(themePath) || getResourcePack(themePath) != nullptr)
 			paths.push_back(themePath);
 	}
 
 	if (!Paths::getThemesPath().empty())
 	{
 		std::string roThemePath = Paths::getThemesPath() + "/" + Settings::getInstance()->getString("ThemeSet") + "/resources";
-		if (Utils::FileSystem::isDirectory(roThemePath))
+		if (Utils::FileSystem::isDirectory(roThemePath) || getResourcePack(roThemePath) != nullptr)
 			paths.push_back(roThemePath);
 	}
 
@@ -96,6 +105,22 @@ std::string ResourceManager::getResourcePath(const std::string& path) const
 
 const ResourceData ResourceManager::getFileData(const std::string& path) const
 {
+	if (path.size() >= 2 && path[0] == ':' && path[1] == '/')
+	{
+		// Same lookup order as getResourcePath, a pack being searched before the loose files of its folder
+		for (auto testPath : getResourcePaths())
+		{
+			auto pack = getResourcePack(testPath);
+			if (pack != nullptr && pack->contains(&path[2]))
+				return pack->getFileData(&path[2]);
+
+			std::string test = testPath + "/" + &path[2];
+			auto size = Utils::FileSystem::getFileSize(test);
+			if (size > 0)
+				return loadFile(test, size);
+		}
+	}
+
 	//check if its a resource
 	const std::string respath = getResourcePath(path);
 
@@ -106,6 +131,12 @@ const ResourceData ResourceManager::getFileData(const std::string& path) const
 		return data;
 	}
 
+	// Absolute path into a packed resource folder (theme paths are resolved before being loaded)
+	std::string name;
+	auto pack = getResourcePackOf(respath, name);
+	if (pack != nullptr)
+		return pack->getFileData(name);
+
 	//if the file doesn't exist, return an "empty" ResourceData
 	ResourceData data = {NULL, 0};
 	return data;
@@ -146,17 +177,72 @@ bool ResourceManager::fileExists(const std::string& path) const
 	}
 
 	if (path[0] != ':' && path[0] != '~' && path[0] != '/')
-		return Utils::FileSystem::exists(path);
+		return Utils::FileSystem::exists(path) || isInResourcePack(path);
 
 	//if it exists as a resource file, return true
 	if(getResourcePath(path) != path)
 		return true;
+
+	if (path[0] == ':' && path.size() >= 2 && path[1] == '/')
+	{
+		for (auto testPath : getResourcePaths())
+		{
+			auto pack = getResourcePack(testPath);
+			if (pack != nullptr && pack->contains(&path[2]))
+				return true;
+		}
+	}
 		
-	return Utils::FileSystem::exists(Utils::FileSystem::getCanonicalPath(path));
+	std::string fullPath = Utils::FileSystem::getCanonicalPath(path);
+	return Utils::FileSystem::exists(fullPath) || isInResourcePack(fullPath);
+}
+
+bool ResourceManager::isInResourcePack(const std::string& path) const
+{
+	std::string name;
+	return getResourcePackOf(path, name) != nullptr;
+}
+
+std::shared_ptr<ResourcePack> ResourceManager::getResourcePackOf(const std::string& path, std::string& name) const
+{
+	if (path.empty() || path[0] == ':')
+		return nullptr;
+
+	for (auto testPath : getResourcePaths())
+	{
+		if (path.size() <= testPath.size() + 1 || path[testPath.size()] != '/' || !Utils::String::startsWith(path, testPath))
+			continue;
+
+		auto pack = getResourcePack(testPath);
+		if (pack != nullptr && pack->contains(path.substr(testPath.size() + 1)))
+		{
+			name = path.substr(testPath.size() + 1);
+			return pack;
+		}
+	}
+
+	return nullptr;
+}
+
+std::shared_ptr<ResourcePack> ResourceManager::getResourcePack(const std::string& resourceFolder) const
+{
+	std::unique_lock<std::mutex> lock(mPacksLock);
+
+	// Missing packs are also remembered, so loose files only cost a map lookup
+	auto it = mPacks.find(resourceFolder);
+	if (it != mPacks.cend())
+		return it->second;
+
+	auto pack = ResourcePack::open(resourceFolder + RESOURCE_PACK_EXTENSION);
+	mPacks[resourceFolder] = pack;
+	return pack;
 }
 
 void ResourceManager::unloadAll()
 {
+	mPendingReloads.clear();
+	mUnloadFrame = IReloadable::sFrameNumber;
+
 	auto iter = mReloadables.cbegin();
 	while(iter != mReloadables.cend())
 	{
@@ -164,8 +250,9 @@ void ResourceManager::unloadAll()
 
 		if (!info->data.expired())
 		{
+			// Keep the flag of resources still waiting for a deferred reload
 			if (!info->locked)
-				info->reload = info->data.lock()->unload();
+				info->reload = info->data.lock()->unload() || info->reload;
 			else
 				info->locked = false;
 
@@ -178,6 +265,8 @@ void ResourceManager::unloadAll()
 
 void ResourceManager::reloadAll()
 {
+	mPendingReloads.clear();
+
 	auto iter = mReloadables.cbegin();
 	while(iter != mReloadables.cend())
 	{
@@ -198,6 +287,74 @@ void ResourceManager::reloadAll()
 	}
 }
 
+void ResourceManager::reloadVisible()
+{
+	mPendingReloads.clear();
+
+	std::vector<std::shared_ptr<ReloadableInfo>> hidden;
+
+	auto iter = mReloadables.cbegin();
+	while (iter != mReloadables.cend())
+	{
+		std::shared_ptr<ReloadableInfo> info = *iter;
+
+		if (info->data.expired())
+		{
+			iter = mReloadables.erase(iter);
+			continue;
+		}
+
+		if (info->reload)
+		{
+			auto data = info->data.lock();
+			if (data->getLastUseFrame() + VISIBLE_FRAMES >= mUnloadFrame)
+			{
+				data->reload();
+				info->reload = false;
+			}
+			else
+				hidden.push_back(info);
+		}
+
+		iter++;
+	}
+
+	// Most recently drawn first
+	std::stable_sort(hidden.begin(), hidden.end(), [](const std::shared_ptr<ReloadableInfo>& a, const std::shared_ptr<ReloadableInfo>& b)
+	{
+		auto da = a->data.lock();
+		auto db = b->data.lock();
+		return (da ? da->getLastUseFrame() : 0) > (db ? db->getLastUseFrame() : 0);
+	});
+
+	mPendingReloads.assign(hidden.cbegin(), hidden.cend());
+
+	LOG(LogDebug) << "ResourceManager::reloadVisible : " << mPendingReloads.size() << " resources deferred";
+}
+
+void ResourceManager::processPendingReloads(int maxTime)
+{
+	if (mPendingReloads.empty())
+		return;
+
+	int startTime = SDL_GetTicks();
+
+	while (!mPendingReloads.empty())
+	{
+		std::shared_ptr<ReloadableInfo> info = mPendingReloads.front();
+		mPendingReloads.pop_front();
+
+		if (!info->reload || info->data.expired())
+			continue;
+
+		info->data.lock()->reloadDeferred();
+		info->reload = false;
+
+		if ((int)SDL_GetTicks() - startTime >= maxTime)
+			break;
+	}
+}
+
 void ResourceManager::addReloadable(std::weak_ptr<IReloadable> reloadable)
 {
 	std::shared_ptr<ReloadableInfo> info = std::make_shared<ReloadableInfo>();
@@ -3,13 +3,17 @@
 #define ES_CORE_RESOURCES_RESOURCE_MANAGER_H
 
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 //The ResourceManager exists to...
 //Allow loading resources embedded into the executable like an actual file.
 //Allow embedded resources to be optionally remapped to actual files for further customization.
+//Serve resources from memory-mapped resource packs ("resources.pak" next to a "resources" folder), with fallback to loose files.
+//Packs are used for ":/" paths and for absolute paths inside one of the resource folders, when the loose file does not exist.
 
 struct ResourceData
 {
@@ -18,12 +22,27 @@ struct ResourceData
 };
 
 class ResourceManager;
+class ResourcePack;
 
 class IReloadable
 {
 public:
+	IReloadable() : mLastUseFrame(0) { }
+
 	virtual bool unload() = 0;
 	virtual void reload() = 0;
+
+	// Reload of a resource which was not visible when unloaded, after the first frames have been drawn
+	virtual void reloadDeferred() { reload(); }
+
+	// Called when the resource is drawn, so the visible resources can be reloaded first
+	inline void touch() { mLastUseFrame = sFrameNumber; }
+	inline unsigned int getLastUseFrame() const { return mLastUseFrame; }
+
+	static unsigned int sFrameNumber;
+
+private:
+	unsigned int mLastUseFrame;
 };
 
 class ResourceManager
@@ -37,6 +56,13 @@ public:
 	void unloadAll();
 	void reloadAll();
 
+	// Reloads now the resources drawn just before unloadAll(), the others are left to processPendingReloads()
+	void reloadVisible();
+	void processPendingReloads(int maxTime);
+	size_t getPendingReloadCount() { return mPendingReloads.size(); }
+
+	void newFrame() { IReloadable::sFrameNumber++; }
+
 	std::string getResourcePath(const std::string& path) const;
 	std::vector<std::string> getResourcePaths() const;
 
@@ -50,6 +76,13 @@ private:
 
 	ResourceData loadFile(const std::string& path, size_t size) const;
 
+	// Pack built from resourceFolder, nullptr if there is none
+	std::shared_ptr<ResourcePack> getResourcePack(const std::string& resourceFolder) const;
+
+	// Pack of the resource folder containing the absolute path, name receives the path relative to the folder
+	std::shared_ptr<ResourcePack> getResourcePackOf(const std::string& path, std::string& name) const;
+	bool isInResourcePack(const std::string& path) const;
+
 	class ReloadableInfo
 	{
 	public:
@@ -59,6 +92,11 @@ private:
 	};
 
 	std::list<std::shared_ptr<ReloadableInfo>> mReloadables;
+	std::list<std::shared_ptr<ReloadableInfo>> mPendingReloads;
+	unsigned int mUnloadFrame;
+
+	mutable std::mutex mPacksLock;
+	mutable std::map<std::string, std::shared_ptr<ResourcePack>> mPacks;
 };
 
 #endif // ES_CORE_RESOURCES_RESOURCE_MANAGER_H
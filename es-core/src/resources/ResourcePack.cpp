@@ -0,0 +1,285 @@
+#include "resources/ResourcePack.h"
+#include "resources/ResourceManager.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+
+#include <fstream>
+#include <string.h>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PACK_MAGIC		"ESRP"
+#define PACK_VERSION	1
+#define PACK_ALIGNMENT	16
+
+ResourcePack::ResourcePack(const std::string& path) : mPath(path), mData(nullptr), mLength(0)
+{
+#if defined(_WIN32)
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = NULL;
+#endif
+}
+
+ResourcePack::~ResourcePack()
+{
+	unmap();
+}
+
+std::shared_ptr<ResourcePack> ResourcePack::open(const std::string& path)
+{
+	if (!Utils::FileSystem::isRegularFile(path))
+		return nullptr;
+
+	std::shared_ptr<ResourcePack> pack(new ResourcePack(path));
+	if (!pack->map())
+	{
+		LOG(LogError) << "ResourcePack : unable to map " << path;
+		return nullptr;
+	}
+
+	if (!pack->readIndex())
+	{
+		LOG(LogError) << "ResourcePack : invalid pack " << path;
+		return nullptr;
+	}
+
+	LOG(LogInfo) << "ResourcePack : " << path << " mapped, " << pack->size() << " files";
+	return pack;
+}
+
+bool ResourcePack::map()
+{
+#if defined(_WIN32)
+	mFile = CreateFileW(Utils::String::convertToWideString(mPath).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+		return false;
+
+	mLength = (unsigned long long)size.QuadPart;
+
+	mMapping = CreateFileMappingW(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mMapping == NULL)
+		return false;
+
+	mData = (unsigned char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	return mData != nullptr;
+#else
+	int fd = ::open(mPath.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	mLength = (unsigned long long)info.st_size;
+
+	// The mapping stays valid once the descriptor is closed
+	void* data = mmap(nullptr, (size_t)mLength, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	mData = (unsigned char*)data;
+	return true;
+#endif
+}
+
+void ResourcePack::unmap()
+{
+#if defined(_WIN32)
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+
+	if (mMapping != NULL)
+		CloseHandle(mMapping);
+
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mMapping = NULL;
+	mFile = INVALID_HANDLE_VALUE;
+#else
+	if (mData != nullptr)
+		munmap(mData, (size_t)mLength);
+#endif
+
+	mData = nullptr;
+	mLength = 0;
+}
+
+template<typename T> static bool readValue(const unsigned char* data, unsigned long long length, unsigned long long& pos, T& value)
+{
+	if (pos + sizeof(T) > length)
+		return false;
+
+	memcpy(&value, data + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+bool ResourcePack::readIndex()
+{
+	unsigned long long pos = 4;
+	if (mLength < pos || memcmp(mData, PACK_MAGIC, 4) != 0)
+		return false;
+
+	unsigned int version = 0;
+	unsigned int count = 0;
+	if (!readValue(mData, mLength, pos, version) || version != PACK_VERSION || !readValue(mData, mLength, pos, count))
+		return false;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Entry entry;
+		unsigned short nameLength = 0;
+
+		if (!readValue(mData, mLength, pos, entry.offset) || !readValue(mData, mLength, pos, entry.size) || !readValue(mData, mLength, pos, nameLength))
+			return false;
+
+		if (pos + nameLength > mLength || entry.offset > mLength || entry.size > mLength - entry.offset)
+			return false;
+
+		mEntries[std::string((const char*)mData + pos, nameLength)] = entry;
+		pos += nameLength;
+	}
+
+	return true;
+}
+
+bool ResourcePack::contains(const std::string& name) const
+{
+	return mEntries.find(name) != mEntries.cend();
+}
+
+ResourceData ResourcePack::getFileData(const std::string& name)
+{
+	auto it = mEntries.find(name);
+	if (it == mEntries.cend() || it->second.size == 0)
+	{
+		ResourceData empty = { nullptr, 0 };
+		return empty;
+	}
+
+	// Aliasing constructor : no copy, the pointer shares ownership of the pack so the mapping outlives the data
+	std::shared_ptr<unsigned char> ptr(shared_from_this(), mData + it->second.offset);
+
+	ResourceData data = { ptr, (size_t)it->second.size };
+	return data;
+}
+
+bool ResourcePack::build(const std::string& folder, const std::string& packPath)
+{
+	std::string root = Utils::FileSystem::getGenericPath(folder);
+	if (!Utils::FileSystem::isDirectory(root))
+	{
+		LOG(LogError) << "ResourcePack : " << folder << " is not a directory";
+		return false;
+	}
+
+	std::vector<std::string> names;
+	std::vector<unsigned long long> sizes;
+
+	for (auto file : Utils::FileSystem::getDirContent(root, true))
+	{
+		if (!Utils::FileSystem::isRegularFile(file) || file.size() <= root.size() + 1)
+			continue;
+
+		std::string name = file.substr(root.size() + 1);
+		if (name.size() > 0xFFFF)
+			continue;
+
+		names.push_back(name);
+		sizes.push_back(Utils::FileSystem::getFileSize(file));
+	}
+
+	// Compute the index size first so that data offsets are known when writing it
+	unsigned long long indexSize = 4 + sizeof(unsigned int) * 2;
+	for (auto name : names)
+		indexSize += sizeof(unsigned long long) * 2 + sizeof(unsigned short) + name.size();
+
+	std::vector<unsigned long long> offsets;
+	unsigned long long offset = indexSize;
+	for (auto size : sizes)
+	{
+		offset = (offset + PACK_ALIGNMENT - 1) & ~(unsigned long long)(PACK_ALIGNMENT - 1);
+		offsets.push_back(offset);
+		offset += size;
+	}
+
+#if defined(_WIN32)
+	std::ofstream stream(Utils::String::convertToWideString(packPath), std::ios::binary);
+#else
+	std::ofstream stream(packPath, std::ios::binary);
+#endif
+	if (!stream.is_open())
+	{
+		LOG(LogError) << "ResourcePack : unable to create " << packPath;
+		return false;
+	}
+
+	unsigned int version = PACK_VERSION;
+	unsigned int count = (unsigned int)names.size();
+
+	stream.write(PACK_MAGIC, 4);
+	stream.write((const char*)&version, sizeof(version));
+	stream.write((const char*)&count, sizeof(count));
+
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		unsigned short nameLength = (unsigned short)names[i].size();
+
+		stream.write((const char*)&offsets[i], sizeof(unsigned long long));
+		stream.write((const char*)&sizes[i], sizeof(unsigned long long));
+		stream.write((const char*)&nameLength, sizeof(nameLength));
+		stream.write(names[i].c_str(), nameLength);
+	}
+
+	const char padding[PACK_ALIGNMENT] = { 0 };
+
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		unsigned long long pos = (unsigned long long)stream.tellp();
+		if (offsets[i] > pos)
+			stream.write(padding, (std::streamsize)(offsets[i] - pos));
+
+		std::string file = root + "/" + names[i];
+
+#if defined(_WIN32)
+		std::ifstream input(Utils::String::convertToWideString(file), std::ios::binary);
+#else
+		std::ifstream input(file, std::ios::binary);
+#endif
+		std::vector<char> buffer((size_t)sizes[i]);
+		if (sizes[i] > 0 && !input.read(buffer.data(), buffer.size()))
+		{
+			LOG(LogError) << "ResourcePack : unable to read " << file;
+			stream.close();
+			Utils::FileSystem::removeFile(packPath);
+			return false;
+		}
+
+		stream.write(buffer.data(), buffer.size());
+	}
+
+	stream.close();
+
+	LOG(LogInfo) << "ResourcePack : " << names.size() << " files packed from " << folder << " into " << packPath;
+	return !stream.fail();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_RESOURCE_PACK_H
+#define ES_CORE_RESOURCES_RESOURCE_PACK_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+struct ResourceData;
+
+// Single-file, indexed pack of resources (a theme "resources" folder or the builtin resources), memory-mapped when opened.
+// File layout : "ESRP" magic, version, entry count, then for each entry offset (from file start), size, name length & name.
+// Entry data follows the index, 16 bytes aligned. Names are relative to the packed folder and use '/' as separator.
+class ResourcePack : public std::enable_shared_from_this<ResourcePack>
+{
+public:
+	~ResourcePack();
+
+	// Returns nullptr if the file does not exist or is not a valid pack
+	static std::shared_ptr<ResourcePack> open(const std::string& path);
+
+	// Packs all files of folder (recursively) into packPath
+	static bool build(const std::string& folder, const std::string& packPath);
+
+	bool contains(const std::string& name) const;
+
+	// Data points into the mapping, which stays alive as long as the returned ResourceData is referenced.
+	// Returns an empty ResourceData if the pack does not contain the file
+	ResourceData getFileData(const std::string& name);
+
+	const std::string& getPath() const { return mPath; }
+	size_t size() const { return mEntries.size(); }
+
+private:
+	ResourcePack(const std::string& path);
+
+	bool map();
+	void unmap();
+	bool readIndex();
+
+	struct Entry
+	{
+		unsigned long long offset;
+		unsigned long long size;
+	};
+
+	std::string mPath;
+	std::map<std::string, Entry> mEntries;
+
+	unsigned char* mData;
+	unsigned long long mLength;
+
+#if defined(_WIN32)
+	void* mFile;
+	void* mMapping;
+#endif
+};
+
+#endif // ES_CORE_RESOURCES_RESOURCE_PACK_H
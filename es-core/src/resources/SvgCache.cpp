@@ -0,0 +1,303 @@
+#include "resources/SvgCache.h"
+#include "resources/ResourceManager.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "utils/md5.h"
+#include "Log.h"
+#include "Paths.h"
+
+#include <nanosvg/nanosvg.h>
+#include <fstream>
+#include <string.h>
+
+#define DPI 96
+
+// Documents are small once parsed, bitmaps are bound in bytes
+#define SVG_DOCUMENT_CACHE_COUNT	256
+#define SVG_BITMAP_CACHE_SIZE		(16 * 1024 * 1024)
+
+// Larger bitmaps are cheaper to rasterize again than to read back from disk
+#define SVG_DISK_CACHE_MAX_PIXELS	(512 * 512)
+
+#define SVG_DISK_CACHE_MAGIC		"SVGC"
+#define SVG_DISK_CACHE_MAX_SIZE		(32 * 1024 * 1024)
+
+std::mutex SvgCache::sDocumentsLock;
+std::map<std::string, SvgCache::Document> SvgCache::sDocuments;
+unsigned int SvgCache::sDocumentsUse = 0;
+
+std::mutex SvgCache::sBitmapsLock;
+std::list<SvgCache::Bitmap> SvgCache::sBitmaps;
+std::map<std::string, std::list<SvgCache::Bitmap>::iterator> SvgCache::sBitmapLookup;
+size_t SvgCache::sBitmapsSize = 0;
+
+std::shared_ptr<NSVGimage> SvgCache::parseDocument(const unsigned char* data, size_t length)
+{
+	if (data == nullptr || length == 0)
+		return nullptr;
+
+	// nsvgParse excepts a modifiable, null-terminated string
+	char* copy = (char*)malloc(length + 1);
+	if (copy == NULL)
+		return nullptr;
+
+	memcpy(copy, data, length);
+	copy[length] = '\0';
+
+	NSVGimage* svgImage = nsvgParse(copy, "px", DPI);
+	free(copy);
+
+	if (svgImage == nullptr)
+		return nullptr;
+
+	return std::shared_ptr<NSVGimage>(svgImage, nsvgDelete);
+}
+
+std::string SvgCache::getVersion(const std::string& path, size_t length)
+{
+	// Builtin resources may be served from a pack : the length is the only thing to compare then
+	std::string file = ResourceManager::getInstance()->getResourcePath(path);
+
+	time_t modTime = 0;
+	if (file.size() < 2 || file[0] != ':' || file[1] != '/')
+		modTime = Utils::FileSystem::getFileModificationDate(file).getTime();
+
+	return std::to_string((long long)modTime) + "-" + std::to_string(length);
+}
+
+std::shared_ptr<NSVGimage> SvgCache::getDocument(const std::string& path, const unsigned char* data, size_t length)
+{
+	if (path.empty())
+		return parseDocument(data, length);
+
+	std::string version = getVersion(path, length);
+
+	{
+		std::unique_lock<std::mutex> lock(sDocumentsLock);
+
+		auto it = sDocuments.find(path);
+		if (it != sDocuments.cend() && it->second.version == version)
+		{
+			it->second.lastUse = ++sDocumentsUse;
+			return it->second.image;
+		}
+	}
+
+	// Parse outside the lock : loader threads can parse different documents at the same time
+	auto image = parseDocument(data, length);
+	if (image == nullptr)
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(sDocumentsLock);
+
+	if (sDocuments.size() >= SVG_DOCUMENT_CACHE_COUNT)
+	{
+		auto oldest = sDocuments.begin();
+		for (auto it = sDocuments.begin(); it != sDocuments.end(); it++)
+			if (it->second.lastUse < oldest->second.lastUse)
+				oldest = it;
+
+		sDocuments.erase(oldest);
+	}
+
+	Document& document = sDocuments[path];
+	document.version = version;
+	document.image = image;
+	document.lastUse = ++sDocumentsUse;
+
+	return image;
+}
+
+bool SvgCache::getDocumentSize(const std::string& path, unsigned int* width, unsigned int* height)
+{
+	const ResourceData data = ResourceManager::getInstance()->getFileData(path);
+
+	auto image = getDocument(path, data.ptr.get(), data.length);
+	if (image == nullptr || image->width <= 0 || image->height <= 0)
+		return false;
+
+	*width = (unsigned int)image->width;
+	*height = (unsigned int)image->height;
+	return true;
+}
+
+unsigned char* SvgCache::getBitmap(const std::string& path, size_t length, size_t width, size_t height)
+{
+	if (path.empty() || width == 0 || height == 0)
+		return nullptr;
+
+	std::string key = path + "|" + getVersion(path, length) + "|" + std::to_string(width) + "x" + std::to_string(height);
+
+	{
+		std::unique_lock<std::mutex> lock(sBitmapsLock);
+
+		auto it = sBitmapLookup.find(key);
+		if (it != sBitmapLookup.cend())
+		{
+			// Move to front
+			sBitmaps.splice(sBitmaps.begin(), sBitmaps, it->second);
+
+			auto& bitmap = sBitmaps.front().data;
+			unsigned char* ret = new unsigned char[bitmap.size()];
+			memcpy(ret, bitmap.data(), bitmap.size());
+			return ret;
+		}
+	}
+
+	unsigned char* dataRGBA = loadFromDisk(key, width, height);
+	if (dataRGBA != nullptr)
+		addToMemory(key, width * height * 4, dataRGBA);
+
+	return dataRGBA;
+}
+
+void SvgCache::addBitmap(const std::string& path, size_t length, size_t width, size_t height, const unsigned char* dataRGBA)
+{
+	if (path.empty() || dataRGBA == nullptr || width == 0 || height == 0)
+		return;
+
+	std::string key = path + "|" + getVersion(path, length) + "|" + std::to_string(width) + "x" + std::to_string(height);
+
+	if (addToMemory(key, width * height * 4, dataRGBA))
+		saveToDisk(key, width, height, dataRGBA);
+}
+
+bool SvgCache::addToMemory(const std::string& key, size_t size, const unsigned char* dataRGBA)
+{
+	std::unique_lock<std::mutex> lock(sBitmapsLock);
+
+	if (size > SVG_BITMAP_CACHE_SIZE / 4 || sBitmapLookup.find(key) != sBitmapLookup.cend())
+		return false;
+
+	Bitmap bitmap;
+	bitmap.key = key;
+	bitmap.data.assign(dataRGBA, dataRGBA + size);
+
+	sBitmaps.push_front(bitmap);
+	sBitmapLookup[key] = sBitmaps.begin();
+	sBitmapsSize += size;
+
+	while (sBitmapsSize > SVG_BITMAP_CACHE_SIZE && sBitmaps.size() > 1)
+	{
+		auto& last = sBitmaps.back();
+		sBitmapsSize -= last.data.size();
+		sBitmapLookup.erase(last.key);
+		sBitmaps.pop_back();
+	}
+
+	return true;
+}
+
+void SvgCache::clear()
+{
+	{
+		std::unique_lock<std::mutex> lock(sDocumentsLock);
+		sDocuments.clear();
+	}
+
+	std::unique_lock<std::mutex> lock(sBitmapsLock);
+	sBitmaps.clear();
+	sBitmapLookup.clear();
+	sBitmapsSize = 0;
+}
+
+std::string SvgCache::getDiskCacheFolder()
+{
+	return Utils::FileSystem::getGenericPath(Paths::getUserEmulationStationPath() + "/cache/svg");
+}
+
+std::string SvgCache::getDiskCachePath(const std::string& key)
+{
+	return getDiskCacheFolder() + "/" + md5(key) + ".rgba";
+}
+
+void SvgCache::purgeDiskCache()
+{
+	// Bitmaps of previous themes & resolutions are never read again : the oldest ones go first
+	std::string folder = getDiskCacheFolder();
+	if (!Utils::FileSystem::isDirectory(folder))
+		return;
+
+	int removed = Utils::FileSystem::removeOldestFiles(folder, SVG_DISK_CACHE_MAX_SIZE);
+	if (removed > 0)
+		LOG(LogInfo) << "SvgCache : " << removed << " bitmaps removed from the disk cache";
+}
+
+unsigned char* SvgCache::loadFromDisk(const std::string& key, size_t width, size_t height)
+{
+	if (width * height > SVG_DISK_CACHE_MAX_PIXELS)
+		return nullptr;
+
+	std::string fileName = getDiskCachePath(key);
+	size_t size = width * height * 4;
+
+	if (Utils::FileSystem::getFileSize(fileName) != size + 12)
+		return nullptr;
+
+#if defined(_WIN32)
+	std::ifstream stream(Utils::String::convertToWideString(fileName), std::ios::binary);
+#else
+	std::ifstream stream(fileName, std::ios::binary);
+#endif
+
+	char magic[4];
+	unsigned int fileWidth = 0;
+	unsigned int fileHeight = 0;
+
+	if (!stream.read(magic, 4) || memcmp(magic, SVG_DISK_CACHE_MAGIC, 4) != 0 ||
+		!stream.read((char*)&fileWidth, sizeof(fileWidth)) || !stream.read((char*)&fileHeight, sizeof(fileHeight)) ||
+		fileWidth != width || fileHeight != height)
+		return nullptr;
+
+	unsigned char* dataRGBA = new unsigned char[size];
+	if (!stream.read((char*)dataRGBA, size))
+	{
+		delete[] dataRGBA;
+		return nullptr;
+	}
+
+	return dataRGBA;
+}
+
+void SvgCache::saveToDisk(const std::string& key, size_t width, size_t height, const unsigned char* dataRGBA)
+{
+	if (width * height > SVG_DISK_CACHE_MAX_PIXELS)
+		return;
+
+	std::string fileName = getDiskCachePath(key);
+
+	std::string folder = Utils::FileSystem::getParent(fileName);
+	if (!Utils::FileSystem::isDirectory(folder))
+		Utils::FileSystem::createDirectory(folder);
+
+	// Written to a temporary file first : another thread may be reading the cached file
+	std::string tmpFile = fileName + ".tmp" + std::to_string((size_t)dataRGBA);
+
+	{
+#if defined(_WIN32)
+		std::ofstream stream(Utils::String::convertToWideString(tmpFile), std::ios::binary);
+#else
+		std::ofstream stream(tmpFile, std::ios::binary);
+#endif
+		if (!stream.is_open())
+			return;
+
+		unsigned int fileWidth = (unsigned int)width;
+		unsigned int fileHeight = (unsigned int)height;
+
+		stream.write(SVG_DISK_CACHE_MAGIC, 4);
+		stream.write((const char*)&fileWidth, sizeof(fileWidth));
+		stream.write((const char*)&fileHeight, sizeof(fileHeight));
+		stream.write((const char*)dataRGBA, width * height * 4);
+
+		if (stream.fail())
+		{
+			stream.close();
+			Utils::FileSystem::removeFile(tmpFile);
+			return;
+		}
+	}
+
+	if (!Utils::FileSystem::renameFile(tmpFile, fileName))
+		Utils::FileSystem::removeFile(tmpFile);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_SVG_CACHE_H
+#define ES_CORE_RESOURCES_SVG_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct NSVGimage;
+
+// Shares parsed SVG documents between textures, and keeps rasterized bitmaps in memory and on disk
+// keyed by (path, modification time, width, height), so the same logos & icons are not rasterized again.
+class SvgCache
+{
+public:
+	static std::shared_ptr<NSVGimage> parseDocument(const unsigned char* data, size_t length);
+
+	// Returns the cached document of path, data is only parsed if the document is missing or has changed
+	static std::shared_ptr<NSVGimage> getDocument(const std::string& path, const unsigned char* data, size_t length);
+
+	// Natural size of the document, without rasterizing it
+	static bool getDocumentSize(const std::string& path, unsigned int* width, unsigned int* height);
+
+	// Returns a new[] allocated copy of the bitmap (already flipped), or nullptr
+	static unsigned char* getBitmap(const std::string& path, size_t length, size_t width, size_t height);
+	static void addBitmap(const std::string& path, size_t length, size_t width, size_t height, const unsigned char* dataRGBA);
+
+	static void clear();
+
+	// Keeps the disk cache under its size limit, removing the oldest bitmaps
+	static void purgeDiskCache();
+
+private:
+	struct Document
+	{
+		std::string version;
+		std::shared_ptr<NSVGimage> image;
+		unsigned int lastUse;
+	};
+
+	struct Bitmap
+	{
+		std::string key;
+		std::vector<unsigned char> data;
+	};
+
+	static std::string getVersion(const std::string& path, size_t length);
+	static std::string getDiskCacheFolder();
+	static std::string getDiskCachePath(const std::string& key);
+
+	static bool addToMemory(const std::string& key, size_t size, const unsigned char* dataRGBA);
+
+	static unsigned char* loadFromDisk(const std::string& key, size_t width, size_t height);
+	static void saveToDisk(const std::string& key, size_t width, size_t height, const unsigned char* dataRGBA);
+
+	static std::mutex sDocumentsLock;
+	static std::map<std::string, Document> sDocuments;
+	static unsigned int sDocumentsUse;
+
+	static std::mutex sBitmapsLock;
+	static std::list<Bitmap> sBitmaps;
+	static std::map<std::string, std::list<Bitmap>::iterator> sBitmapLookup;
+	static size_t sBitmapsSize;
+};
+
+#endif // ES_CORE_RESOURCES_SVG_CACHE_H
@@ -3,6 +3,7 @@
 #include "math/Misc.h"
 #include "renderers/Renderer.h"
 #include "resources/ResourceManager.h"
+#include "resources/SvgCache.h"
 #include "ImageIO.h"
 #include "Log.h"
 #include <nanosvg/nanosvg.h>
@@ -24,12 +25,18 @@
 
 IPdfHandler* TextureData::PdfHandler = nullptr;
 
+static bool isSvgPath(const std::string& path)
+{
+	return path.size() > 4 && path.substr(path.size() - 4, std::string::npos) == ".svg";
+}
+
 TextureData::TextureData(bool tile, bool linear) : mTile(tile), mLinear(linear), mTextureID(0), mDataRGBA(nullptr), mScalable(false),
 									  mWidth(0), mHeight(0), mSourceWidth(0.0f), mSourceHeight(0.0f),
 									  mPackedSize(Vector2i(0, 0)), mBaseSize(Vector2i(0, 0))
 {
 	mIsExternalDataRGBA = false;
 	mRequired = false;
+	mLoadFailed = false;
 }
 
 TextureData::~TextureData()
@@ -42,8 +49,11 @@ void TextureData::initFromPath(const std::string& path)
 {
 	// Just set the path. It will be loaded later
 	mPath = path;
+	mLoadFailed = false;
 	// Only textures with paths are reloadable
 	mReloadable = true;
+	// Known before loading, so a size requested before an async load is kept
+	mScalable = isSvgPath(path);
 }
 
 bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length)
@@ -53,16 +63,9 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 	if (mDataRGBA || (mTextureID != 0))
 		return true;
 
-	// nsvgParse excepts a modifiable, null-terminated string
-	char* copy = (char*)malloc(length + 1);
-	if (copy == NULL)
-		return false;
-	
-	memcpy(copy, fileData, length);
-	copy[length] = '\0';
-
-	NSVGimage* svgImage = nsvgParse(copy, "px", DPI);
-	free(copy);
+	// The parsed document is shared by all the textures using this file
+	std::shared_ptr<NSVGimage> document = SvgCache::getDocument(mPath, fileData, length);
+	NSVGimage* svgImage = document.get();
 	if (!svgImage)
 	{
 		LOG(LogError) << "Error parsing SVG image.";
@@ -135,19 +138,24 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 		return false;
 	}
 
-	unsigned char* dataRGBA = new unsigned char[mWidth * mHeight * 4];
+	unsigned char* dataRGBA = SvgCache::getBitmap(mPath, length, mWidth, mHeight);
+	if (dataRGBA == nullptr)
+	{
+		dataRGBA = new unsigned char[mWidth * mHeight * 4];
+
+		double scale = ((float)((int)mHeight)) / svgImage->height;
+		double scaleV = ((float)((int)mWidth)) / svgImage->width;
+		if (scaleV < scale)
+			scale = scaleV;
 
-	double scale = ((float)((int)mHeight)) / svgImage->height;
-	double scaleV = ((float)((int)mWidth)) / svgImage->width;
-	if (scaleV < scale)
-		scale = scaleV;
+		NSVGrasterizer* rast = nsvgCreateRasterizer();
+		nsvgRasterize(rast, svgImage, 0, 0, scale, dataRGBA, (int)mWidth, (int)mHeight, (int)mWidth * 4);
+		nsvgDeleteRasterizer(rast);
 
-	NSVGrasterizer* rast = nsvgCreateRasterizer();
-	nsvgRasterize(rast, svgImage, 0, 0, scale, dataRGBA, (int)mWidth, (int)mHeight, (int)mWidth * 4);
-	nsvgDeleteRasterizer(rast);
-	nsvgDelete(svgImage);
+		ImageIO::flipPixelsVert(dataRGBA, mWidth, mHeight);
 
-	ImageIO::flipPixelsVert(dataRGBA, mWidth, mHeight);
+		SvgCache::addBitmap(mPath, length, mWidth, mHeight, dataRGBA);
+	}
 
 	mDataRGBA = dataRGBA;
 
@@ -239,6 +247,20 @@ bool TextureData::updateFromExternalRGBA(unsigned char* dataRGBA, size_t width,
 // Avoid multiple extraction in the same file at the same time
 static Utils::StringListLockType mImageExtractorLock;
 
+// Documents can be addressed page by page with a ",<page>" suffix (ex: "manual.cbz,3"), pages being numbered from 0
+static std::string getDocumentPage(const std::string& path, int& page)
+{
+	page = 0;
+
+	auto ext = Utils::FileSystem::getExtension(path);
+	auto idx = ext.find(',');
+	if (idx == std::string::npos)
+		return path;
+
+	page = Utils::String::toInteger(ext.substr(idx + 1));
+	return path.substr(0, path.rfind(','));
+}
+
 #if WIN32
 extern void _checkUpgradedVlcVersion();
 #endif
@@ -350,6 +372,9 @@ bool TextureData::loadFromPdf()
 	
 	bool retval = false;
 
+	int page = 0;
+	std::string file = getDocumentPage(mPath, page);
+
 	Utils::StringListLock lock(mImageExtractorLock, mPath);
 	
 	int dpi = 48;
@@ -357,7 +382,7 @@ bool TextureData::loadFromPdf()
 	if (!mMaxSize.empty())
 		dpi = (int) Math::clamp(mMaxSize.y() / 6, 32, 300);
 
-	auto files = PdfHandler->extractPdfImages(mPath, 1, 1, dpi);
+	auto files = PdfHandler->extractPdfImages(file, page + 1, 1, dpi);
 	if (files.size() > 0)
 	{
 		std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
@@ -367,7 +392,7 @@ bool TextureData::loadFromPdf()
 		retval = initImageFromMemory((const unsigned char*)data.ptr.get(), data.length);
 
 		if (retval)
-			ImageIO::updateImageCache(mPath, Utils::FileSystem::getFileSize(mPath), mBaseSize.x(), mBaseSize.y());
+			ImageIO::updateImageCache(mPath, Utils::FileSystem::getFileSize(file), mBaseSize.x(), mBaseSize.y());
 	}
 
 	return retval;
@@ -377,12 +402,15 @@ bool TextureData::loadFromCbz()
 {
 	bool retval = false;
 
+	int page = 0;
+	std::string file = getDocumentPage(mPath, page);
+
 	Utils::StringListLock lock(mImageExtractorLock, mPath);
 
 	std::vector<Utils::Zip::ZipInfo> files;
 
 	Utils::Zip::ZipFile zipFile;
-	if (zipFile.load(mPath))
+	if (zipFile.load(file))
 	{
 		for (auto file : zipFile.infolist())
 		{
@@ -399,9 +427,10 @@ bool TextureData::loadFromCbz()
 		std::sort(files.begin(), files.end(), [](const Utils::Zip::ZipInfo& a, const Utils::Zip::ZipInfo& b) { return Utils::String::toLower(a.filename) < Utils::String::toLower(b.filename); });
 	}
 
-	if (files.size() > 0 && files[0].file_size > 0)
+	if (page >= 0 && page < (int)files.size() && files[page].file_size > 0)
 	{
-		size_t size = files[0].file_size;
+		// The entry is decompressed in memory, no temporary file
+		size_t size = files[page].file_size;
 		unsigned char* buffer = new unsigned char[size];
 
 		Utils::Zip::zip_callback func = [](void *pOpaque, unsigned long long ofs, const void *pBuf, size_t n)
@@ -414,18 +443,28 @@ bool TextureData::loadFromCbz()
 			return n;
 		};
 
-		zipFile.readBuffered(files[0].filename, func, buffer);
-		
-		retval = initImageFromMemory(buffer, size);
+		if (zipFile.readBuffered(files[page].filename, func, buffer))
+			retval = initImageFromMemory(buffer, size);
+
+		delete[] buffer;
 
 		if (retval)
-			ImageIO::updateImageCache(mPath, Utils::FileSystem::getFileSize(mPath), mBaseSize.x(), mBaseSize.y());
+			ImageIO::updateImageCache(mPath, Utils::FileSystem::getFileSize(file), mBaseSize.x(), mBaseSize.y());
 	}
 
 	return retval;
 }
 
 bool TextureData::load(bool updateCache)
+{
+	bool retval = loadData(updateCache);
+
+	// Missing or corrupt file : not queued again each time the texture is drawn
+	mLoadFailed = !retval && !mPath.empty();
+	return retval;
+}
+
+bool TextureData::loadData(bool updateCache)
 {
 	bool retval = false;
 
@@ -436,10 +475,10 @@ bool TextureData::load(bool updateCache)
 
 		std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mPath));
 
-		if (ext == ".cbz")
+		if (ext == ".cbz" || Utils::String::startsWith(ext, ".cbz,"))
 			return loadFromCbz();
 
-		if (PdfHandler != nullptr && ext == ".pdf")
+		if (PdfHandler != nullptr && (ext == ".pdf" || Utils::String::startsWith(ext, ".pdf,")))
 			return loadFromPdf();
 
 		if (Utils::FileSystem::isVideo(mPath))
@@ -458,7 +497,7 @@ bool TextureData::load(bool updateCache)
 		std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
 		const ResourceData& data = rm->getFileData(path);
 		// is it an SVG?
-		if (mPath.substr(mPath.size() - 4, std::string::npos) == ".svg")
+		if (isSvgPath(mPath))
 		{
 			mScalable = true;
 			retval = initSVGFromMemory((const unsigned char*)data.ptr.get(), data.length);
@@ -529,6 +568,7 @@ void TextureData::releaseRAM()
 		delete[] mDataRGBA;
 
 	mDataRGBA = 0;
+	mLoadFailed = false;
 }
 
 size_t TextureData::width()
@@ -577,6 +617,11 @@ void TextureData::setSourceSize(float width, float height)
 
 			mSourceWidth = width;
 			mSourceHeight = height;
+
+			// Not loaded yet (queued in the loader threads) : it will be rasterized directly at this size
+			if (!isLoaded())
+				return;
+
 			releaseVRAM();
 			releaseRAM();
 			load();
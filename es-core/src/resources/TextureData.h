@@ -2,6 +2,7 @@
 #ifndef ES_CORE_RESOURCES_TEXTURE_DATA_H
 #define ES_CORE_RESOURCES_TEXTURE_DATA_H
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -40,6 +41,11 @@ public:
 
 	bool isLoaded();
 
+	// The last load of the file failed
+	bool loadFailed() { return mLoadFailed; }
+	// Allows the file to be loaded again, it may have been scraped or fixed since
+	void resetLoadFailed() { mLoadFailed = false; }
+
 	// Upload the texture to VRAM if necessary and bind. Returns true if bound ok or
 	// false if either not loaded
 	bool uploadAndBind();
@@ -78,7 +84,10 @@ public:
 	void setRequired(bool value) { mRequired = value; };
 
 private:
+	bool loadData(bool updateCache);
+
 	bool			mRequired;
+	std::atomic<bool> mLoadFailed;
 
 	std::mutex		mMutex;
 	bool			mTile;
@@ -101,8 +101,8 @@ std::shared_ptr<TextureData> TextureDataManager::get(const TextureResource* key,
 			mTextureLookup[key] = mTextures.cbegin();
 		}
 
-		// Make sure it's loaded or queued for loading
-		if (enableLoading == TextureLoadMode::ENABLED && !tex->isLoaded())
+		// Make sure it's loaded or queued for loading, unless the file can't be loaded
+		if (enableLoading == TextureLoadMode::ENABLED && !tex->isLoaded() && !tex->loadFailed())
 		{
 			lock.unlock();
 			load(tex);
@@ -2,6 +2,8 @@
 
 #include "utils/FileSystemUtil.h"
 #include "resources/TextureData.h"
+#include "resources/SvgCache.h"
+#include "utils/StringUtil.h"
 #include <cstring>
 #include "Settings.h"
 #include "PowerSaver.h"
@@ -9,6 +11,13 @@
 #include "renderers/Renderer.h"
 
 TextureDataManager		TextureResource::sTextureDataManager;
+
+// CBZ or PDF document, optionally with a ",<page>" suffix
+static bool isDocumentPath(const std::string& path)
+{
+	auto ext = Utils::String::toLower(Utils::FileSystem::getExtension(path));
+	return ext == ".cbz" || ext == ".pdf" || Utils::String::startsWith(ext, ".cbz,") || Utils::String::startsWith(ext, ".pdf,");
+}
 std::map< TextureResource::TextureKeyType, std::weak_ptr<TextureResource> > TextureResource::sTextureMap;
 std::set<TextureResource*> 	TextureResource::sAllTextures;
 
@@ -35,10 +44,25 @@ TextureResource::TextureResource(const std::string& path, bool tile, bool linear
 
 			unsigned int width, height;
 
-			if (allowAsync && Settings::getInstance()->getBool("AsyncImages") && ImageIO::loadImageSize(fullpath.c_str(), &width, &height))
+			if (allowAsync && Settings::getInstance()->getBool("AsyncImages"))
 			{
-				data->setTemporarySize(width, height);
-				async = true;
+				if (isDocumentPath(path))
+				{
+					// CBZ & PDF pages : the size is only known once decoded, see getSize()
+					width = height = 0;
+					async = true;
+				}
+				else if (ImageIO::loadImageSize(fullpath.c_str(), &width, &height))
+				{
+					data->setTemporarySize(width, height);
+					async = true;
+				}
+				else if (Utils::String::toLower(Utils::FileSystem::getExtension(path)) == ".svg" && SvgCache::getDocumentSize(path, &width, &height))
+				{
+					// Only the shared document is parsed here, rasterization happens in the loader threads
+					// at the size given by rasterizeAt, so no temporary size is set on the texture data
+					async = true;
+				}
 			}
 
 			// Force the texture manager to load it using a blocking load
@@ -145,6 +169,14 @@ void TextureResource::initFromMemory(const char* data, size_t length)
 
 const Vector2i TextureResource::getSize() const
 {
+	if (mSize == Vector2i::Zero() && mTextureData == nullptr)
+	{
+		// Loaded asynchronously without knowing its size beforehand
+		std::shared_ptr<TextureData> data = sTextureDataManager.get(this, TextureDataManager::TextureLoadMode::DISABLED);
+		if (data != nullptr && data->isLoaded())
+			return Vector2i((int)data->width(), (int)data->height());
+	}
+
 	return mSize;
 }
 
@@ -175,9 +207,14 @@ void TextureResource::setRequired(bool value) const
 
 bool TextureResource::bind()
 {
+	touch();
+
 	if (mTextureData != nullptr)
 	{
-		mTextureData->uploadAndBind();
+		// A deferred reload may still be pending : load it in the background rather than drawing nothing forever
+		if (!mTextureData->uploadAndBind() && !mTextureData->isLoaded() && !mTextureData->loadFailed() && !mTextureData->getPath().empty())
+			sTextureDataManager.load(mTextureData);
+
 		return true;
 	}
 
@@ -297,6 +334,13 @@ void TextureResource::rasterizeAt(size_t width, size_t height)
 
 Vector2f TextureResource::getSourceImageSize() const
 {
+	if (mSourceSize == Vector2f::Zero() && mTextureData == nullptr)
+	{
+		std::shared_ptr<TextureData> data = sTextureDataManager.get(this, TextureDataManager::TextureLoadMode::DISABLED);
+		if (data != nullptr && data->isLoaded())
+			return Vector2f(data->sourceWidth(), data->sourceHeight());
+	}
+
 	return mSourceSize;
 }
 
@@ -360,6 +404,10 @@ bool TextureResource::unload()
 	else
 		data = mTextureData;
 
+	// A file that failed to load is tried again when drawn after the reload
+	if (data != nullptr)
+		data->resetLoadFailed();
+
 	if (data != nullptr && data->isLoaded())
 	{
 		data->releaseVRAM();
@@ -381,6 +429,19 @@ void TextureResource::reload()
 		sTextureDataManager.get(this);
 }
 
+void TextureResource::reloadDeferred()
+{
+	// Not drawn before unloading : manual textures with a file are loaded by the loader threads instead of blocking the frame.
+	// Dynamic textures are loaded on demand by the texture manager
+	if (mTextureData && !mTextureData->isLoaded())
+	{
+		if (mTextureData->getPath().empty())
+			mTextureData->load();
+		else
+			sTextureDataManager.load(mTextureData);
+	}
+}
+
 void TextureResource::clearQueue()
 {
 	sTextureDataManager.clearQueue();
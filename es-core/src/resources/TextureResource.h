@@ -44,6 +44,7 @@ public:
 	
 	virtual bool unload();
 	virtual void reload();
+	virtual void reloadDeferred();
 
 	void onTextureLoaded(std::shared_ptr<TextureData> tex);
 
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 
 #if defined(_WIN32)
 // because windows...
@@ -95,6 +96,11 @@ namespace Utils
 			bool hidden;
 			bool isSymLink;
 
+			// Filled by the first stat of the entry, directory listings don't provide them
+			bool hasStat = false;
+			unsigned long long size = 0;
+			time_t mtime = 0;
+
 			static int fromStat64(const std::string& key, struct stat64* info)
 			{
 #if defined(_WIN32)
@@ -108,6 +114,9 @@ namespace Utils
 				FileCache cache(ret == 0, false);
 				if (cache.exists)
 				{
+					cache.hasStat = true;
+					cache.size = (unsigned long long)info->st_size;
+					cache.mtime = info->st_mtime;
 					cache.directory = S_ISDIR(info->st_mode);
 #ifndef WIN32
 					cache.isSymLink = S_ISLNK(info->st_mode);
@@ -127,6 +136,59 @@ namespace Utils
 				return ret;
 			}
 
+			// Size & modification date, a single stat fills both when the cache is enabled
+			static bool getStat(const std::string& key, unsigned long long& size, time_t& mtime)
+			{
+				if (mEnabled)
+				{
+					// Read under the lock, loader threads fill the entries at the same time
+					std::unique_lock<std::mutex> lock(mFileCacheMutex);
+
+					auto it = mFileCache.find(key);
+					if (it != mFileCache.cend())
+					{
+						if (!it->second.exists)
+							return false;
+
+						if (it->second.hasStat)
+						{
+							size = it->second.size;
+							mtime = it->second.mtime;
+							return true;
+						}
+					}
+					else if (mFileCache.find(Utils::FileSystem::getParent(key) + "/*") != mFileCache.cend())
+						return false; // Not in the listing of its folder
+				}
+
+				struct stat64 info;
+#if defined(_WIN32)
+				if (_wstat64(Utils::String::convertToWideString(key).c_str(), &info) != 0)
+					return false;
+#else
+				if (stat64(key.c_str(), &info) != 0)
+					return false;
+#endif
+
+				size = (unsigned long long)info.st_size;
+				mtime = info.st_mtime;
+
+				if (!mEnabled)
+					return true;
+
+				// Keep the flags of entries from directory listings
+				std::unique_lock<std::mutex> lock(mFileCacheMutex);
+
+				auto it = mFileCache.find(key);
+				if (it == mFileCache.cend())
+					it = mFileCache.insert(std::make_pair(key, FileCache(true, S_ISDIR(info.st_mode)))).first;
+
+				it->second.size = size;
+				it->second.mtime = mtime;
+				it->second.hasStat = true;
+				return true;
+			}
+
 			static void add(const std::string& key, const FileCache& cache)
 			{
 				if (!mEnabled)
@@ -548,7 +610,7 @@ namespace Utils
 
 		}
 
-		std::string getCanonicalPath(const std::string& _path)
+		static std::string computeCanonicalPath(const std::string& _path)
 		{
 			// temporary hack for builtin resources
 			if (_path.size() >= 2 && _path[0] == ':' && _path[1] == '/')
@@ -623,6 +685,46 @@ namespace Utils
 
 		}
 
+		// Canonical paths of absolute paths, which only depend on the string (relative ones depend on the current directory).
+		// Images, textures & theme paths ask for the same paths on each cursor move : a lookup instead of a stat.
+		#define CANONICAL_PATH_CACHE_SIZE	8192
+
+		static std::unordered_map<std::string, std::string> sCanonicalPathCache;
+		static std::mutex sCanonicalPathCacheLock;
+
+		std::string getCanonicalPath(const std::string& _path)
+		{
+			// temporary hack for builtin resources
+			if (_path.size() >= 2 && _path[0] == ':' && _path[1] == '/')
+				return _path;
+
+#if WIN32
+			bool absolute = _path.size() > 1 && _path[1] == ':';
+#else
+			bool absolute = _path.size() > 0 && _path[0] == '/';
+#endif
+			if (!absolute)
+				return computeCanonicalPath(_path);
+
+			{
+				std::unique_lock<std::mutex> lock(sCanonicalPathCacheLock);
+
+				auto it = sCanonicalPathCache.find(_path);
+				if (it != sCanonicalPathCache.cend())
+					return it->second;
+			}
+
+			std::string path = computeCanonicalPath(_path);
+
+			std::unique_lock<std::mutex> lock(sCanonicalPathCacheLock);
+
+			if (sCanonicalPathCache.size() >= CANONICAL_PATH_CACHE_SIZE)
+				sCanonicalPathCache.clear();
+
+			sCanonicalPathCache[_path] = path;
+			return path;
+		}
+
 		std::string getAbsolutePath(const std::string& _path, const std::string& _base)
 		{
 			if (isAbsolute(_path))
@@ -1158,18 +1260,11 @@ namespace Utils
 
 		unsigned long long getFileSize(const std::string& _path)
 		{
-			std::string path = getGenericPath(_path);
-			struct stat64 info;
+			unsigned long long size;
+			time_t mtime;
 
-
-#if defined(_WIN32)
-			if ((_wstat64(Utils::String::convertToWideString(path).c_str(), &info) == 0))
-				return (unsigned long long)info.st_size;
-#else
-			// check if stat64 succeeded
-			if ((stat64(path.c_str(), &info) == 0))
-				return (unsigned long long)info.st_size;
-#endif
+			if (FileCache::getStat(getGenericPath(_path), size, mtime))
+				return size;
 
 			return 0;
 		}
@@ -1192,17 +1287,12 @@ namespace Utils
 
 		Utils::Time::DateTime getFileModificationDate(const std::string& _path)
 		{
-			std::string path = getGenericPath(_path);
-			struct stat64 info;
+			unsigned long long size;
+			time_t mtime;
+
+			if (FileCache::getStat(getGenericPath(_path), size, mtime))
+				return Utils::Time::DateTime(mtime);
 
-			// check if stat64 succeeded
-#if defined(_WIN32)
-			if ((_wstat64(Utils::String::convertToWideString(path).c_str(), &info) == 0))
-				return Utils::Time::DateTime(info.st_mtime);
-#else
-			if ((stat64(path.c_str(), &info) == 0))
-				return Utils::Time::DateTime(info.st_mtime);
-#endif
 			return Utils::Time::DateTime();
 		}
 
@@ -1312,6 +1402,54 @@ namespace Utils
 				removeDirectory(path);
 		}
 
+		int removeOldestFiles(const std::string& path, unsigned long long maxSize)
+		{
+			struct DirectoryFile
+			{
+				std::string path;
+				time_t date;
+				unsigned long long size;
+			};
+
+			std::vector<DirectoryFile> files;
+			unsigned long long totalSize = 0;
+
+			for (auto file : getDirContent(path))
+			{
+				if (isDirectory(file))
+					continue;
+
+				DirectoryFile directoryFile;
+				directoryFile.path = file;
+				directoryFile.date = getFileModificationDate(file).getTime();
+				directoryFile.size = getFileSize(file);
+
+				totalSize += directoryFile.size;
+				files.push_back(directoryFile);
+			}
+
+			if (totalSize <= maxSize)
+				return 0;
+
+			std::sort(files.begin(), files.end(), [](const DirectoryFile& a, const DirectoryFile& b) { return a.date < b.date; });
+
+			int removed = 0;
+
+			for (auto& file : files)
+			{
+				if (totalSize <= maxSize)
+					break;
+
+				if (removeFile(file.path))
+				{
+					totalSize -= file.size;
+					removed++;
+				}
+			}
+
+			return removed;
+		}
+
 		std::string megaBytesToString(unsigned long size)
 		{
 			static const char *SIZES[] = { "MB", "GB", "TB" };
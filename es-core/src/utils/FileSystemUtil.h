@@ -69,6 +69,9 @@ namespace Utils
 		void		deleteDirectoryFiles(const std::string path, bool deleteDirectory = false);
 		bool		renameFile(const std::string src, const std::string dst, bool overWrite = true);
 
+		// Removes the least recently written files of path until its files take maxSize bytes or less. Returns the count of removed files
+		int			removeOldestFiles(const std::string& path, unsigned long long maxSize);
+
 		std::string megaBytesToString(unsigned long size);
 		std::string kiloBytesToString(unsigned long size);
 
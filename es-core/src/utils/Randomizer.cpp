@@ -3,7 +3,7 @@
 std::random_device Randomizer::RandomDevice;
 Randomizer* Randomizer::Instance = nullptr;
 
-Randomizer::Randomizer() : mMt19937(RandomDevice()) { }
+Randomizer::Randomizer(unsigned int seed) : mMt19937(seed), mSeed(seed) { }
 
 int Randomizer::random(int max)
 {
@@ -11,10 +11,24 @@ int Randomizer::random(int max)
 		return 0;
 
 	if (Instance == nullptr)
-		Instance = new Randomizer();
+		Instance = new Randomizer(RandomDevice());
 
 	std::uniform_int_distribution<int> uniformDistribution(0, max - 1);
 	return uniformDistribution(Instance->mMt19937);
 }
 
+unsigned int Randomizer::getSeed()
+{
+	if (Instance == nullptr)
+		Instance = new Randomizer(RandomDevice());
+
+	return Instance->mSeed;
+}
 
+void Randomizer::setSeed(unsigned int seed)
+{
+	if (Instance != nullptr)
+		delete Instance;
+
+	Instance = new Randomizer(seed);
+}
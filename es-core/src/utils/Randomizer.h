@@ -7,10 +7,15 @@ class Randomizer
 public:
 	static int random(int max);
 
+	// The seed is drawn from the random device, unless set before (to replay a recorded session)
+	static unsigned int getSeed();
+	static void setSeed(unsigned int seed);
+
 private:
-	Randomizer();
+	Randomizer(unsigned int seed);
 
 	static std::random_device RandomDevice;
 	static Randomizer*	Instance;
 	std::mt19937		mMt19937;
+	unsigned int		mSeed;
 };
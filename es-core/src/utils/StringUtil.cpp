@@ -13,6 +13,14 @@
 
 #include "han.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STRINGUTIL_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STRINGUTIL_NEON
+#endif
+
 namespace Utils
 {
 	namespace String
@@ -330,87 +338,191 @@ namespace Utils
 
 		} // moveCursor
 		
-		std::string toLower(const std::string& _string) 
+		static inline char asciiToUpper(char c)
 		{
-			std::string text = _string;
+			return (c >= 'a' && c <= 'z') ? (char)(c - 0x20) : c;
+		}
 
+		// Converts case of 16-byte blocks in place as long as they are pure ASCII.
+		// Returns the number of bytes processed, stopping before the first block that contains a non ASCII byte.
+		static size_t asciiCaseBlocks(char* data, size_t length, char first, char last)
+		{
 			size_t i = 0;
-			while (i < text.length())
+
+#if defined(STRINGUTIL_SSE2)
+			const __m128i lo = _mm_set1_epi8(first - 1);
+			const __m128i hi = _mm_set1_epi8(last + 1);
+			const __m128i flip = _mm_set1_epi8(0x20);
+
+			for (; i + 16 <= length; i += 16)
 			{
-				char c = text[i];
-				if ((c & 0x80) == 0)
-				{
-					if (c >= 'A' && c <= 'Z')
-						text[i] = c + 0x20;
+				__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+				if (_mm_movemask_epi8(v) != 0)
+					break;
 
-					i++;
-					continue;
-				}
+				__m128i mask = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+				_mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v, _mm_and_si128(mask, flip)));
+			}
+#elif defined(STRINGUTIL_NEON)
+			const uint8x16_t lo = vdupq_n_u8((uint8_t)first);
+			const uint8x16_t hi = vdupq_n_u8((uint8_t)last);
+			const uint8x16_t flip = vdupq_n_u8(0x20);
 
-				int pos = i;
-				wchar_t character = (wchar_t)chars2Unicode(text, i);
-				wchar_t unicode = tolowerUnicode(character);
-				if (unicode != character)
-				{
-					int charSize = i - pos;
-					if (charSize == 2)
-					{
-						text[pos] = (char)(((unicode >> 6) & 0xFF) | 0xC0);
-						text[pos + 1] = (char)((unicode & 0x3F) | 0x80);
-					}
-					else if (charSize == 3)
-					{
-						text[pos] += (char)(((unicode >> 12) & 0xFF) | 0xE0);
-						text[pos + 1] += (char)(((unicode >> 6) & 0x3F) | 0x80);
-						text[pos + 2] += (char)((unicode & 0x3F) | 0x80);
+			for (; i + 16 <= length; i += 16)
+			{
+				uint8x16_t v = vld1q_u8((const uint8_t*)(data + i));
+#if defined(__aarch64__)
+				if (vmaxvq_u8(v) & 0x80)
+					break;
+#else
+				uint8x8_t m = vpmax_u8(vget_low_u8(v), vget_high_u8(v));
+				m = vpmax_u8(m, m);
+				m = vpmax_u8(m, m);
+				m = vpmax_u8(m, m);
+				if (vget_lane_u8(m, 0) & 0x80)
+					break;
+#endif
+				uint8x16_t mask = vandq_u8(vcgeq_u8(v, lo), vcleq_u8(v, hi));
+				vst1q_u8((uint8_t*)(data + i), veorq_u8(v, vandq_u8(mask, flip)));
+			}
+#endif
 
-					}
-				}
+			return i;
+		}
+
+		// Returns the number of leading bytes (multiple of 16) which are pure ASCII, non null and equal ignoring case in both buffers
+		static size_t asciiEqualIgnoreCaseBlocks(const char* a, const char* b, size_t length)
+		{
+			size_t i = 0;
+
+#if defined(STRINGUTIL_SSE2)
+			const __m128i lo = _mm_set1_epi8('a' - 1);
+			const __m128i hi = _mm_set1_epi8('z' + 1);
+			const __m128i flip = _mm_set1_epi8(0x20);
+			const __m128i zero = _mm_setzero_si128();
+
+			for (; i + 16 <= length; i += 16)
+			{
+				__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+				__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+				if (_mm_movemask_epi8(_mm_or_si128(va, vb)) != 0)
+					break;
+
+				va = _mm_xor_si128(va, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(va, lo), _mm_cmplt_epi8(va, hi)), flip));
+				vb = _mm_xor_si128(vb, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(vb, lo), _mm_cmplt_epi8(vb, hi)), flip));
+
+				__m128i diff = _mm_andnot_si128(_mm_cmpeq_epi8(va, zero), _mm_cmpeq_epi8(va, vb));
+				if (_mm_movemask_epi8(diff) != 0xFFFF)
+					break;
 			}
+#elif defined(STRINGUTIL_NEON)
+			const uint8x16_t lo = vdupq_n_u8('a');
+			const uint8x16_t hi = vdupq_n_u8('z');
+			const uint8x16_t flip = vdupq_n_u8(0x20);
 
-			return text;
+			for (; i + 16 <= length; i += 16)
+			{
+				uint8x16_t va = vld1q_u8((const uint8_t*)(a + i));
+				uint8x16_t vb = vld1q_u8((const uint8_t*)(b + i));
+
+				va = veorq_u8(va, vandq_u8(vandq_u8(vcgeq_u8(va, lo), vcleq_u8(va, hi)), flip));
+				vb = veorq_u8(vb, vandq_u8(vandq_u8(vcgeq_u8(vb, lo), vcleq_u8(vb, hi)), flip));
+
+				// Lanes are 0xFF only for equal, non null, ASCII bytes
+				uint8x16_t ok = vandq_u8(vceqq_u8(va, vb), vandq_u8(vtstq_u8(va, va), vcltq_u8(vorrq_u8(va, vb), vdupq_n_u8(0x80))));
+#if defined(__aarch64__)
+				if (vminvq_u8(ok) != 0xFF)
+					break;
+#else
+				uint8x8_t m = vpmin_u8(vget_low_u8(ok), vget_high_u8(ok));
+				m = vpmin_u8(m, m);
+				m = vpmin_u8(m, m);
+				m = vpmin_u8(m, m);
+				if (vget_lane_u8(m, 0) != 0xFF)
+					break;
+#endif
+			}
+#endif
+
+			return i;
 		}
 
-		std::string toUpper(const std::string& _string) 
+		static void changeCase(std::string& text, bool upper)
 		{
-			std::string text = _string;
+			const char first = upper ? 'a' : 'A';
+			const char last = upper ? 'z' : 'Z';
+
+			char* data = &text[0];
+			size_t length = text.length();
 
 			size_t i = 0;
-			while (i < text.length())
+			while (i < length)
 			{
-				char c = text[i];
+				i += asciiCaseBlocks(data + i, length - i, first, last);
+				if (i >= length)
+					break;
+
+				char c = data[i];
 				if ((c & 0x80) == 0)
 				{
-					if (c >= 'a' && c <= 'z')
-						text[i] = c - 0x20;
+					if (c >= first && c <= last)
+						data[i] = c ^ 0x20;
 
 					i++;
 					continue;
 				}
 
-				int pos = i;
+				size_t pos = i;
 				wchar_t character = (wchar_t)chars2Unicode(text, i);
-				wchar_t unicode = toupperUnicode(character);
+				wchar_t unicode = upper ? toupperUnicode(character) : tolowerUnicode(character);
 				if (unicode != character)
 				{
-					int charSize = i - pos;
+					size_t charSize = i - pos;
 					if (charSize == 2)
 					{
-						text[pos] = (char)(((unicode >> 6) & 0xFF) | 0xC0);
-						text[pos + 1] = (char)((unicode & 0x3F) | 0x80);
+						data[pos] = (char)(((unicode >> 6) & 0xFF) | 0xC0);
+						data[pos + 1] = (char)((unicode & 0x3F) | 0x80);
 					}
 					else if (charSize == 3)
 					{
-						text[pos] += (char)(((unicode >> 12) & 0xFF) | 0xE0);
-						text[pos + 1] += (char)(((unicode >> 6) & 0x3F) | 0x80);
-						text[pos + 2] += (char)((unicode & 0x3F) | 0x80);
+						data[pos] = (char)(((unicode >> 12) & 0xFF) | 0xE0);
+						data[pos + 1] = (char)(((unicode >> 6) & 0x3F) | 0x80);
+						data[pos + 2] = (char)((unicode & 0x3F) | 0x80);
 					}
 				}
 			}
+		}
 
+		std::string toLower(const std::string& _string) 
+		{
+			std::string text = _string;
+			changeCase(text, false);
 			return text;
-		}
-
+		}
+
+		std::string toUpper(const std::string& _string) 
+		{
+			std::string text = _string;
+			changeCase(text, true);
+			return text;
+		}
+
+		void toLower(const std::string& _string, std::string& _dest)
+		{
+			if (&_dest != &_string)
+				_dest.assign(_string);
+
+			changeCase(_dest, false);
+		}
+
+		void toUpper(const std::string& _string, std::string& _dest)
+		{
+			if (&_dest != &_string)
+				_dest.assign(_string);
+
+			changeCase(_dest, true);
+		}
+
 		std::string trim(const std::string& _string)
 		{
 			const size_t strBegin = _string.find_first_not_of(" \t\r\n");
@@ -640,32 +752,47 @@ namespace Utils
 
 		bool startsWithIgnoreCase(const std::string& name1, const std::string& name2)
 		{
-			auto makeUp = [](unsigned int c)
-			{
-				if ((c & 0x80) == 0) return toupper(c);
-				return (int)toupperUnicode(c);
-			};
+			if (name2.length() > name1.length())
+				return false;
 
-			size_t p1 = 0;
-			size_t p2 = 0;
+			size_t p1 = asciiEqualIgnoreCaseBlocks(name1.c_str(), name2.c_str(), name2.length());
+			size_t p2 = p1;
 
 			while (true)
 			{
-				int u1 = makeUp(chars2Unicode(name1, p1));
-				int u2 = makeUp(chars2Unicode(name2, p2));
+				char c1 = name1[p1];
+				char c2 = name2[p2];
 
-				if (u1 != 0 && u2 == 0)
+				int u1, u2;
+
+				if ((c1 & 0x80) == 0)
+				{
+					u1 = asciiToUpper(c1);
+					p1++;
+				}
+				else
+					u1 = toupperUnicode(chars2Unicode(name1, p1));
+
+				if ((c2 & 0x80) == 0)
+				{
+					u2 = asciiToUpper(c2);
+					p2++;
+				}
+				else
+					u2 = toupperUnicode(chars2Unicode(name2, p2));
+
+				if (u2 == 0)
 					return true;
 				
 				if (u1 != u2)
 					return false;
 			}
-		}
-
+		}
+
 		int compareIgnoreCase(const std::string& name1, const std::string& name2)
 		{
-			size_t p1 = 0;
-			size_t p2 = 0;
+			size_t p1 = asciiEqualIgnoreCaseBlocks(name1.c_str(), name2.c_str(), std::min(name1.length(), name2.length()));
+			size_t p2 = p1;
 
 			int u1, u2;
 			char c1, c2;
@@ -711,15 +838,79 @@ namespace Utils
 			}
 		}
 
+		static bool matchesIgnoreCaseAt(const char* text, const char* what, size_t length)
+		{
+			for (size_t i = 0; i < length; i++)
+				if (asciiToUpper(text[i]) != asciiToUpper(what[i]))
+					return false;
+
+			return true;
+		}
+
 		bool containsIgnoreCase(const std::string & _string, const std::string & _what)
 		{
-			auto it = std::search(
-				_string.begin(), _string.end(),
-				_what.begin(), _what.end(),
-				[](char ch1, char ch2) { return toupper(ch1) == toupper(ch2); }
-			);
+			if (_what.empty())
+				return true;
+
+			if (_what.length() > _string.length())
+				return false;
+
+			const char* text = _string.c_str();
+			const char* what = _what.c_str();
+
+			const size_t whatLength = _what.length();
+			const size_t end = _string.length() - whatLength + 1; // Number of candidate positions
+
+			const char first = asciiToUpper(what[0]);
+			const char firstAlt = (first >= 'A' && first <= 'Z') ? (char)(first + 0x20) : first;
+
+			size_t i = 0;
+
+#if defined(STRINGUTIL_SSE2)
+			// Find candidate positions matching the first character, 16 positions at a time
+			const __m128i vFirst = _mm_set1_epi8(first);
+			const __m128i vFirstAlt = _mm_set1_epi8(firstAlt);
+
+			for (; i + 16 <= end; i += 16)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(text + i));
+				unsigned int bits = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, vFirst), _mm_cmpeq_epi8(v, vFirstAlt)));
+
+				while (bits != 0)
+				{
+					size_t bit = 0;
+					while ((bits & (1u << bit)) == 0)
+						bit++;
+
+					if (matchesIgnoreCaseAt(text + i + bit + 1, what + 1, whatLength - 1))
+						return true;
+
+					bits &= bits - 1;
+				}
+			}
+#elif defined(STRINGUTIL_NEON)
+			const uint8x16_t vFirst = vdupq_n_u8((uint8_t)first);
+			const uint8x16_t vFirstAlt = vdupq_n_u8((uint8_t)firstAlt);
+
+			for (; i + 16 <= end; i += 16)
+			{
+				uint8x16_t v = vld1q_u8((const uint8_t*)(text + i));
+				uint8x16_t eq = vorrq_u8(vceqq_u8(v, vFirst), vceqq_u8(v, vFirstAlt));
+
+				uint8_t lanes[16];
+				vst1q_u8(lanes, eq);
+
+				for (size_t bit = 0; bit < 16; bit++)
+					if (lanes[bit] && matchesIgnoreCaseAt(text + i + bit + 1, what + 1, whatLength - 1))
+						return true;
+			}
+#endif
+
+			for (; i < end; i++)
+				if ((text[i] == first || text[i] == firstAlt) && matchesIgnoreCaseAt(text + i + 1, what + 1, whatLength - 1))
+					return true;
 
-			return (it != _string.end());
+			return false;
 		}
 		
 		bool containsIgnoreCasePinyin(const std::string & _string, const std::string & _what)
@@ -0,0 +1,213 @@
+#include "utils/TaskGraph.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace Utils
+{
+	static int getTicks()
+	{
+		return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	TaskGraph::TaskGraph(const std::string& name) : mName(name)
+	{
+		mStartTime = getTicks();
+	}
+
+	TaskGraph::~TaskGraph()
+	{
+		// Never leave a running thread behind, even if run() was not called
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+			for (auto task : mTasks)
+				while (task->state == TASK_RUNNING && task->thread != nullptr)
+					mEvent.wait(lock);
+		}
+
+		join();
+
+		for (auto task : mTasks)
+			delete task;
+
+		mTasks.clear();
+		mTaskNames.clear();
+	}
+
+	void TaskGraph::add(const std::string& name, const std::vector<std::string>& dependencies, work_function work, bool mainThread)
+	{
+		Task* task = new Task();
+		task->name = name;
+		task->dependencies = dependencies;
+		task->work = work;
+		task->mainThread = mainThread;
+		task->state = TASK_PENDING;
+		task->startTime = 0;
+		task->endTime = 0;
+		task->thread = nullptr;
+
+		std::unique_lock<std::mutex> lock(mLock);
+		mTasks.push_back(task);
+		mTaskNames[name] = task;
+	}
+
+	bool TaskGraph::isReady(Task* task)
+	{
+		for (auto dependency : task->dependencies)
+		{
+			auto it = mTaskNames.find(dependency);
+			if (it != mTaskNames.cend() && it->second->state != TASK_DONE)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Must be called with mLock held
+	void TaskGraph::startReadyTasks()
+	{
+		for (auto task : mTasks)
+		{
+			if (task->mainThread || task->state != TASK_PENDING || !isReady(task))
+				continue;
+
+			task->state = TASK_RUNNING;
+			task->thread = new std::thread(&TaskGraph::execute, this, task);
+		}
+	}
+
+	void TaskGraph::start()
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		startReadyTasks();
+	}
+
+	void TaskGraph::execute(Task* task)
+	{
+		int startTime = getTicks();
+
+		try
+		{
+			task->work();
+		}
+		catch (...)
+		{
+			LOG(LogError) << mName << " : task " << task->name << " failed";
+		}
+
+		std::unique_lock<std::mutex> lock(mLock);
+		task->startTime = startTime - mStartTime;
+		task->endTime = getTicks() - mStartTime;
+		task->state = TASK_DONE;
+
+		// Background tasks depending on this one can start immediately, without waiting for the main thread
+		startReadyTasks();
+		mEvent.notify_all();
+	}
+
+	void TaskGraph::run()
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+
+		for (auto task : mTasks)
+			for (auto dependency : task->dependencies)
+				if (mTaskNames.find(dependency) == mTaskNames.cend())
+					LOG(LogWarning) << mName << " : task " << task->name << " depends on unknown task " << dependency;
+
+		while (true)
+		{
+			startReadyTasks();
+
+			Task* mainTask = nullptr;
+			bool running = false;
+			bool pending = false;
+
+			for (auto task : mTasks)
+			{
+				if (task->state == TASK_RUNNING)
+					running = true;
+				else if (task->state == TASK_PENDING)
+				{
+					pending = true;
+					if (mainTask == nullptr && task->mainThread && isReady(task))
+						mainTask = task;
+				}
+			}
+
+			if (mainTask != nullptr)
+			{
+				mainTask->state = TASK_RUNNING;
+				lock.unlock();
+				execute(mainTask);
+				lock.lock();
+				continue;
+			}
+
+			if (!pending && !running)
+				break;
+
+			if (!running)
+			{
+				// Dependency cycle : run the remaining tasks in declaration order rather than never starting them
+				for (auto task : mTasks)
+				{
+					if (task->state != TASK_PENDING)
+						continue;
+
+					LOG(LogError) << mName << " : dependency cycle detected on task " << task->name;
+
+					task->state = TASK_RUNNING;
+					lock.unlock();
+					execute(task);
+					lock.lock();
+				}
+
+				continue;
+			}
+
+			mEvent.wait(lock);
+		}
+
+		lock.unlock();
+
+		join();
+		logTimeline();
+	}
+
+	void TaskGraph::join()
+	{
+		for (auto task : mTasks)
+		{
+			if (task->thread == nullptr)
+				continue;
+
+			if (task->thread->joinable())
+				task->thread->join();
+
+			delete task->thread;
+			task->thread = nullptr;
+		}
+	}
+
+	void TaskGraph::logTimeline()
+	{
+		int total = 0;
+		int sequential = 0;
+
+		for (auto task : mTasks)
+		{
+			total = std::max(total, task->endTime);
+			sequential += task->endTime - task->startTime;
+		}
+
+		LOG(LogInfo) << mName << " timeline : " << total << "ms (" << sequential << "ms if sequential)";
+
+		for (auto task : mTasks)
+		{
+			LOG(LogInfo) << "  " << std::setw(6) << task->startTime << " - " << std::setw(6) << task->endTime << "ms " <<
+				(task->mainThread ? "[main]   " : "[thread] ") << task->name;
+		}
+	}
+}
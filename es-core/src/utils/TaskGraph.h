@@ -0,0 +1,71 @@
+#pragma once
+#ifndef ES_CORE_UTILS_TASK_GRAPH_H
+#define ES_CORE_UTILS_TASK_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Utils
+{
+	// Runs named tasks according to their dependencies.
+	// Background tasks get their own thread as soon as their dependencies are done.
+	// Main thread tasks (GL, SDL video & events, splash rendering...) run on the thread calling run().
+	class TaskGraph
+	{
+	public:
+		typedef std::function<void(void)> work_function;
+
+		TaskGraph(const std::string& name);
+		~TaskGraph();
+
+		void add(const std::string& name, const std::vector<std::string>& dependencies, work_function work, bool mainThread = false);
+
+		// Starts the background tasks which are ready, without waiting. Tasks can still be added after that.
+		void start();
+
+		// Runs everything, returns when all tasks are done, then logs the timeline.
+		void run();
+
+	private:
+		enum TaskState
+		{
+			TASK_PENDING,
+			TASK_RUNNING,
+			TASK_DONE
+		};
+
+		struct Task
+		{
+			std::string name;
+			std::vector<std::string> dependencies;
+			work_function work;
+			bool mainThread;
+
+			TaskState state;
+			int startTime;
+			int endTime;
+			std::thread* thread;
+		};
+
+		bool isReady(Task* task);
+		void startReadyTasks();
+		void execute(Task* task);
+		void join();
+		void logTimeline();
+
+		std::string mName;
+		std::vector<Task*> mTasks;
+		std::map<std::string, Task*> mTaskNames;
+
+		std::mutex mLock;
+		std::condition_variable mEvent;
+		int mStartTime;
+	};
+}
+
+#endif // ES_CORE_UTILS_TASK_GRAPH_H